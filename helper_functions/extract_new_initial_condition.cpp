@@ -1,3 +1,4 @@
+#include "ComponentJsonHelpers.hpp"
 #include <algorithm>
 #include <exception>
 #include <filesystem>
@@ -10,10 +11,6 @@
 using json = nlohmann::ordered_json;
 namespace fs = std::filesystem;
 
-json convert_resultdata_to_intialdata(json datapoint, std::string ctypename);
-json powerinitial(json datapoint);
-json gasinitial(json datapoint);
-
 /** \brief Writes out the state at the given time passed in an results file into
  * a file that can be used as an initial value file.
  *
@@ -75,7 +72,8 @@ int main(int argc, char **argv) {
         }
         json initialdata;
         try {
-          initialdata = convert_resultdata_to_intialdata(*it, ctypename);
+          initialdata
+              = Aux::initial_data_from_result_datapoint(*it, ctypename);
         } catch (std::exception &e) {
           std::cout << "Failed to extract initial data from results file at "
                        "object with id: "
@@ -96,54 +94,3 @@ int main(int argc, char **argv) {
     outstream << new_initial_values.dump(1, '\t');
   }
 }
-
-json convert_resultdata_to_intialdata(json datapoint, std::string ctypename) {
-
-  std::vector<std::string> powertypes{
-      "PQnode", "PVnode", "Vphinode", "StochasticPQnode", "ExternalPowerplant"};
-  std::vector<std::string> gastypes{
-      "Pipe", "Shortpipe", "Gaspowerconnection", "Compressorstation",
-      "Controlvalve"};
-
-  {
-
-    auto name_it = std::find(powertypes.begin(), powertypes.end(), ctypename);
-    if (name_it != powertypes.end()) {
-      return powerinitial(datapoint);
-    }
-  }
-  {
-    auto name_it = std::find(gastypes.begin(), gastypes.end(), ctypename);
-    if (name_it != gastypes.end()) {
-      return gasinitial(datapoint);
-    }
-  }
-  throw std::runtime_error(
-      "Unknown componenttype, not a power node, not a gas edge!");
-}
-
-json powerinitial(json datapoint) {
-  json init_data = json::array();
-  json init_datapoint;
-  init_datapoint["x"] = 0.0;
-  init_datapoint["values"] = json::array();
-  init_datapoint["values"].push_back(datapoint["V"]);
-  init_datapoint["values"].push_back(datapoint["phi"]);
-  init_data.push_back(init_datapoint);
-  return init_data;
-}
-
-json gasinitial(json datapoint) {
-  json init_data = json::array();
-  auto flow_it = datapoint["flow"].begin();
-  auto pressure_it = datapoint["pressure"].begin();
-  for (; flow_it != datapoint["flow"].end(); ++flow_it, ++pressure_it) {
-    json init_datapoint;
-    init_datapoint["x"] = (*flow_it)["x"];
-    init_datapoint["values"] = json::array();
-    init_datapoint["values"].push_back((*pressure_it)["value"]);
-    init_datapoint["values"].push_back((*flow_it)["value"]);
-    init_data.push_back(init_datapoint);
-  }
-  return init_data;
-}
@@ -16,6 +16,7 @@
  */
 #include "ComponentJsonHelpers.hpp"
 #include "Exception.hpp"
+#include <algorithm>
 namespace Aux {
 
   std::vector<std::string>
@@ -85,4 +86,48 @@ namespace Aux {
       }
     }
   }
+
+  static nlohmann::json power_initial_data(nlohmann::json const &datapoint) {
+    nlohmann::json initial_datapoint;
+    initial_datapoint["x"] = 0.0;
+    initial_datapoint["values"] = {datapoint["V"], datapoint["phi"]};
+    return nlohmann::json::array({initial_datapoint});
+  }
+
+  static nlohmann::json gas_initial_data(nlohmann::json const &datapoint) {
+    nlohmann::json initial_data = nlohmann::json::array();
+    auto const &pressures = datapoint["pressure"];
+    auto const &flows = datapoint["flow"];
+    for (size_t index = 0; index != flows.size(); ++index) {
+      nlohmann::json initial_datapoint;
+      initial_datapoint["x"] = flows[index]["x"];
+      initial_datapoint["values"]
+          = {pressures[index]["value"], flows[index]["value"]};
+      initial_data.push_back(initial_datapoint);
+    }
+    return initial_data;
+  }
+
+  nlohmann::json initial_data_from_result_datapoint(
+      nlohmann::json const &datapoint, std::string const &component_type) {
+    std::vector<std::string> const powertypes{
+        "PQnode", "PVnode", "Vphinode", "StochasticPQnode",
+        "ExternalPowerplant"};
+    std::vector<std::string> const gastypes{
+        "Pipe", "Shortpipe", "Gaspowerconnection", "Compressorstation",
+        "Controlvalve"};
+    auto contains = [&component_type](std::vector<std::string> const &names) {
+      return std::find(names.begin(), names.end(), component_type)
+             != names.end();
+    };
+    if (contains(powertypes)) {
+      return power_initial_data(datapoint);
+    }
+    if (contains(gastypes)) {
+      return gas_initial_data(datapoint);
+    }
+    gthrow(
+        {"Can't write initial values of unknown component type \"",
+         component_type, "\", it is neither a power node nor a gas edge."});
+  }
 } // namespace Aux
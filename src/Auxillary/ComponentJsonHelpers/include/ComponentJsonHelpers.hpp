@@ -39,4 +39,17 @@ namespace Aux {
    * boundary.
    */
   void check_for_duplicates(nlohmann::json &components, std::string key);
+
+  /** \brief Converts one datapoint of a component in a results json, as
+   * written by Model::Networkproblem::add_results_to_json, to the "data" of
+   * the component in an initial value json.
+   *
+   * Throws an exception, if component_type is neither a power node nor a gas
+   * edge.
+   *
+   * @param datapoint The results of the component at one time.
+   * @param component_type The type of the component, e.g. "Pipe".
+   */
+  nlohmann::json initial_data_from_result_datapoint(
+      nlohmann::json const &datapoint, std::string const &component_type);
 } // namespace Aux
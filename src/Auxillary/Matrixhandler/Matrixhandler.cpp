@@ -16,11 +16,20 @@
  */
 #include "Matrixhandler.hpp"
 #include <Eigen/Sparse>
+#include <algorithm>
 #include <cassert>
+#include <exception>
 
 namespace Aux {
   Matrixhandler::~Matrixhandler() {}
 
+  void Matrixhandler::add_constant_to_coefficient(
+      Eigen::Index row, Eigen::Index col, double value) {
+    add_to_coefficient(row, col, value);
+  }
+
+  bool Matrixhandler::constants_recorded() const { return false; }
+
   template <int Transpose>
   Triplethandler<Transpose>::Triplethandler(
       Eigen::SparseMatrix<double> &_matrix) :
@@ -85,10 +94,315 @@ namespace Aux {
 
   template <int Transpose> void Coeffrefhandler<Transpose>::set_matrix() {}
 
+  void Slotmap::clear() {
+    slots.clear();
+    constant_coefficients.clear();
+    constants_recorded = false;
+    constant_values.clear();
+  }
+
+  /** \brief Places the constant coefficients at their positions in the
+   * value array of matrix.
+   *
+   * Returns an empty vector, if one of them is not in the sparsity pattern.
+   */
+  static std::vector<double> resolve_constant_values(
+      Eigen::SparseMatrix<double> const &matrix,
+      std::vector<Eigen::Triplet<double, Eigen::Index>> const
+          &constant_coefficients) {
+    std::vector<double> values(
+        static_cast<std::size_t>(matrix.nonZeros()), 0.0);
+    auto const *outer = matrix.outerIndexPtr();
+    auto const *inner = matrix.innerIndexPtr();
+    for (auto const &coefficient : constant_coefficients) {
+      auto const *column_begin = inner + outer[coefficient.col()];
+      auto const *column_end = inner + outer[coefficient.col() + 1];
+      auto const *found
+          = std::lower_bound(column_begin, column_end, coefficient.row());
+      if (found == column_end or *found != coefficient.row()) {
+        return {};
+      }
+      values[static_cast<std::size_t>(found - inner)] += coefficient.value();
+    }
+    return values;
+  }
+
+  template <int Transpose>
+  Slothandler<Transpose>::Slothandler(
+      Eigen::SparseMatrix<double> &_matrix, Slotmap &_slotmap) :
+      Matrixhandler(_matrix), slotmap(_slotmap), slots(_slotmap.slots) {
+    // Positions in the value array are only meaningful in compressed mode:
+    _matrix.makeCompressed();
+    auto const number_of_nonzeros
+        = static_cast<std::size_t>(_matrix.nonZeros());
+    if (slotmap.constants_recorded
+        and slotmap.constant_values.size() != number_of_nonzeros) {
+      // The sparsity pattern has changed since the constants were placed:
+      slotmap.constant_values
+          = resolve_constant_values(_matrix, slotmap.constant_coefficients);
+    }
+    Eigen::Map<Eigen::VectorXd> coefficients(
+        _matrix.valuePtr(), _matrix.nonZeros());
+    if (slotmap.constants_recorded
+        and slotmap.constant_values.size() == number_of_nonzeros) {
+      // Start from the constant coefficients:
+      coefficients = Eigen::Map<Eigen::VectorXd const>(
+          slotmap.constant_values.data(), _matrix.nonZeros());
+      skip_constants = true;
+      return;
+    }
+    // Set the matrix to zero and record the constant coefficients:
+    coefficients.setZero();
+    slotmap.constant_coefficients.clear();
+    slotmap.constants_recorded = false;
+    slotmap.constant_values.clear();
+    uncaught_exceptions = std::uncaught_exceptions();
+  }
+
+  template <int Transpose> Slothandler<Transpose>::~Slothandler() {
+    // Only a complete fill has recorded all constant coefficients:
+    if (not skip_constants
+        and std::uncaught_exceptions() == uncaught_exceptions) {
+      slotmap.constants_recorded = true;
+    }
+  }
+
+  template <int Transpose>
+  void Slothandler<Transpose>::add_to_coefficient(
+      Eigen::Index row, Eigen::Index col, double value) {
+
+    Eigen::Index actual_row = -1;
+    Eigen::Index actual_col = -1;
+    if constexpr (not Transpose) {
+      actual_row = row;
+      actual_col = col;
+    } else {
+      actual_row = col;
+      actual_col = row;
+    }
+    assert(0 <= actual_row);
+    assert(actual_row < matrix.rows());
+    assert(0 <= actual_col);
+    assert(actual_col < matrix.cols());
+
+    if (inserted) {
+      matrix.coeffRef(actual_row, actual_col) += value;
+      return;
+    }
+
+    auto const *outer = matrix.outerIndexPtr();
+    auto const *inner = matrix.innerIndexPtr();
+    auto const call = call_counter;
+    ++call_counter;
+
+    // Fast path: The remembered position still holds this coefficient.
+    if (call < slots.size()) {
+      auto slot = slots[call];
+      if (outer[actual_col] <= slot and slot < outer[actual_col + 1]
+          and inner[slot] == actual_row) {
+        matrix.valuePtr()[slot] += value;
+        return;
+      }
+    }
+
+    // Slow path: Search the column and remember the position.
+    auto const *column_begin = inner + outer[actual_col];
+    auto const *column_end = inner + outer[actual_col + 1];
+    auto const *found = std::lower_bound(column_begin, column_end, actual_row);
+    if (found == column_end or *found != actual_row) {
+      // The coefficient is not in the sparsity pattern. Inserting it moves
+      // the other coefficients, so the remembered positions are worthless.
+      slots.clear();
+      inserted = true;
+      matrix.coeffRef(actual_row, actual_col) += value;
+      return;
+    }
+    Eigen::Index slot = found - inner;
+    if (call < slots.size()) {
+      slots[call] = slot;
+    } else {
+      slots.push_back(slot);
+    }
+    matrix.valuePtr()[slot] += value;
+  }
+
+  template <int Transpose>
+  void Slothandler<Transpose>::add_constant_to_coefficient(
+      Eigen::Index row, Eigen::Index col, double value) {
+    if (skip_constants) {
+      return;
+    }
+    Eigen::Index actual_row = row;
+    Eigen::Index actual_col = col;
+    if constexpr (Transpose) {
+      actual_row = col;
+      actual_col = row;
+    }
+    assert(0 <= actual_row);
+    assert(actual_row < matrix.rows());
+    assert(0 <= actual_col);
+    assert(actual_col < matrix.cols());
+    slotmap.constant_coefficients.emplace_back(actual_row, actual_col, value);
+    search_and_add(actual_row, actual_col, value);
+  }
+
+  template <int Transpose>
+  void Slothandler<Transpose>::search_and_add(
+      Eigen::Index actual_row, Eigen::Index actual_col, double value) {
+    if (not inserted) {
+      auto const *outer = matrix.outerIndexPtr();
+      auto const *inner = matrix.innerIndexPtr();
+      auto const *column_begin = inner + outer[actual_col];
+      auto const *column_end = inner + outer[actual_col + 1];
+      auto const *found
+          = std::lower_bound(column_begin, column_end, actual_row);
+      if (found != column_end and *found == actual_row) {
+        matrix.valuePtr()[found - inner] += value;
+        return;
+      }
+      // Inserting moves the other coefficients, so the remembered positions
+      // are worthless.
+      slots.clear();
+      inserted = true;
+    }
+    matrix.coeffRef(actual_row, actual_col) += value;
+  }
+
+  template <int Transpose>
+  bool Slothandler<Transpose>::constants_recorded() const {
+    return skip_constants;
+  }
+
+  template <int Transpose> void Slothandler<Transpose>::set_matrix() {}
+
+  template <int Transpose>
+  std::size_t Slothandler<Transpose>::get_number_of_calls() const {
+    return call_counter;
+  }
+
+  template <int Transpose>
+  bool Slothandler<Transpose>::remembers_calls(
+      std::size_t first_call, std::size_t after_call) const {
+    return not inserted and first_call <= after_call
+           and after_call <= slots.size();
+  }
+
+  template <int Transpose>
+  Eigen::Index Slothandler<Transpose>::remembered_row(std::size_t call) const {
+    assert(call < slots.size());
+    return matrix.innerIndexPtr()[slots[call]];
+  }
+
+  template <int Transpose>
+  Slotrangehandler<Transpose> Slothandler<Transpose>::make_range_handler(
+      std::size_t first_call, std::size_t after_call) {
+    assert(remembers_calls(first_call, after_call));
+    return Slotrangehandler<Transpose>(
+        matrix, slots, first_call, after_call, skip_constants);
+  }
+
+  template <int Transpose>
+  void Slothandler<Transpose>::skip_calls(std::size_t number_of_calls) {
+    call_counter += number_of_calls;
+  }
+
+  template <int Transpose>
+  void Slothandler<Transpose>::add_missed_coefficients(
+      std::vector<Eigen::Triplet<double, Eigen::Index>> const
+          &missed_coefficients) {
+    if (missed_coefficients.empty()) {
+      return;
+    }
+    for (auto const &coefficient : missed_coefficients) {
+      if constexpr (not Transpose) {
+        matrix.coeffRef(coefficient.row(), coefficient.col())
+            += coefficient.value();
+      } else {
+        matrix.coeffRef(coefficient.col(), coefficient.row())
+            += coefficient.value();
+      }
+    }
+    slots.clear();
+    inserted = true;
+  }
+
+  template <int Transpose>
+  Slotrangehandler<Transpose>::Slotrangehandler(
+      Eigen::SparseMatrix<double> &_matrix,
+      std::vector<Eigen::Index> const &_slots, std::size_t first_call,
+      std::size_t _after_call, bool _skip_constants) :
+      Matrixhandler(_matrix),
+      slots(_slots),
+      call(first_call),
+      after_call(_after_call),
+      skip_constants(_skip_constants) {
+    assert(_matrix.isCompressed());
+  }
+
+  template <int Transpose>
+  void Slotrangehandler<Transpose>::add_to_coefficient(
+      Eigen::Index row, Eigen::Index col, double value) {
+    Eigen::Index actual_row = row;
+    Eigen::Index actual_col = col;
+    if constexpr (Transpose) {
+      actual_row = col;
+      actual_col = row;
+    }
+    assert(0 <= actual_row);
+    assert(actual_row < matrix.rows());
+    assert(0 <= actual_col);
+    assert(actual_col < matrix.cols());
+
+    if (call < after_call) {
+      auto const slot = slots[call];
+      ++call;
+      auto const *outer = matrix.outerIndexPtr();
+      if (outer[actual_col] <= slot and slot < outer[actual_col + 1]
+          and matrix.innerIndexPtr()[slot] == actual_row) {
+        matrix.valuePtr()[slot] += value;
+        return;
+      }
+    }
+    missed_coefficients.emplace_back(row, col, value);
+  }
+
+  template <int Transpose>
+  void Slotrangehandler<Transpose>::add_constant_to_coefficient(
+      Eigen::Index row, Eigen::Index col, double value) {
+    if (not skip_constants) {
+      missed_constant_coefficients.emplace_back(row, col, value);
+    }
+  }
+
+  template <int Transpose>
+  bool Slotrangehandler<Transpose>::constants_recorded() const {
+    return skip_constants;
+  }
+
+  template <int Transpose> void Slotrangehandler<Transpose>::set_matrix() {}
+
+  template <int Transpose>
+  std::vector<Eigen::Triplet<double, Eigen::Index>> const &
+  Slotrangehandler<Transpose>::get_missed_coefficients() const {
+    return missed_coefficients;
+  }
+
+  template <int Transpose>
+  std::vector<Eigen::Triplet<double, Eigen::Index>> const &
+  Slotrangehandler<Transpose>::get_missed_constant_coefficients() const {
+    return missed_constant_coefficients;
+  }
+
   template class Triplethandler<Transposed>;
   template class Triplethandler<Regular>;
 
   template class Coeffrefhandler<Transposed>;
   template class Coeffrefhandler<Regular>;
 
+  template class Slothandler<Transposed>;
+  template class Slothandler<Regular>;
+
+  template class Slotrangehandler<Transposed>;
+  template class Slotrangehandler<Regular>;
+
 } // namespace Aux
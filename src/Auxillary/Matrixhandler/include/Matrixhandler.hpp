@@ -41,10 +41,31 @@ namespace Aux {
     add_to_coefficient(Eigen::Index row, Eigen::Index col, double value)
         = 0;
 
+    /// \brief Adds to a coefficient a value, that is the same in every fill
+    /// of the matrix, because it depends neither on the state nor on the
+    /// time.
+    ///
+    /// Defaults to #add_to_coefficient. A #Slothandler skips it, if its
+    /// #Slotmap has kept the constant coefficients of an earlier fill.
+    ///
+    /// @param row The row index of the coefficient.
+    /// @param col The column index of the coefficient.
+    /// @param value The value to be added to the already present coefficient.
+    virtual void add_constant_to_coefficient(
+        Eigen::Index row, Eigen::Index col, double value);
+
+    /// \brief Returns true, if the matrix already holds the constant
+    /// coefficients of an earlier fill, so that
+    /// #add_constant_to_coefficient does nothing.
+    ///
+    /// Components, whose derivatives are all constant, may then skip
+    /// computing them. Defaults to false.
+    virtual bool constants_recorded() const;
+
     /// For #Triplethandler: Builds the matrix from the gathered coefficients
     /// and then forgets the coefficients.
     ///
-    /// For #Coeffrefhandler: Does nothing.
+    /// For #Coeffrefhandler and #Slothandler: Does nothing.
     virtual void set_matrix() = 0;
 
   protected:
@@ -84,10 +105,187 @@ namespace Aux {
     void set_matrix() final;
   };
 
+  /// \brief Remembers the positions in the value array of a compressed sparse
+  /// matrix, to which a sequence of calls to
+  /// Matrixhandler::add_to_coefficient wrote.
+  ///
+  /// A Slotmap is meant to outlive the #Slothandler objects using it, so that
+  /// the search for the coefficients has to be done only once for a matrix
+  /// that is filled over and over in the same order.
+  ///
+  /// It also keeps the sum of the coefficients added by
+  /// Matrixhandler::add_constant_to_coefficient(), so that later fills start
+  /// from them instead of from zero.
+  class Slotmap {
+  public:
+    /// \brief Forgets all remembered positions and constant coefficients.
+    void clear();
+
+  private:
+    template <int Transpose> friend class Slothandler;
+
+    std::vector<Eigen::Index> slots;
+
+    /// The constant coefficients of the last fill, that recorded them, in
+    /// the coordinates of the matrix.
+    std::vector<Eigen::Triplet<double, Eigen::Index>> constant_coefficients;
+
+    /// Is true, while #constant_coefficients holds all constant
+    /// coefficients of a whole fill.
+    bool constants_recorded{false};
+
+    /// The constant coefficients at their positions in the value array of
+    /// the compressed matrix, empty if they must be recorded anew.
+    std::vector<double> constant_values;
+  };
+
+  /// \brief Adds the coefficients of a contiguous part of the calls
+  /// remembered by a #Slothandler directly at their remembered positions.
+  ///
+  /// It never searches or inserts, so several Slotrangehandlers may write to
+  /// the same matrix concurrently, as long as they write to different
+  /// coefficients. Coefficients, that are not at their remembered position,
+  /// are collected instead, see Slothandler::add_missed_coefficients().
+  /// Constant coefficients are skipped, if the Slothandler keeps them, and
+  /// collected otherwise. Construct them with
+  /// Slothandler::make_range_handler().
+  template <int Transpose = Regular>
+  class Slotrangehandler final : public Matrixhandler {
+
+  public:
+    Slotrangehandler(
+        Eigen::SparseMatrix<double> &matrix,
+        std::vector<Eigen::Index> const &slots, std::size_t first_call,
+        std::size_t after_call, bool skip_constants);
+
+    void
+    add_to_coefficient(Eigen::Index row, Eigen::Index col, double value) final;
+
+    void add_constant_to_coefficient(
+        Eigen::Index row, Eigen::Index col, double value) final;
+
+    bool constants_recorded() const final;
+
+    void set_matrix() final;
+
+    /// \brief The coefficients, that could not be written, in the
+    /// coordinates of the calls to #add_to_coefficient.
+    std::vector<Eigen::Triplet<double, Eigen::Index>> const &
+    get_missed_coefficients() const;
+
+    /// \brief The constant coefficients, that were not skipped, in the
+    /// coordinates of the calls to #add_constant_to_coefficient. Hand them to
+    /// Slothandler::add_constant_to_coefficient().
+    std::vector<Eigen::Triplet<double, Eigen::Index>> const &
+    get_missed_constant_coefficients() const;
+
+  private:
+    std::vector<Eigen::Index> const &slots;
+    std::size_t call;
+    std::size_t const after_call;
+    bool const skip_constants;
+    std::vector<Eigen::Triplet<double, Eigen::Index>> missed_coefficients;
+    std::vector<Eigen::Triplet<double, Eigen::Index>>
+        missed_constant_coefficients;
+  };
+
+  /// \brief The Slothandler variety works like the #Coeffrefhandler, but
+  /// remembers the position of every coefficient in a #Slotmap. As long as the
+  /// coefficients are added in the same order as in the previous use of the
+  /// Slotmap, they are written directly into the value array of the matrix
+  /// without any search. It sets the matrix to zero on construction.
+  ///
+  /// Every remembered position is checked against its row and column before
+  /// use, so a changed order of calls or a changed sparsity pattern only
+  /// costs time. Coefficients that are not yet present in the matrix are
+  /// inserted like in the #Coeffrefhandler.
+  ///
+  /// Constant coefficients, see Matrixhandler::add_constant_to_coefficient(),
+  /// don't count as calls. The first fill with a Slotmap records them, later
+  /// fills start from the recorded constants instead of from zero and skip
+  /// them, until the sparsity pattern changes.
+  template <int Transpose = Regular>
+  class Slothandler final : public Matrixhandler {
+
+  public:
+    Slothandler(Eigen::SparseMatrix<double> &matrix, Slotmap &slotmap);
+
+    ~Slothandler() final;
+
+    void
+    add_to_coefficient(Eigen::Index row, Eigen::Index col, double value) final;
+
+    void add_constant_to_coefficient(
+        Eigen::Index row, Eigen::Index col, double value) final;
+
+    bool constants_recorded() const final;
+
+    void set_matrix() final;
+
+    /// \brief The number of calls to #add_to_coefficient so far, including
+    /// those skipped by #skip_calls.
+    std::size_t get_number_of_calls() const;
+
+    /// \brief Returns true, if the positions of the calls in
+    /// [first_call, after_call) are remembered and still valid.
+    bool remembers_calls(std::size_t first_call, std::size_t after_call) const;
+
+    /// \brief The row in the matrix (not transposed), that the remembered
+    /// call wrote to.
+    Eigen::Index remembered_row(std::size_t call) const;
+
+    /// \brief Returns a handler for the calls [first_call, after_call),
+    /// which must be remembered.
+    Slotrangehandler<Transpose>
+    make_range_handler(std::size_t first_call, std::size_t after_call);
+
+    /// \brief Continues after number_of_calls further calls, which were
+    /// handled by #Slotrangehandler objects instead.
+    void skip_calls(std::size_t number_of_calls);
+
+    /// \brief Adds coefficients, that a #Slotrangehandler could not write,
+    /// with a search and insertion if necessary.
+    ///
+    /// Afterwards all remembered positions are forgotten, so that the next
+    /// Slothandler records them anew.
+    void add_missed_coefficients(
+        std::vector<Eigen::Triplet<double, Eigen::Index>> const
+            &missed_coefficients);
+
+  private:
+    /// \brief Adds value at (actual_row, actual_col) of the matrix with a
+    /// search and inserts the coefficient, if it is missing.
+    void search_and_add(
+        Eigen::Index actual_row, Eigen::Index actual_col, double value);
+
+    Slotmap &slotmap;
+    std::vector<Eigen::Index> &slots;
+
+    /// Is true, if the matrix started from the constant coefficients of the
+    /// Slotmap, so that they are skipped.
+    bool skip_constants{false};
+
+    /// The number of uncaught exceptions at construction. If it has grown on
+    /// destruction, the fill was aborted and the recorded constant
+    /// coefficients may be incomplete.
+    int uncaught_exceptions{0};
+
+    /// The number of calls to add_to_coefficient so far.
+    std::size_t call_counter{0};
+
+    /// Is true after a coefficient had to be inserted into the matrix, which
+    /// invalidates all remembered positions.
+    bool inserted{false};
+  };
+
   extern template class Triplethandler<Regular>;
   extern template class Coeffrefhandler<Regular>;
+  extern template class Slothandler<Regular>;
+  extern template class Slotrangehandler<Regular>;
 
   extern template class Triplethandler<Transposed>;
   extern template class Coeffrefhandler<Transposed>;
+  extern template class Slothandler<Transposed>;
+  extern template class Slotrangehandler<Transposed>;
 
 } // namespace Aux
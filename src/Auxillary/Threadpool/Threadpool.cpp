@@ -0,0 +1,110 @@
+/*
+ * Grazer - network simulation and optimization tool
+ *
+ * Copyright 2020-2022 Uni Mannheim <e.fokken+grazer@posteo.de>,
+ *
+ * SPDX-License-Identifier:	MIT
+ *
+ * Licensed under the MIT License, found in the file LICENSE and at
+ * https://opensource.org/licenses/MIT
+ * This file may not be copied, modified, or distributed except according to
+ * those terms.
+ *
+ * Distributed on an "AS IS" BASIS, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied.  See your chosen license for details.
+ *
+ */
+#include "Threadpool.hpp"
+#include "Exception.hpp"
+#include <string>
+
+namespace Aux {
+
+  Threadpool::Threadpool(int number_of_threads) {
+    if (number_of_threads < 1) {
+      gthrow(
+          {"A thread pool needs at least one thread, but ",
+           std::to_string(number_of_threads), " were requested."});
+    }
+    workers.reserve(static_cast<std::size_t>(number_of_threads - 1));
+    for (int index = 1; index != number_of_threads; ++index) {
+      workers.emplace_back([this, index]() { work(index); });
+    }
+  }
+
+  Threadpool::~Threadpool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    start_condition.notify_all();
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  }
+
+  int Threadpool::get_number_of_threads() const {
+    return static_cast<int>(workers.size()) + 1;
+  }
+
+  void Threadpool::run(std::function<void(int)> const &task) {
+    if (workers.empty()) {
+      task(0);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      current_task = &task;
+      first_exception = nullptr;
+      unfinished_workers = static_cast<int>(workers.size());
+      ++generation;
+    }
+    start_condition.notify_all();
+
+    std::exception_ptr own_exception;
+    try {
+      task(0);
+    } catch (...) { own_exception = std::current_exception(); }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished_condition.wait(lock, [this]() { return unfinished_workers == 0; });
+    current_task = nullptr;
+    if (own_exception) {
+      std::rethrow_exception(own_exception);
+    }
+    if (first_exception) {
+      std::rethrow_exception(first_exception);
+    }
+  }
+
+  void Threadpool::work(int thread_index) {
+    std::size_t last_generation = 0;
+    while (true) {
+      std::function<void(int)> const *task = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        start_condition.wait(lock, [this, last_generation]() {
+          return stopping or generation != last_generation;
+        });
+        if (stopping) {
+          return;
+        }
+        last_generation = generation;
+        task = current_task;
+      }
+      std::exception_ptr exception;
+      try {
+        (*task)(thread_index);
+      } catch (...) { exception = std::current_exception(); }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (exception and not first_exception) {
+          first_exception = exception;
+        }
+        --unfinished_workers;
+      }
+      finished_condition.notify_one();
+    }
+  }
+
+} // namespace Aux
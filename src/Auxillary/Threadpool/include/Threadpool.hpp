@@ -0,0 +1,75 @@
+/*
+ * Grazer - network simulation and optimization tool
+ *
+ * Copyright 2020-2022 Uni Mannheim <e.fokken+grazer@posteo.de>,
+ *
+ * SPDX-License-Identifier:	MIT
+ *
+ * Licensed under the MIT License, found in the file LICENSE and at
+ * https://opensource.org/licenses/MIT
+ * This file may not be copied, modified, or distributed except according to
+ * those terms.
+ *
+ * Distributed on an "AS IS" BASIS, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied.  See your chosen license for details.
+ *
+ */
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Aux {
+
+  /** \brief A fixed set of worker threads, that run one task per thread and
+   * wait for all of them.
+   *
+   * The calling thread takes part in the work, so a Threadpool with one
+   * thread starts no additional threads at all. It is meant for fork-join
+   * parallelism with a fixed partition of the work, which keeps results
+   * independent of the scheduling.
+   */
+  class Threadpool {
+  public:
+    /** \brief Starts number_of_threads - 1 worker threads.
+     *
+     * Throws, if number_of_threads is smaller than one.
+     */
+    explicit Threadpool(int number_of_threads);
+
+    ~Threadpool();
+
+    Threadpool(Threadpool const &) = delete;
+    Threadpool &operator=(Threadpool const &) = delete;
+
+    int get_number_of_threads() const;
+
+    /** \brief Calls task(i) for every i in [0, #get_number_of_threads()),
+     * each in its own thread, and returns, when all calls have returned.
+     *
+     * The calling thread executes task(0). If any call throws, the first
+     * exception is rethrown after all calls have finished. Must not be called
+     * from inside a task.
+     */
+    void run(std::function<void(int)> const &task);
+
+  private:
+    void work(int thread_index);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start_condition;
+    std::condition_variable finished_condition;
+    std::function<void(int)> const *current_task{nullptr};
+    std::exception_ptr first_exception;
+    /// Incremented for every call to #run, so that workers notice new work.
+    std::size_t generation{0};
+    int unfinished_workers{0};
+    bool stopping{false};
+  };
+
+} // namespace Aux
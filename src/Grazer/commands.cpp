@@ -85,7 +85,13 @@ int grazer::run(std::filesystem::path directory_path) {
     auto problem_ptr
         = std::make_unique<Model::Networkproblem>(std::move(net_ptr));
     auto &problem = *problem_ptr;
+    if (simulation_settings.value("state_ordering", "components")
+        == "reverse_cuthill_mckee") {
+      problem.order_states_by_topology();
+    }
     problem.init();
+    problem.set_number_of_threads(
+        simulation_settings.value("number_of_threads", 1));
 
     Eigen::VectorXd initial_state(problem.get_number_of_states());
     problem.set_initial_values(initial_state, initial_json);
@@ -212,13 +218,19 @@ int grazer::run(std::filesystem::path directory_path) {
           constraint_lower_bounds_json, constraint_upper_bounds,
           constraint_upper_bounds_json);
 
+      std::string linear_solver
+          = simulation_settings.value("linear_solver", "SparseLU");
+      if (linear_solver == "BlockJacobi") {
+        // Only a preconditioner, the adjoint equations need exact solves.
+        linear_solver = "SparseLU";
+      }
       auto cache_ptr = std::make_unique<Optimization::ControlStateCache>(
           std::move(timeevolver_ptr));
       auto optimizer_ptr = std::make_unique<Optimization::ImplicitOptimizer>(
           std::move(problem_ptr), std::move(cache_ptr), state_timepoints,
           control_timepoints, constraint_timepoints, initial_state,
           full_controls, lower_bounds, upper_bounds, constraint_lower_bounds,
-          constraint_upper_bounds);
+          constraint_upper_bounds, linear_solver);
       auto &optimizer = *optimizer_ptr;
       Optimization::IpoptAdaptor adaptor(std::move(optimizer_ptr));
       // std::cout << optimizer.get_initial_controls() << std::endl;
@@ -359,3 +371,68 @@ int grazer::run(std::filesystem::path directory_path) {
   std::cout << "total:           " << total_duration << " seconds" << std::endl;
   return EXIT_SUCCESS;
 }
+
+int grazer::steady(std::filesystem::path directory_path) {
+  auto problem_directory = directory_path / "problem";
+  auto problem_data_file = problem_directory / "problem_data.json";
+  std::filesystem::path outer_output_directory = directory_path / "output";
+  std::filesystem::create_directory(outer_output_directory);
+  if (not std::filesystem::is_directory(outer_output_directory)) {
+    throw std::runtime_error(
+        "The output directory "
+        + std::filesystem::absolute(outer_output_directory).string()
+        + " is not present and could not be created!");
+  }
+  auto output_directory = io::unique_output_directory(outer_output_directory);
+  std::cout << "Using output directory\n"
+            << output_directory.string() << std::endl;
+
+  auto all_json = aux_json::get_json_from_file_path(problem_data_file);
+  auto simulation_settings = all_json["simulation_settings"];
+  auto problem_json = all_json["problem_data"];
+  problem_json["GRAZER_file_directory"] = problem_directory.string();
+  auto initial_json = aux_json::get_json_from_file_path(
+      problem_directory / std::filesystem::path("initial.json"));
+  Model::Timedata timedata(simulation_settings);
+  auto timeevolver_ptr
+      = Model::Timeevolver::make_pointer_instance(simulation_settings);
+
+  Model::Componentfactory::Full_factory componentfactory(
+      problem_json.value("defaults", R"({})"_json));
+  auto net_ptr = Model::build_net(problem_json, componentfactory);
+  Model::Networkproblem problem(std::move(net_ptr));
+  if (simulation_settings.value("state_ordering", "components")
+      == "reverse_cuthill_mckee") {
+    problem.order_states_by_topology();
+  }
+  problem.init();
+  problem.set_number_of_threads(
+      simulation_settings.value("number_of_threads", 1));
+
+  Eigen::VectorXd state(problem.get_number_of_states());
+  problem.set_initial_values(state, initial_json);
+
+  Aux::InterpolatingVector full_controls;
+  setup_controls(full_controls, problem, timedata, all_json, problem_directory);
+  Eigen::VectorXd control;
+  if (full_controls.get_inner_length() > 0) {
+    control = full_controls(timedata.get_starttime());
+  }
+
+  timeevolver_ptr->solve_steady_state(
+      timedata.get_starttime(), timedata.get_delta_t(), state, control,
+      problem);
+
+  problem.json_save(timedata.get_starttime(), state);
+  nlohmann::json states_output_json;
+  problem.add_results_to_json(states_output_json);
+  io::prepare_output_directory(
+      output_directory, problem_directory, {"initial.json"});
+  auto initial_outputfile = output_directory / "initial.json";
+  std::ofstream o(initial_outputfile);
+  o << initial_values_from_results(states_output_json).dump(1, '\t');
+  std::cout << "Stationary initial values written to\n"
+            << std::filesystem::absolute(initial_outputfile).string()
+            << std::endl;
+  return EXIT_SUCCESS;
+}
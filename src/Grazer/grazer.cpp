@@ -50,6 +50,17 @@ int main(int argc, char **argv) {
 
     grazer_run->callback([&]() { return grazer::run(grazer_dir); });
 
+    CLI::App *grazer_steady = app.add_subcommand(
+        "steady",
+        "Compute a stationary state at the start time and write it as "
+        "initial values");
+    grazer_steady
+        ->add_option<std::filesystem::path, std::string>(
+            "grazer-directory", grazer_dir,
+            "directory with problem specification")
+        ->required();
+    grazer_steady->callback([&]() { return grazer::steady(grazer_dir); });
+
     CLI::App *grazer_schema = app.add_subcommand(
         "schema",
         "Schema Helpers for the JSON Schemas validating the input files");
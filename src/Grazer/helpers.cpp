@@ -16,6 +16,7 @@
  */
 #include "helpers.hpp"
 #include "Aux_json.hpp"
+#include "ComponentJsonHelpers.hpp"
 #include "InterpolatingVector.hpp"
 #include "OptimizableObject.hpp"
 #include "Timedata.hpp"
@@ -69,3 +70,21 @@ void setup_controls(
     problem.set_initial_controls(controls, control_json);
   }
 }
+
+nlohmann::json initial_values_from_results(nlohmann::json const &results) {
+  nlohmann::json initial_values;
+  for (auto const &[classname, componentclass] : results.items()) {
+    for (auto const &[componenttype, components] : componentclass.items()) {
+      auto &initial_components = initial_values[classname][componenttype];
+      initial_components = nlohmann::json::array();
+      for (auto const &component : components) {
+        nlohmann::json initial_component;
+        initial_component["id"] = component["id"];
+        initial_component["data"] = Aux::initial_data_from_result_datapoint(
+            component["data"].back(), componenttype);
+        initial_components.push_back(initial_component);
+      }
+    }
+  }
+  return initial_values;
+}
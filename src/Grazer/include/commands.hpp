@@ -19,4 +19,12 @@
 
 namespace grazer {
   int run(std::filesystem::path directory_path);
+
+  /** \brief Computes a stationary state of the problem in directory_path at
+   * the start time and writes it as initial.json into a new output
+   * directory.
+   *
+   * The initial.json of the problem serves as initial guess.
+   */
+  int steady(std::filesystem::path directory_path);
 }
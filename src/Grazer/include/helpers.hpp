@@ -28,3 +28,9 @@ void setup_controls(
     Aux::InterpolatingVector &controls, Model::OptimizableObject &problem,
     Model::Timedata &timedata, nlohmann::json const &all_json,
     std::filesystem::path const &problem_directory);
+
+/** \brief Converts the last time step of every component in a results json,
+ * as written by Model::Networkproblem::add_results_to_json, to the format of
+ * initial.json.
+ */
+nlohmann::json initial_values_from_results(nlohmann::json const &results);
@@ -61,7 +61,8 @@ namespace Optimization {
       Aux::InterpolatingVector_Base const &_lower_bounds,
       Aux::InterpolatingVector_Base const &_upper_bounds,
       Aux::InterpolatingVector_Base const &_constraint_lower_bounds,
-      Aux::InterpolatingVector_Base const &_constraint_upper_bounds) :
+      Aux::InterpolatingVector_Base const &_constraint_upper_bounds,
+      std::string const &linearsolver_name) :
       problem(std::move(_problem)),
       init(std::make_unique<Initialvalues>(
           _initial_controls, _lower_bounds, _upper_bounds,
@@ -80,7 +81,8 @@ namespace Optimization {
           control_timepoints),
       constraintjacobian_accessor(
           nullptr, constraint_jacobian.nonZeros(), constraints_per_step(),
-          controls_per_step(), constraint_timepoints, control_timepoints) {
+          controls_per_step(), constraint_timepoints, control_timepoints),
+      solver(Solver::make_linearsolver(linearsolver_name)) {
     // control sanity checks:
     if (problem->get_number_of_controls_per_timepoint()
         != init->initial_controls.get_inner_length()) {
@@ -537,11 +539,11 @@ namespace Optimization {
           // cost derivative:
           update_cost_derivative_matrices(state_index, controls, states);
           rhs_f -= integral_weights[state_index] * df_dnew_transposed;
-          xi_f = solver.solve(rhs_f);
-          if (solver.info() != Eigen::Success) {
+          xi_f = solver->solve(rhs_f);
+          if (solver->info() != Eigen::Success) {
             std::cout << "Couldn't decompose a state derivative matrix during "
                          "control derivative computation.\n"
-                      << "\n Note, that only LU decomposition is implemented."
+                      << "\n Maybe try another linear solver."
                       << std::endl;
             return false;
           }
@@ -595,12 +597,12 @@ namespace Optimization {
              */
             auto current_Xi = right_cols(full_Xi_row, constraint_index);
             auto current_rhs = right_cols(full_rhs_g, constraint_index);
-            current_Xi = solver.solve(current_rhs);
-            if (solver.info() != Eigen::Success) {
+            current_Xi = solver->solve(current_rhs);
+            if (solver->info() != Eigen::Success) {
               std::cout
                   << "Couldn't decompose a state derivative matrix during "
                      "control derivative computation.\n"
-                  << "\n Note, that only LU decomposition is implemented."
+                  << "\n Maybe try another linear solver."
                   << std::endl;
               return false;
             }
@@ -670,7 +672,7 @@ namespace Optimization {
         new_handler, last_time, new_time, states(last_time), states(new_time),
         controls(new_time));
     new_handler.set_matrix();
-    solver.analyzePattern(dE_dnew_transposed);
+    solver->analyze_pattern(dE_dnew_transposed);
     std::cout << "variables per step: " << dE_dnew_transposed.rows()
               << std::endl;
     std::cout << "nonzeros dE_dnew: " << dE_dnew_transposed.nonZeros()
@@ -740,22 +742,24 @@ namespace Optimization {
     double last_time = state_timepoints[state_index - 1];
     double new_time = state_timepoints[state_index];
 
-    Aux::Coeffrefhandler<Aux::Transposed> last_handler(dE_dlast_transposed);
+    Aux::Slothandler<Aux::Transposed> last_handler(
+        dE_dlast_transposed, dE_dlast_transposed_slots);
     problem->d_evaluate_d_last_state(
         last_handler, last_time, new_time, states(last_time), states(new_time),
         controls(new_time));
 
-    Aux::Coeffrefhandler control_handler(dE_dcontrol);
+    Aux::Slothandler control_handler(dE_dcontrol, dE_dcontrol_slots);
     problem->d_evaluate_d_control(
         control_handler, last_time, new_time, states(last_time),
         states(new_time), controls(new_time));
 
-    Aux::Coeffrefhandler<Aux::Transposed> new_handler(dE_dnew_transposed);
+    Aux::Slothandler<Aux::Transposed> new_handler(
+        dE_dnew_transposed, dE_dnew_transposed_slots);
     problem->d_evaluate_d_new_state(
         new_handler, last_time, new_time, states(last_time), states(new_time),
         controls(new_time));
-    solver.factorize(dE_dnew_transposed);
-    if (solver.info() != Eigen::Success) {
+    solver->factorize(dE_dnew_transposed);
+    if (solver->info() != Eigen::Success) {
       // //Sparse matrix:
       // std::cout << dE_dnew_transposed << std::endl;
       // // Or the dense verion:
@@ -782,10 +786,11 @@ namespace Optimization {
 
     double time = state_timepoints[state_index];
 
-    Aux::Coeffrefhandler<Aux::Transposed> gnew_handler(dg_dnew_transposed);
+    Aux::Slothandler<Aux::Transposed> gnew_handler(
+        dg_dnew_transposed, dg_dnew_transposed_slots);
     problem->d_evaluate_constraint_d_state(
         gnew_handler, time, states(time), controls(time));
-    Aux::Coeffrefhandler gcontrol_handler(dg_dcontrol);
+    Aux::Slothandler gcontrol_handler(dg_dcontrol, dg_dcontrol_slots);
     problem->d_evaluate_constraint_d_control(
         gcontrol_handler, time, states(time), controls(time));
   }
@@ -799,12 +804,13 @@ namespace Optimization {
 
     double time = state_timepoints[state_index];
 
-    Aux::Coeffrefhandler<Aux::Transposed> fnew_handler(df_dnew_transposed);
+    Aux::Slothandler<Aux::Transposed> fnew_handler(
+        df_dnew_transposed, df_dnew_transposed_slots);
     problem->d_evaluate_cost_d_state(
         fnew_handler, time, states(time), controls(time));
     problem->d_evaluate_penalty_d_state(
         fnew_handler, time, states(time), controls(time));
-    Aux::Coeffrefhandler fcontrol_handler(df_dcontrol);
+    Aux::Slothandler fcontrol_handler(df_dcontrol, df_dcontrol_slots);
     problem->d_evaluate_cost_d_control(
         fcontrol_handler, time, states(time), controls(time));
     problem->d_evaluate_penalty_d_control(
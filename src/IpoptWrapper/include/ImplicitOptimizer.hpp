@@ -17,8 +17,11 @@
 #pragma once
 #include "ConstraintJacobian.hpp"
 #include "InterpolatingVector.hpp"
+#include "Linearsolver.hpp"
+#include "Matrixhandler.hpp"
 #include "Optimizer.hpp"
 #include <memory>
+#include <string>
 
 namespace Model {
   class OptimizableObject;
@@ -41,7 +44,8 @@ namespace Optimization {
         Aux::InterpolatingVector_Base const &lower_bounds,
         Aux::InterpolatingVector_Base const &upper_bounds,
         Aux::InterpolatingVector_Base const &constraint_lower_bounds,
-        Aux::InterpolatingVector_Base const &constraint_upper_bounds);
+        Aux::InterpolatingVector_Base const &constraint_upper_bounds,
+        std::string const &linearsolver_name = "SparseLU");
 
     ~ImplicitOptimizer() final;
 
@@ -181,7 +185,16 @@ namespace Optimization {
     Eigen::SparseMatrix<double> dg_dnew_transposed;
     Eigen::SparseMatrix<double> dg_dcontrol;
 
-    Eigen::SparseLU<Eigen::SparseMatrix<double>> solver;
+    // Positions of the coefficients in the matrices above, see Aux::Slotmap.
+    Aux::Slotmap dE_dnew_transposed_slots;
+    Aux::Slotmap dE_dlast_transposed_slots;
+    Aux::Slotmap dE_dcontrol_slots;
+    Aux::Slotmap df_dnew_transposed_slots;
+    Aux::Slotmap df_dcontrol_slots;
+    Aux::Slotmap dg_dnew_transposed_slots;
+    Aux::Slotmap dg_dcontrol_slots;
+
+    std::unique_ptr<Solver::Linearsolver> solver;
 
     // cache_matrices :
     // Eigen::MatrixXd A_jp1_Lambda_j;
@@ -0,0 +1,180 @@
+/*
+ * Grazer - network simulation and optimization tool
+ *
+ * Copyright 2020-2022 Uni Mannheim <e.fokken+grazer@posteo.de>,
+ *
+ * SPDX-License-Identifier:	MIT
+ *
+ * Licensed under the MIT License, found in the file LICENSE and at
+ * https://opensource.org/licenses/MIT
+ * This file may not be copied, modified, or distributed except according to
+ * those terms.
+ *
+ * Distributed on an "AS IS" BASIS, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied.  See your chosen license for details.
+ *
+ */
+#include "Frictionapproximation.hpp"
+#include "Exception.hpp"
+#include "Mathfunctions.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace Model::Balancelaw {
+
+  Frictionapproximation::Frictionapproximation(
+      double diameter, double roughness, double _min_Reynolds) :
+      min_Reynolds(_min_Reynolds),
+      first_exponent(std::ilogb(_min_Reynolds) + 1) {
+    // Swamee-Jain without the check of the turbulent regime, as the first
+    // octave may start below it:
+    double const roughness_term = roughness / (3.7 * diameter);
+    auto exact = [roughness_term](double Re) {
+      double aux = log10(roughness_term + 5.74 / (pow(Re, 0.9)));
+      return 0.25 / (aux * aux);
+    };
+
+    // Interpolation in the Chebyshev points of each piece:
+    Eigen::Matrix<double, degree + 1, degree + 1> vandermonde;
+    Eigen::Matrix<double, degree + 1, 1> nodes;
+    for (int k = 0; k != degree + 1; ++k) {
+      nodes[k] = std::cos(Aux::Pi * (k + 0.5) / (degree + 1));
+      for (int j = 0; j != degree + 1; ++j) {
+        vandermonde(k, j) = std::pow(nodes[k], j);
+      }
+    }
+    auto const solver = vandermonde.colPivHouseholderQr();
+
+    int const octaves = max_exponent - first_exponent + 1;
+    int const max_pieces_per_octave = 1024;
+    int const samples = 16;
+    for (pieces_per_octave = 1;; pieces_per_octave *= 2) {
+      coefficients.resize(degree + 1, octaves * pieces_per_octave);
+      double error = 0.0;
+      for (Eigen::Index piece = 0; piece != coefficients.cols(); ++piece) {
+        auto const octave = piece / pieces_per_octave;
+        double const octave_start
+            = std::ldexp(1.0, first_exponent - 1 + static_cast<int>(octave));
+        double const length = octave_start / pieces_per_octave;
+        double const piece_start
+            = octave_start
+              + length * static_cast<double>(piece % pieces_per_octave);
+        auto Re_at = [&](double u) {
+          return piece_start + 0.5 * (u + 1) * length;
+        };
+        Eigen::Matrix<double, degree + 1, 1> values;
+        for (int k = 0; k != degree + 1; ++k) {
+          values[k] = exact(Re_at(nodes[k]));
+        }
+        coefficients.col(piece) = solver.solve(values);
+        for (int i = 0; i <= samples; ++i) {
+          double u = -1.0 + 2.0 * i / samples;
+          double Re = Re_at(u);
+          double approximation = 0.0;
+          for (int j = degree; j >= 0; --j) {
+            approximation = approximation * u + coefficients(j, piece);
+          }
+          error = std::max(
+              error, std::abs(approximation - exact(Re)) / exact(Re));
+        }
+      }
+      if (error <= max_relative_error) {
+        break;
+      }
+      if (pieces_per_octave >= max_pieces_per_octave) {
+        gthrow(
+            {"The friction factor of the pipe cannot be approximated with a "
+             "relative error of ",
+             std::to_string(max_relative_error), "!"});
+      }
+    }
+    // u runs through [-1, 1] on each piece of length 2^(e-1) / pieces:
+    du_dRe_of_octave.resize(octaves);
+    for (int octave = 0; octave != octaves; ++octave) {
+      du_dRe_of_octave[octave]
+          = std::ldexp(pieces_per_octave, 2 - first_exponent - octave);
+    }
+  }
+
+  bool Frictionapproximation::covers(double Re) const {
+    return Re >= min_Reynolds and Re < max_Reynolds;
+  }
+
+  Eigen::Index
+  Frictionapproximation::locate(double Re, double &u, double &du_dRe) const {
+    // Read the binary exponent from the bits of Re, which is much faster
+    // than std::frexp, and set it to that of [0.5, 1) for the mantissa:
+    static_assert(std::numeric_limits<double>::is_iec559);
+    std::uint64_t bits;
+    std::memcpy(&bits, &Re, sizeof bits);
+    int const exponent = static_cast<int>((bits >> 52) & 0x7ff) - 1022;
+    bits = (bits & 0x800fffffffffffff) | (std::uint64_t{1022} << 52);
+    double mantissa;
+    std::memcpy(&mantissa, &bits, sizeof mantissa);
+
+    double const position = (2 * mantissa - 1) * pieces_per_octave;
+    auto const piece_in_octave = static_cast<Eigen::Index>(position);
+    u = 2 * (position - static_cast<double>(piece_in_octave)) - 1;
+    auto const octave = exponent - first_exponent;
+    du_dRe = du_dRe_of_octave[octave];
+    return octave * pieces_per_octave + piece_in_octave;
+  }
+
+  double Frictionapproximation::lambda(double Re) const {
+    double u;
+    double du_dRe;
+    auto const piece = locate(Re, u, du_dRe);
+    double lambda = 0.0;
+    for (int j = degree; j >= 0; --j) {
+      lambda = lambda * u + coefficients(j, piece);
+    }
+    return lambda;
+  }
+
+  double Frictionapproximation::dlambda_dRe(double Re) const {
+    double u;
+    double du_dRe;
+    auto const piece = locate(Re, u, du_dRe);
+    double dlambda_du = 0.0;
+    for (int j = degree; j >= 1; --j) {
+      dlambda_du = dlambda_du * u + j * coefficients(j, piece);
+    }
+    return dlambda_du * du_dRe;
+  }
+
+  void Frictionapproximation::lambda_at_points(
+      Eigen::ArrayXd const &Re, Eigen::ArrayXd &lambda,
+      Eigen::ArrayXd *dlambda_dRe) const {
+    lambda.resize(Re.size());
+    if (dlambda_dRe != nullptr) {
+      dlambda_dRe->resize(Re.size());
+    }
+    for (Eigen::Index i = 0; i != Re.size(); ++i) {
+      if (not covers(Re[i])) {
+        continue;
+      }
+      double u;
+      double du_dRe;
+      auto const piece = locate(Re[i], u, du_dRe);
+      auto const c = coefficients.col(piece);
+      double value = c[degree];
+      double derivative = 0.0;
+      for (int j = degree - 1; j >= 0; --j) {
+        derivative = derivative * u + value;
+        value = value * u + c[j];
+      }
+      lambda[i] = value;
+      if (dlambda_dRe != nullptr) {
+        (*dlambda_dRe)[i] = derivative * du_dRe;
+      }
+    }
+  }
+
+  int Frictionapproximation::get_pieces_per_octave() const {
+    return pieces_per_octave;
+  }
+
+} // namespace Model::Balancelaw
@@ -18,12 +18,30 @@
 #include "Exception.hpp"
 #include "Mathfunctions.hpp"
 #include "unit_conversion.hpp"
+#include <type_traits>
 
 namespace Model::Balancelaw {
 
   Isothermaleulerequation::Isothermaleulerequation(nlohmann::json const &json) :
       diameter(Aux::unit::length.parse_to_si(json["diameter"])),
-      roughness(Aux::unit::length.parse_to_si(json["roughness"])) {}
+      roughness(Aux::unit::length.parse_to_si(json["roughness"])),
+      constants(diameter, roughness),
+      friction_approximation(
+          json.value("balancelaw", "") == approximated_friction
+              ? std::make_optional<Frictionapproximation>(
+                  diameter, roughness, turbulent_border)
+              : std::nullopt) {}
+
+  Isothermaleulerequation::Pipeconstants::Pipeconstants(
+      double diameter, double roughness) :
+      Area(Aux::circle_area(0.5 * diameter)),
+      rho_0_by_Area(rho_0 / Area),
+      Area_by_rho_0(Area / rho_0),
+      Reynolds_coefficient(coeff_of_Reynolds(diameter)),
+      friction_factor(rho_0 / (2 * Area * diameter)),
+      laminar_factor(friction_factor * 64 / Reynolds_coefficient),
+      roughness_term(roughness / (3.7 * diameter)),
+      spline_coefficients(get_coefficients(diameter, roughness)) {}
 
   Eigen::Matrix4d const Isothermaleulerequation::set_coeff_helper_matrix() {
     double a = laminar_border;
@@ -50,88 +68,157 @@ namespace Model::Balancelaw {
     return coeff_helper_matrix.lu().solve(spline_constraints);
   }
 
-  Eigen::Vector2d
-  Isothermaleulerequation::flux(Eigen::Ref<Eigen::Vector2d const> state) const {
+  static double value_of(double x) { return x; }
+  static double value_of(Dual<2> const &x) { return x.value(); }
 
-    double rho = state[0];
-    double q = state[1];
+  template <typename Scalar>
+  Eigen::Vector<Scalar, 2> Isothermaleulerequation::evaluate_flux(
+      Eigen::Vector<Scalar, 2> const &state) const {
 
-    Eigen::Vector2d flux;
+    Scalar const &rho = state[0];
+    Scalar const &q = state[1];
 
-    auto Area = Aux::circle_area(0.5 * diameter);
-    flux[0] = rho_0 / Area * q;
-    flux[1] = Area / rho_0 * p(rho) + (rho_0 / Area) * q * q / rho;
-    return flux;
-  }
+    Eigen::Vector<Scalar, 2> flux;
 
-  Eigen::Matrix2d Isothermaleulerequation::dflux_dstate(
-      Eigen::Ref<Eigen::Vector2d const> state) const {
-
-    double rho = state[0];
-    double q = state[1];
-
-    Eigen::Matrix2d dflux;
-    auto Area = Aux::circle_area(0.5 * diameter);
-    dflux(0, 0) = 0.0;
-    dflux(0, 1) = rho_0 / Area;
-    dflux(1, 0)
-        = Area / rho_0 * dp_drho(rho) - rho_0 / Area * q * q / (rho * rho);
-    dflux(1, 1) = 2 * rho_0 / Area * q / rho;
-    return dflux;
+    // The pressure, see p():
+    Scalar const p_of_rho
+        = c_vac_squared * rho / (1 - alpha * c_vac_squared * rho);
+    flux[0] = constants.rho_0_by_Area * q;
+    flux[1] = constants.Area_by_rho_0 * p_of_rho
+              + constants.rho_0_by_Area * q * q / rho;
+    return flux;
   }
 
-  Eigen::Vector2d Isothermaleulerequation::source(
-      Eigen::Ref<Eigen::Vector2d const> state) const {
+  template <typename Scalar>
+  Eigen::Vector<Scalar, 2> Isothermaleulerequation::evaluate_source(
+      Eigen::Vector<Scalar, 2> const &state) const {
 
-    double rho = state[0];
-    double q = state[1];
-    double Re = Reynolds(q, diameter);
+    using std::abs;
+    Scalar const &rho = state[0];
+    Scalar const &q = state[1];
+    Scalar const abs_q = abs(q);
+    double Re = constants.Reynolds_coefficient * value_of(abs_q);
 
-    Eigen::Vector2d source;
-    source[0] = 0.0;
-    auto Area = Aux::circle_area(0.5 * diameter);
+    Eigen::Vector<Scalar, 2> source;
+    source[0] = Scalar(0.0);
     if (Re < laminar_border) { // laminar, that is linear friction:
-      source[1] = -rho_0 / (2 * Area * diameter) * 64
-                  / coeff_of_Reynolds(diameter) * q / rho;
+      source[1] = -constants.laminar_factor * q / rho;
     } else { // transitional and turbulent friction:
-      source[1] = -rho_0 / (2 * Area * diameter)
-                  * lambda_non_laminar(Re, diameter, roughness) * std::abs(q)
-                  * q / rho;
+      // The friction factor only depends on Re, so it is differentiated by
+      // the chain rule:
+      Scalar lambda;
+      if constexpr (std::is_same_v<Scalar, double>) {
+        lambda = lambda_non_laminar(Re);
+      } else {
+        lambda = Scalar(
+            lambda_non_laminar(Re), dlambda_non_laminar_dRe(Re)
+                                        * constants.Reynolds_coefficient
+                                        * abs_q.derivatives());
+      }
+      source[1] = -constants.friction_factor * lambda * abs_q * q / rho;
     }
     return source;
   }
 
-  Eigen::Matrix2d Isothermaleulerequation::dsource_dstate(
-      Eigen::Ref<Eigen::Vector2d const> state) const {
-    double rho = state[0];
-    double q = state[1];
-
-    double Re = Reynolds(q, diameter);
-    Eigen::Matrix2d dsource;
-    dsource(0, 0) = 0;
-    dsource(0, 1) = 0;
+  template Eigen::Vector<double, 2>
+  Isothermaleulerequation::evaluate_flux<double>(
+      Eigen::Vector<double, 2> const &state) const;
+  template Eigen::Vector<Dual<2>, 2>
+  Isothermaleulerequation::evaluate_flux<Dual<2>>(
+      Eigen::Vector<Dual<2>, 2> const &state) const;
+  template Eigen::Vector<double, 2>
+  Isothermaleulerequation::evaluate_source<double>(
+      Eigen::Vector<double, 2> const &state) const;
+  template Eigen::Vector<Dual<2>, 2>
+  Isothermaleulerequation::evaluate_source<Dual<2>>(
+      Eigen::Vector<Dual<2>, 2> const &state) const;
+
+  void Isothermaleulerequation::lambda_non_laminar_at_points(
+      Eigen::ArrayXd const &Re, Eigen::ArrayXd &lambda,
+      Eigen::ArrayXd *dlambda_dRe) const {
+    // The cubic spline between the laminar and the turbulent regime:
+    Eigen::Vector4d const &c = constants.spline_coefficients;
+    auto const transitional
+        = c[0] * Re * Re * Re + c[1] * Re * Re + c[2] * Re + c[3];
+    auto const dtransitional = 3 * c[0] * Re * Re + 2 * c[1] * Re + c[2];
+    auto const turbulent = Re > turbulent_border;
+    if (friction_approximation
+        and (Re < Frictionapproximation::max_Reynolds).all()) {
+      Eigen::ArrayXd turbulent_lambda;
+      Eigen::ArrayXd turbulent_dlambda_dRe;
+      friction_approximation->lambda_at_points(
+          Re, turbulent_lambda,
+          dlambda_dRe != nullptr ? &turbulent_dlambda_dRe : nullptr);
+      lambda = turbulent.select(turbulent_lambda, transitional);
+      if (dlambda_dRe != nullptr) {
+        *dlambda_dRe = turbulent.select(turbulent_dlambda_dRe, dtransitional);
+      }
+      return;
+    }
+    // Swamee-Jain, written like in Swamee_Jain and dSwamee_Jain_dRe:
+    Eigen::ArrayXd const x = (Re.log() * 0.9).exp();
+    Eigen::ArrayXd const a = constants.roughness_term + 5.74 / x;
+    Eigen::ArrayXd const aux = a.log10();
+    lambda = turbulent.select(0.25 / (aux * aux), transitional);
+    if (dlambda_dRe == nullptr) {
+      return;
+    }
+    auto const daux_dRe = 1 / (log(10) * a) * (-5.74 / (x * x)) * 0.9 * x / Re;
+    *dlambda_dRe = turbulent.select(
+        -0.5 / (aux * aux * aux) * daux_dRe, dtransitional);
+  }
 
-    auto Area = Aux::circle_area(0.5 * diameter);
+  void Isothermaleulerequation::flux_and_source_at_points(
+      Eigen::Ref<Eigen::ArrayXd const> const &rho,
+      Eigen::Ref<Eigen::ArrayXd const> const &q, Pointvalues &values) const {
+    auto const p_of_rho
+        = c_vac_squared * rho / (1 - alpha * c_vac_squared * rho);
+    values.flux0 = constants.rho_0_by_Area * q;
+    values.flux1 = constants.Area_by_rho_0 * p_of_rho
+                   + constants.rho_0_by_Area * q * q / rho;
+
+    Eigen::ArrayXd const Re = constants.Reynolds_coefficient * q.abs();
+    Eigen::ArrayXd lambda;
+    lambda_non_laminar_at_points(Re, lambda, nullptr);
+    values.source1
+        = (Re < laminar_border)
+              .select(
+                  -constants.laminar_factor * q / rho,
+                  -constants.friction_factor * lambda * q.abs() * q / rho);
+  }
 
-    if (Re < laminar_border) { // laminar, that is, linear friction:
-      dsource(1, 0) = rho_0 / (2 * Area * diameter) * 64
-                      / coeff_of_Reynolds(diameter) * q / (rho * rho);
-      dsource(1, 1) = -rho_0 / (2 * Area * diameter) * 64
-                      / coeff_of_Reynolds(diameter) / rho;
-    } else { // transitional and turbulent friction:
-      dsource(1, 0) = rho_0 / (2 * Area * diameter)
-                      * lambda_non_laminar(Re, diameter, roughness)
-                      * std::abs(q) * q / (rho * rho);
-
-      dsource(1, 1)
-          = -rho_0 / (2 * Area * diameter) / rho
-            * (dlambda_non_laminar_dRe(Re, diameter, roughness)
-                   * dReynolds_dq(q, diameter) * std::abs(q) * q
-               + lambda_non_laminar(Re, diameter, roughness) * Aux::dabs_dx(q)
-                     * q
-               + lambda_non_laminar(Re, diameter, roughness) * std::abs(q));
-    }
-    return dsource;
+  void Isothermaleulerequation::flux_and_source_with_derivatives_at_points(
+      Eigen::Ref<Eigen::ArrayXd const> const &rho,
+      Eigen::Ref<Eigen::ArrayXd const> const &q, Pointvalues &values) const {
+    auto const D = 1 - alpha * c_vac_squared * rho;
+    values.flux0 = constants.rho_0_by_Area * q;
+    values.flux1 = constants.Area_by_rho_0 * (c_vac_squared * rho / D)
+                   + constants.rho_0_by_Area * q * q / rho;
+    values.dflux01 = constants.rho_0_by_Area;
+    values.dflux10 = constants.Area_by_rho_0 * (c_vac_squared / (D * D))
+                     - constants.rho_0_by_Area * q * q / (rho * rho);
+    values.dflux11 = 2 * constants.rho_0_by_Area * q / rho;
+
+    auto const coefficient = constants.Reynolds_coefficient;
+    Eigen::ArrayXd const Re = coefficient * q.abs();
+    Eigen::ArrayXd lambda;
+    Eigen::ArrayXd dlambda_dRe;
+    lambda_non_laminar_at_points(Re, lambda, &dlambda_dRe);
+    auto const laminar = Re < laminar_border;
+    auto const factor = constants.friction_factor;
+    auto const laminar_factor = constants.laminar_factor;
+    // The sign of q, that is the derivative of its absolute value:
+    auto const dabs_dq = (q > 0).cast<double>() - (q < 0).cast<double>();
+    values.source1 = laminar.select(
+        -laminar_factor * q / rho, -factor * lambda * q.abs() * q / rho);
+    values.dsource10 = laminar.select(
+        laminar_factor * q / (rho * rho),
+        factor * lambda * q.abs() * q / (rho * rho));
+    values.dsource11 = laminar.select(
+        -laminar_factor / rho,
+        -factor / rho
+            * (dlambda_dRe * (coefficient * dabs_dq) * q.abs() * q
+               + lambda * dabs_dq * q + lambda * q.abs()));
   }
 
   Eigen::Vector2d Isothermaleulerequation::p_qvol(
@@ -230,6 +317,35 @@ namespace Model::Balancelaw {
     rho = p / (c_vac_squared * (1 + alpha * p));
     return rho;
   }
+  double Isothermaleulerequation::lambda_non_laminar(double Re) const {
+    if (Re > turbulent_border) {
+      if (friction_approximation and friction_approximation->covers(Re)) {
+        return friction_approximation->lambda(Re);
+      }
+      double aux = log10(constants.roughness_term + 5.74 / (pow(Re, 0.9)));
+      return 0.25 / (aux * aux);
+    } else {
+      Eigen::Vector4d monomials(Re * Re * Re, Re * Re, Re, 1);
+      return constants.spline_coefficients.dot(monomials);
+    }
+  }
+
+  double Isothermaleulerequation::dlambda_non_laminar_dRe(double Re) const {
+    if (Re > turbulent_border) {
+      if (friction_approximation and friction_approximation->covers(Re)) {
+        return friction_approximation->dlambda_dRe(Re);
+      }
+      double x = exp(log(Re) * 0.9);
+      double a = constants.roughness_term + 5.74 / x;
+      double aux = log10(a);
+      double daux_dRe = 1 / (log(10) * a) * (-5.74 / (x * x)) * 0.9 * x / Re;
+      return -0.5 / (aux * aux * aux) * daux_dRe;
+    } else {
+      Eigen::Vector4d monomials(3 * Re * Re, 2 * Re, 1, 0);
+      return constants.spline_coefficients.dot(monomials);
+    }
+  }
+
   double Isothermaleulerequation::lambda_non_laminar(
       double Re, double diameter, double roughness) {
 
@@ -316,7 +432,7 @@ namespace Model::Balancelaw {
     double x = exp(log(Re) * 0.9);
     double a = roughness / (3.7 * diameter) + 5.74 / x;
     double aux = log10(a);
-    double daux_dRe = 1 / log(10) * a * (-5.74 / (x * x)) * 0.9 * x / Re;
+    double daux_dRe = 1 / (log(10) * a) * (-5.74 / (x * x)) * 0.9 * x / Re;
     double dlambda_dRe = -0.5 / (aux * aux * aux) * daux_dRe;
     return dlambda_dRe;
   }
@@ -17,6 +17,7 @@
 #pragma once
 #include <Eigen/Dense>
 #include <Eigen/src/Core/util/Constants.h>
+#include <unsupported/Eigen/AutoDiff>
 
 namespace Model::Balancelaw {
 
@@ -38,5 +39,107 @@ namespace Model::Balancelaw {
     virtual Eigen::Matrix<double, Dimension, Dimension> dsource_dstate(
         Eigen::Ref<Eigen::Vector<double, Dimension> const> state) const
         = 0;
+
+    /// \brief Computes #flux, #source and their derivatives at once.
+    ///
+    /// The default calls the four functions, balance laws can override it to
+    /// share intermediate results between them.
+    virtual void flux_and_source_with_derivatives(
+        Eigen::Ref<Eigen::Vector<double, Dimension> const> state,
+        Eigen::Ref<Eigen::Vector<double, Dimension>> flux_vector,
+        Eigen::Ref<Eigen::Matrix<double, Dimension, Dimension>> dflux,
+        Eigen::Ref<Eigen::Vector<double, Dimension>> source_vector,
+        Eigen::Ref<Eigen::Matrix<double, Dimension, Dimension>> dsource) const {
+      flux_vector = flux(state);
+      dflux = dflux_dstate(state);
+      source_vector = source(state);
+      dsource = dsource_dstate(state);
+    }
+  };
+
+  /// A forward-mode dual number, which carries the derivatives with respect
+  /// to the Dimension entries of a state.
+  template <int Dimension>
+  using Dual = Eigen::AutoDiffScalar<Eigen::Vector<double, Dimension>>;
+
+  /** \brief Implements the Balancelaw interface for a balance law Derived,
+   * which only defines flux and source as templates on the scalar type:
+   *
+   * \code{.cpp}
+   * template <typename Scalar>
+   * Eigen::Vector<Scalar, Dimension>
+   * evaluate_flux(Eigen::Vector<Scalar, Dimension> const &state) const;
+   * \endcode
+   * and evaluate_source() likewise.
+   *
+   * The derivatives are computed by evaluating these on Dual numbers, which
+   * yields value and derivative of flux and source in one pass and needs no
+   * hand-written derivatives.
+   */
+  template <typename Derived, int Dimension>
+  class Dualbalancelaw : public Balancelaw<Dimension> {
+  public:
+    Eigen::Vector<double, Dimension>
+    flux(Eigen::Ref<Eigen::Vector<double, Dimension> const> state) const final {
+      return derived().evaluate_flux(Eigen::Vector<double, Dimension>(state));
+    }
+
+    Eigen::Matrix<double, Dimension, Dimension> dflux_dstate(
+        Eigen::Ref<Eigen::Vector<double, Dimension> const> state) const final {
+      return jacobian(derived().evaluate_flux(seed(state)));
+    }
+
+    Eigen::Vector<double, Dimension> source(
+        Eigen::Ref<Eigen::Vector<double, Dimension> const> state) const final {
+      return derived().evaluate_source(
+          Eigen::Vector<double, Dimension>(state));
+    }
+
+    Eigen::Matrix<double, Dimension, Dimension> dsource_dstate(
+        Eigen::Ref<Eigen::Vector<double, Dimension> const> state) const final {
+      return jacobian(derived().evaluate_source(seed(state)));
+    }
+
+    void flux_and_source_with_derivatives(
+        Eigen::Ref<Eigen::Vector<double, Dimension> const> state,
+        Eigen::Ref<Eigen::Vector<double, Dimension>> flux_vector,
+        Eigen::Ref<Eigen::Matrix<double, Dimension, Dimension>> dflux,
+        Eigen::Ref<Eigen::Vector<double, Dimension>> source_vector,
+        Eigen::Ref<Eigen::Matrix<double, Dimension, Dimension>> dsource)
+        const final {
+      auto const dual_state = seed(state);
+      auto const dual_flux = derived().evaluate_flux(dual_state);
+      auto const dual_source = derived().evaluate_source(dual_state);
+      for (int i = 0; i != Dimension; ++i) {
+        flux_vector[i] = dual_flux[i].value();
+        dflux.row(i) = dual_flux[i].derivatives().transpose();
+        source_vector[i] = dual_source[i].value();
+        dsource.row(i) = dual_source[i].derivatives().transpose();
+      }
+    }
+
+  private:
+    Derived const &derived() const {
+      return static_cast<Derived const &>(*this);
+    }
+
+    /// The state as dual numbers, whose derivatives are the unit vectors.
+    static Eigen::Vector<Dual<Dimension>, Dimension>
+    seed(Eigen::Ref<Eigen::Vector<double, Dimension> const> state) {
+      Eigen::Vector<Dual<Dimension>, Dimension> dual_state;
+      for (int i = 0; i != Dimension; ++i) {
+        dual_state[i] = Dual<Dimension>(state[i], Dimension, i);
+      }
+      return dual_state;
+    }
+
+    static Eigen::Matrix<double, Dimension, Dimension>
+    jacobian(Eigen::Vector<Dual<Dimension>, Dimension> const &dual_vector) {
+      Eigen::Matrix<double, Dimension, Dimension> jacobian;
+      for (int i = 0; i != Dimension; ++i) {
+        jacobian.row(i) = dual_vector[i].derivatives().transpose();
+      }
+      return jacobian;
+    }
   };
 } // namespace Model::Balancelaw
@@ -0,0 +1,81 @@
+/*
+ * Grazer - network simulation and optimization tool
+ *
+ * Copyright 2020-2022 Uni Mannheim <e.fokken+grazer@posteo.de>,
+ *
+ * SPDX-License-Identifier:	MIT
+ *
+ * Licensed under the MIT License, found in the file LICENSE and at
+ * https://opensource.org/licenses/MIT
+ * This file may not be copied, modified, or distributed except according to
+ * those terms.
+ *
+ * Distributed on an "AS IS" BASIS, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied.  See your chosen license for details.
+ *
+ */
+#pragma once
+#include <Eigen/Dense>
+
+namespace Model::Balancelaw {
+
+  /** \brief A piecewise polynomial approximation of the Swamee-Jain friction
+   * factor of a pipe, which needs no transcendental functions.
+   *
+   * Every octave [2^(e-1), 2^e) of Reynolds numbers is split into equally
+   * long pieces, on each of which lambda is interpolated by a polynomial of
+   * degree #degree. The piece of a Reynolds number is found from its binary
+   * exponent. The number of pieces per octave is doubled in the constructor
+   * until the relative error of lambda is below #max_relative_error on a
+   * fine grid of every piece.
+   *
+   * The approximation covers the Reynolds numbers in [min_Reynolds,
+   * #max_Reynolds], outside of it the exact formula has to be used.
+   */
+  class Frictionapproximation {
+  public:
+    static constexpr int degree{5};
+    static constexpr double max_relative_error{1e-8};
+    static constexpr int max_exponent{30};
+    static constexpr double max_Reynolds{1073741824.0}; // 2^max_exponent
+
+    Frictionapproximation(
+        double diameter, double roughness, double min_Reynolds);
+
+    /// Whether Re lies in the range of the approximation.
+    bool covers(double Re) const;
+
+    /// Approximates Isothermaleulerequation::Swamee_Jain.
+    double lambda(double Re) const;
+    /// The derivative of #lambda, which approximates
+    /// Isothermaleulerequation::dSwamee_Jain_dRe.
+    double dlambda_dRe(double Re) const;
+
+    /** \brief Computes #lambda and, if dlambda_dRe is not null, also
+     * #dlambda_dRe at all Reynolds numbers Re.
+     *
+     * Entries with Re outside of the range hold meaningless values.
+     */
+    void lambda_at_points(
+        Eigen::ArrayXd const &Re, Eigen::ArrayXd &lambda,
+        Eigen::ArrayXd *dlambda_dRe) const;
+
+    int get_pieces_per_octave() const;
+
+  private:
+    /** \brief Finds the piece of Re and its position u in [-1, 1] there.
+     *
+     * @returns the index of the piece, sets u and du_dRe.
+     */
+    Eigen::Index locate(double Re, double &u, double &du_dRe) const;
+
+    double const min_Reynolds;
+    /// The binary exponent e of the first octave [2^(e-1), 2^e).
+    int const first_exponent;
+    int pieces_per_octave;
+    /// The monomial coefficients in u of all pieces, one column per piece.
+    Eigen::Matrix<double, degree + 1, Eigen::Dynamic> coefficients;
+    /// The derivative of u by Re on each octave.
+    Eigen::VectorXd du_dRe_of_octave;
+  };
+} // namespace Model::Balancelaw
@@ -16,23 +16,69 @@
  */
 #pragma once
 #include "Balancelaw.hpp"
+#include "Frictionapproximation.hpp"
 #include <Eigen/Dense>
 #include <nlohmann/json.hpp>
+#include <optional>
 
 namespace Model::Balancelaw {
 
-  class Isothermaleulerequation : public Balancelaw<2> {
+  class Isothermaleulerequation :
+      public Dualbalancelaw<Isothermaleulerequation, 2> {
 
   public:
-    Isothermaleulerequation(nlohmann::json const &json);
+    /** \brief Flux, source and their derivatives at many states, one array
+     * per entry, so that they can be computed for all states at once.
+     *
+     * The entries flux(0), source(0), dflux(0, 0), dsource(0, 0) and
+     * dsource(0, 1) are zero at every state, dflux(0, 1) is the same at
+     * every state.
+     */
+    struct Pointvalues {
+      Eigen::ArrayXd flux0;
+      Eigen::ArrayXd flux1;
+      Eigen::ArrayXd source1;
+      double dflux01;
+      Eigen::ArrayXd dflux10;
+      Eigen::ArrayXd dflux11;
+      Eigen::ArrayXd dsource10;
+      Eigen::ArrayXd dsource11;
+    };
+
+    /** \brief The "balancelaw" of a pipe, for which the turbulent friction
+     * factor is computed by a Frictionapproximation instead of Swamee-Jain.
+     */
+    static constexpr char const *approximated_friction{
+        "Isothermaleulerequation_approximated"};
 
-    Eigen::Vector2d flux(Eigen::Ref<Eigen::Vector2d const> state) const final;
-    Eigen::Matrix2d
-    dflux_dstate(Eigen::Ref<Eigen::Vector2d const> state) const final;
+    Isothermaleulerequation(nlohmann::json const &json);
 
-    Eigen::Vector2d source(Eigen::Ref<Eigen::Vector2d const> state) const final;
-    Eigen::Matrix2d
-    dsource_dstate(Eigen::Ref<Eigen::Vector2d const> state) const final;
+    /// \brief The flux at state, for Scalar double or Dual<2>, see
+    /// Dualbalancelaw.
+    template <typename Scalar>
+    Eigen::Vector<Scalar, 2>
+    evaluate_flux(Eigen::Vector<Scalar, 2> const &state) const;
+
+    /// \brief The source at state, for Scalar double or Dual<2>, see
+    /// Dualbalancelaw.
+    template <typename Scalar>
+    Eigen::Vector<Scalar, 2>
+    evaluate_source(Eigen::Vector<Scalar, 2> const &state) const;
+
+    /// \brief Computes flux and source at the states (rho[k], q[k]) into
+    /// values.flux0, values.flux1 and values.source1.
+    ///
+    /// The arrays are processed as a whole, which Eigen vectorizes, including
+    /// the logarithms and powers of the friction factor.
+    void flux_and_source_at_points(
+        Eigen::Ref<Eigen::ArrayXd const> const &rho,
+        Eigen::Ref<Eigen::ArrayXd const> const &q, Pointvalues &values) const;
+
+    /// \brief Like #flux_and_source_at_points, but also fills in the
+    /// derivatives.
+    void flux_and_source_with_derivatives_at_points(
+        Eigen::Ref<Eigen::ArrayXd const> const &rho,
+        Eigen::Ref<Eigen::ArrayXd const> const &q, Pointvalues &values) const;
 
     Eigen::Vector2d p_qvol(Eigen::Ref<Eigen::Vector2d const> state) const;
     Eigen::Matrix2d
@@ -91,8 +137,51 @@ namespace Model::Balancelaw {
     double const diameter;
     double const roughness;
 
+    /** \brief The factors of the flux and the source, which only depend on
+     * the pipe and are therefore computed once in the constructor.
+     */
+    struct Pipeconstants {
+      Pipeconstants(double diameter, double roughness);
+
+      /// The cross-sectional area of the pipe.
+      double Area;
+      double rho_0_by_Area;
+      double Area_by_rho_0;
+      /// Re = Reynolds_coefficient * |q|.
+      double Reynolds_coefficient;
+      /// source[1] = -friction_factor * lambda * |q| * q / rho.
+      double friction_factor;
+      /// source[1] = -laminar_factor * q / rho in the laminar regime.
+      double laminar_factor;
+      /// The roughness term roughness / (3.7 * diameter) of Swamee-Jain.
+      double roughness_term;
+      /// The cubic spline of lambda in the transitional regime.
+      Eigen::Vector4d spline_coefficients;
+    };
+
+    Pipeconstants const constants;
+
+    /// Only holds a value for the balance law #approximated_friction.
+    std::optional<Frictionapproximation> const friction_approximation;
+
+    /// Same as the static lambda_non_laminar(), but with the precomputed
+    /// #constants and without the check for the laminar regime.
+    double lambda_non_laminar(double Re) const;
+    /// Same as the static dlambda_non_laminar_dRe(), but with the
+    /// precomputed #constants and without the check for the laminar regime.
+    double dlambda_non_laminar_dRe(double Re) const;
+
     static Eigen::Vector4d get_coefficients(double diameter, double roughness);
 
+    /** \brief Computes lambda_non_laminar() at all Reynolds numbers Re and,
+     * if dlambda_dRe is not null, also dlambda_non_laminar_dRe().
+     *
+     * Entries with Re below the laminar border hold meaningless values.
+     */
+    void lambda_non_laminar_at_points(
+        Eigen::ArrayXd const &Re, Eigen::ArrayXd &lambda,
+        Eigen::ArrayXd *dlambda_dRe) const;
+
     static constexpr double laminar_border{2000.0};
     static constexpr double turbulent_border{4000.0};
 
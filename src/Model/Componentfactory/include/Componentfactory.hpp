@@ -411,7 +411,12 @@ namespace Model::Componentfactory {
       // order is important (defaults can be required!)
       Aux::schema::validate_json(topology, topology_schema);
       check_class_hierarchy_properties<ConcreteEdge>();
-      return std::make_unique<ConcreteEdge>(topology, nodes);
+      // Abstract edges choose their concrete subclass from the topology:
+      if constexpr (std::is_abstract_v<ConcreteEdge>) {
+        return ConcreteEdge::make_instance(topology, nodes);
+      } else {
+        return std::make_unique<ConcreteEdge>(topology, nodes);
+      }
     };
   };
 
@@ -25,6 +25,22 @@ namespace Model {
       Eigen::Ref<Eigen::VectorXd const> const & /*last_state*/,
       Eigen::Ref<Eigen::VectorXd const> const & /*control*/) {}
 
+  void Controlcomponent::evaluate_with_derivative(
+      Eigen::Ref<Eigen::VectorXd> rootvalues,
+      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Eigen::Ref<Eigen::VectorXd const> const &control) const {
+    evaluate(rootvalues, last_time, new_time, last_state, new_state, control);
+    d_evaluate_d_new_state(
+        jacobianhandler, last_time, new_time, last_state, new_state, control);
+  }
+
+  std::vector<std::vector<std::pair<Eigen::Index, Eigen::Index>>>
+  Controlcomponent::get_subdomains(int /*number_of_subdomains*/) const {
+    return {};
+  }
+
   Eigen::Index Controlcomponent::get_number_of_controls_per_timepoint() const {
     return get_control_afterindex() - get_control_startindex();
   }
@@ -26,4 +26,14 @@ namespace Model {
       double /*last_time*/, double /*new_time*/,
       Eigen::Ref<Eigen::VectorXd const> const & /*last_state*/) {}
 
+  void Equationcomponent::evaluate_with_derivative(
+      Eigen::Ref<Eigen::VectorXd> rootvalues,
+      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+    evaluate(rootvalues, last_time, new_time, last_state, new_state);
+    d_evaluate_d_new_state(
+        jacobianhandler, last_time, new_time, last_state, new_state);
+  }
+
 } // namespace Model
@@ -19,6 +19,8 @@
 #include "Timedata.hpp"
 #include <Eigen/Dense>
 #include <nlohmann/json.hpp>
+#include <utility>
+#include <vector>
 
 namespace Aux {
   class InterpolatingVector_Base;
@@ -119,6 +121,32 @@ namespace Model {
         Eigen::Ref<Eigen::VectorXd const> const &control) const
         = 0;
 
+    /** \brief Does the work of Controlcomponent::evaluate and
+     * Controlcomponent::d_evaluate_d_new_state in one pass.
+     *
+     * The default implementation calls the two functions. Components, whose
+     * equations and derivatives share expensive intermediate results, should
+     * override it. Overrides must add the same coefficients in the same order
+     * as Controlcomponent::d_evaluate_d_new_state.
+     *
+     * @param[out] rootvalues Results of the model equations, when evaluated
+     * on the other parameters.
+     * @param jacobianhandler A helper object, that fills a sparse matrix
+     * in an efficient way.
+     * @param last_time time point of the last time step. Usually important
+     * for PDEs
+     * @param new_time time point of the current time step.
+     * @param last_state value of the state at last time step.
+     * @param new_state value of the state at current time step.
+     * @param control value of the control at current time step.
+     */
+    virtual void evaluate_with_derivative(
+        Eigen::Ref<Eigen::VectorXd> rootvalues,
+        Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+        Eigen::Ref<Eigen::VectorXd const> const &last_state,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state,
+        Eigen::Ref<Eigen::VectorXd const> const &control) const;
+
     /** \brief derivative of Controlcomponent::evaluate w.r.t. \p control.
      *
      * evaluates the derivative of Controlcomponent::evaluate and hands
@@ -140,6 +168,16 @@ namespace Model {
         Eigen::Ref<Eigen::VectorXd const> const &control) const
         = 0;
 
+    /** \brief Splits the states into at most number_of_subdomains subdomains
+     * with few couplings between them, for the linear solver
+     * "DomainDecomposition".
+     *
+     * Each subdomain is a list of state index ranges [first, after).
+     * Defaults to no subdomains, so that all states form the interface.
+     */
+    virtual std::vector<std::vector<std::pair<Eigen::Index, Eigen::Index>>>
+    get_subdomains(int number_of_subdomains) const;
+
     /** \brief This function sets the indices #start_control_index and
      * #after_control_index.
      *
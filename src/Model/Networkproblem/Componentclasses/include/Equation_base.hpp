@@ -15,8 +15,11 @@
  *
  */
 #pragma once
+#include <Eigen/Core>
 #include <nlohmann/json.hpp>
 #include <optional>
+#include <utility>
+#include <vector>
 namespace Model {
 
   /** Base class for Equationcomponent and Controlcomponent
@@ -36,6 +39,19 @@ namespace Model {
      * claim indices from their attached gas edges.
      */
     virtual void setup() = 0;
+
+    /** \brief Ranges [first, after) of equation and state indices, that may
+     * be eliminated by static condensation.
+     *
+     * Each range must be square, hold whole pairs of indices and its block
+     * in the jacobian must be block tridiagonal with 2x2 blocks, as on the
+     * interior of a pipe. See the linear solver "Condensation".
+     * Defaults to no ranges.
+     */
+    virtual std::vector<std::pair<Eigen::Index, Eigen::Index>>
+    get_condensable_ranges() const {
+      return {};
+    }
   };
 
 } // namespace Model
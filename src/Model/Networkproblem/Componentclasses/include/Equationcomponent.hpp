@@ -113,6 +113,30 @@ namespace Model {
         Eigen::Ref<Eigen::VectorXd const> const &last_state,
         Eigen::Ref<Eigen::VectorXd const> const &new_state) const
         = 0;
+
+    /** \brief Does the work of Equationcomponent::evaluate and
+     * Equationcomponent::d_evaluate_d_new_state in one pass.
+     *
+     * The default implementation calls the two functions. Components, whose
+     * equations and derivatives share expensive intermediate results, should
+     * override it. Overrides must add the same coefficients in the same order
+     * as Equationcomponent::d_evaluate_d_new_state.
+     *
+     * @param[out] rootvalues Results of the model equations, when evaluated on
+     * the other parameters.
+     * @param jacobianhandler A helper object, that fills a sparse matrix
+     * in an efficient way.
+     * @param last_time time point of the last time step. Usually important
+     * for PDEs
+     * @param new_time time point of the current time step.
+     * @param last_state value of the state at last time step.
+     * @param new_state value of the state at current time step.
+     */
+    virtual void evaluate_with_derivative(
+        Eigen::Ref<Eigen::VectorXd> rootvalues,
+        Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+        Eigen::Ref<Eigen::VectorXd const> const &last_state,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state) const;
   };
 
 } // namespace Model
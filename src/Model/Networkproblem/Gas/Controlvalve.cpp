@@ -56,6 +56,9 @@ namespace Model::Gas {
       const Eigen::Ref<const Eigen::VectorXd> & /*last_state*/,
       const Eigen::Ref<const Eigen::VectorXd> & /*new_state*/,
       const Eigen::Ref<const Eigen::VectorXd> & /*control*/) const {
+    if (jacobianhandler.constants_recorded()) {
+      return;
+    }
     auto start_p_index = get_boundary_state_index(start);
     auto start_q_index = start_p_index + 1;
     auto end_p_index = get_boundary_state_index(end);
@@ -64,11 +67,14 @@ namespace Model::Gas {
     auto start_equation_index = get_equation_start_index();
     auto end_equation_index = start_equation_index + 1;
 
-    jacobianhandler.add_to_coefficient(
+    jacobianhandler.add_constant_to_coefficient(
         start_equation_index, start_p_index, -1.0);
-    jacobianhandler.add_to_coefficient(start_equation_index, end_p_index, 1.0);
-    jacobianhandler.add_to_coefficient(end_equation_index, start_q_index, -1.0);
-    jacobianhandler.add_to_coefficient(end_equation_index, end_q_index, 1.0);
+    jacobianhandler.add_constant_to_coefficient(
+        start_equation_index, end_p_index, 1.0);
+    jacobianhandler.add_constant_to_coefficient(
+        end_equation_index, start_q_index, -1.0);
+    jacobianhandler.add_constant_to_coefficient(
+        end_equation_index, end_q_index, 1.0);
   }
 
   void Controlvalve::d_evaluate_d_last_state(
@@ -84,10 +90,13 @@ namespace Model::Gas {
       Eigen::Ref<Eigen::VectorXd const> const & /*last_state*/,
       Eigen::Ref<Eigen::VectorXd const> const & /*new_state*/,
       Eigen::Ref<Eigen::VectorXd const> const & /*control*/) const {
+    if (jacobianhandler.constants_recorded()) {
+      return;
+    }
     auto start_equation_index = get_equation_start_index();
     auto pressure_control_index = get_control_startindex();
 
-    jacobianhandler.add_to_coefficient(
+    jacobianhandler.add_constant_to_coefficient(
         start_equation_index, pressure_control_index, 1.0);
   }
 
@@ -23,8 +23,7 @@
 #include "Isothermaleulerequation.hpp"
 #include "Mathfunctions.hpp"
 #include "Matrixhandler.hpp"
-#include "Scheme_factory.hpp"
-#include "Threepointscheme.hpp"
+#include "PipeT.hpp"
 #include "make_schema.hpp"
 #include "unit_conversion.hpp"
 
@@ -82,115 +81,36 @@ namespace Model::Gas {
       Delta_x(
           unit::length.parse_to_si(topology["length"])
           / (number_of_points - 1)),
-      isothermaleulerequation(topology),
-      scheme{Scheme::make_threepointscheme<2>(topology)} {}
+      isothermaleulerequation(topology) {}
 
   Pipe::~Pipe() {}
 
-  void Pipe::evaluate(
-      Eigen::Ref<Eigen::VectorXd> rootvalues, double last_time, double new_time,
-      Eigen::Ref<Eigen::VectorXd const> const &last_state,
-      Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
-    for (auto i = get_equation_start_index(); i != get_equation_after_index();
-         i += 2) {
-
-      auto rootvalue_segment = rootvalues.segment<2>(i);
-
-      auto last_left = last_state.segment<2>(i - 1);
-      auto last_right = last_state.segment<2>(i + 1);
-      auto new_left = new_state.segment<2>(i - 1);
-      auto new_right = new_state.segment<2>(i + 1);
-
-      scheme->evaluate_point(
-          rootvalue_segment, last_time, new_time, Delta_x, last_left,
-          last_right, new_left, new_right, isothermaleulerequation);
-    }
-  }
-
-  void Pipe::d_evaluate_d_new_state(
-      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
-      Eigen::Ref<Eigen::VectorXd const> const &last_state,
-      Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
-    for (auto i = get_equation_start_index(); i != get_equation_after_index();
-         i += 2) {
-      // maybe use Eigen::Ref here to avoid copies.
-      auto last_left = last_state.segment<2>(i - 1);
-      auto last_right = last_state.segment<2>(i + 1);
-      auto new_left = new_state.segment<2>(i - 1);
-      auto new_right = new_state.segment<2>(i + 1);
-
-      Eigen::Matrix2d current_derivative_left
-          = scheme->devaluate_point_d_new_left(
-              last_time, new_time, Delta_x, last_left, last_right, new_left,
-              new_right, isothermaleulerequation);
-
-      jacobianhandler.add_to_coefficient(
-          i, i - 1, current_derivative_left(0, 0));
-      jacobianhandler.add_to_coefficient(i, i, current_derivative_left(0, 1));
-      jacobianhandler.add_to_coefficient(
-          i + 1, i - 1, current_derivative_left(1, 0));
-      jacobianhandler.add_to_coefficient(
-          i + 1, i, current_derivative_left(1, 1));
-
-      Eigen::Matrix2d current_derivative_right
-          = scheme->devaluate_point_d_new_right(
-              last_time, new_time, Delta_x, last_left, last_right, new_left,
-              new_right, isothermaleulerequation);
-
-      jacobianhandler.add_to_coefficient(
-          i, i + 1, current_derivative_right(0, 0));
-      jacobianhandler.add_to_coefficient(
-          i, i + 2, current_derivative_right(0, 1));
-      jacobianhandler.add_to_coefficient(
-          i + 1, i + 1, current_derivative_right(1, 0));
-      jacobianhandler.add_to_coefficient(
-          i + 1, i + 2, current_derivative_right(1, 1));
+  std::unique_ptr<Pipe> Pipe::make_instance(
+      nlohmann::json const &topology,
+      std::vector<std::unique_ptr<Network::Node>> &nodes) {
+    // Both balance laws only differ in the friction factor:
+    if (topology["balancelaw"] != "Isothermaleulerequation"
+        and topology["balancelaw"]
+                != Balancelaw::Isothermaleulerequation::approximated_friction) {
+      gthrow({"Unknown type of balancelaw!"});
     }
-  }
-
-  void Pipe::d_evaluate_d_last_state(
-      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
-      Eigen::Ref<Eigen::VectorXd const> const &last_state,
-      Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
-    for (auto i = get_equation_start_index(); i != get_equation_after_index();
-         i += 2) {
-      // maybe use Eigen::Ref here to avoid copies.
-      auto last_left = last_state.segment<2>(i - 1);
-      auto last_right = last_state.segment<2>(i + 1);
-      auto new_left = new_state.segment<2>(i - 1);
-      auto new_right = new_state.segment<2>(i + 1);
-
-      Eigen::Matrix2d current_derivative_left
-          = scheme->devaluate_point_d_last_left(
-              last_time, new_time, Delta_x, last_left, last_right, new_left,
-              new_right, isothermaleulerequation);
-
-      jacobianhandler.add_to_coefficient(
-          i, i - 1, current_derivative_left(0, 0));
-      jacobianhandler.add_to_coefficient(i, i, current_derivative_left(0, 1));
-      jacobianhandler.add_to_coefficient(
-          i + 1, i - 1, current_derivative_left(1, 0));
-      jacobianhandler.add_to_coefficient(
-          i + 1, i, current_derivative_left(1, 1));
-
-      Eigen::Matrix2d current_derivative_right
-          = scheme->devaluate_point_d_last_right(
-              last_time, new_time, Delta_x, last_left, last_right, new_left,
-              new_right, isothermaleulerequation);
-
-      jacobianhandler.add_to_coefficient(
-          i, i + 1, current_derivative_right(0, 0));
-      jacobianhandler.add_to_coefficient(
-          i, i + 2, current_derivative_right(0, 1));
-      jacobianhandler.add_to_coefficient(
-          i + 1, i + 1, current_derivative_right(1, 0));
-      jacobianhandler.add_to_coefficient(
-          i + 1, i + 2, current_derivative_right(1, 1));
+    if (topology["scheme"] == "Implicitboxscheme") {
+      return std::make_unique<PipeT<
+          Scheme::Implicitboxscheme<2>, Balancelaw::Isothermaleulerequation>>(
+          topology, nodes);
     }
+    gthrow({"Unknown type of scheme!"});
   }
 
   void Pipe::setup() { setup_output_json_helper(get_id()); }
 
+  std::vector<std::pair<Eigen::Index, Eigen::Index>>
+  Pipe::get_condensable_ranges() const {
+    // The interior equations of a pipe only couple neighbouring pairs of
+    // interior states:
+    return {{get_equation_start_index(), get_equation_after_index()}};
+  }
+
   Eigen::Index Pipe::needed_number_of_states() const {
     return 2 * number_of_points;
   }
@@ -0,0 +1,297 @@
+/*
+ * Grazer - network simulation and optimization tool
+ *
+ * Copyright 2020-2022 Uni Mannheim <e.fokken+grazer@posteo.de>,
+ *
+ * SPDX-License-Identifier:	MIT
+ *
+ * Licensed under the MIT License, found in the file LICENSE and at
+ * https://opensource.org/licenses/MIT
+ * This file may not be copied, modified, or distributed except according to
+ * those terms.
+ *
+ * Distributed on an "AS IS" BASIS, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied.  See your chosen license for details.
+ *
+ */
+#include "PipeT.hpp"
+#include "Implicitboxscheme.hpp"
+#include "Isothermaleulerequation.hpp"
+#include "Matrixhandler.hpp"
+
+#include <Eigen/Dense>
+
+namespace Model::Gas {
+
+  template <typename Concretescheme, typename Concretelaw>
+  PipeT<Concretescheme, Concretelaw>::PipeT(
+      nlohmann::json const &topology,
+      std::vector<std::unique_ptr<Network::Node>> &nodes) :
+      Pipe(topology, nodes) {}
+
+  /** \brief Copies the densities and the flows of the points of a pipe,
+   * which alternate in state, into two contiguous arrays.
+   */
+  static void split_states(
+      Eigen::Ref<Eigen::VectorXd const> const &state, Eigen::Index first_index,
+      Eigen::Index number_of_points, Eigen::ArrayXd &rho, Eigen::ArrayXd &q) {
+    using Strided
+        = Eigen::Map<Eigen::ArrayXd const, 0, Eigen::InnerStride<2>>;
+    rho = Strided(state.data() + first_index, number_of_points);
+    q = Strided(state.data() + first_index + 1, number_of_points);
+  }
+
+  template <typename Concretescheme, typename Concretelaw>
+  void PipeT<Concretescheme, Concretelaw>::evaluate_box_scheme_at_points(
+      Eigen::Ref<Eigen::VectorXd> *rootvalues,
+      Aux::Matrixhandler *jacobianhandler, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+    // The cell between the points k and k + 1 has the equations
+    // first_equation + 2k and first_equation + 2k + 1.
+    auto const first_equation = get_equation_start_index();
+    Eigen::Index const points = number_of_points;
+    Eigen::Index const cells = points - 1;
+    double const Delta_t = new_time - last_time;
+
+    Eigen::ArrayXd new_rho;
+    Eigen::ArrayXd new_q;
+    split_states(new_state, first_equation - 1, points, new_rho, new_q);
+    Balancelaw::Isothermaleulerequation::Pointvalues values;
+    if (jacobianhandler != nullptr) {
+      isothermaleulerequation.flux_and_source_with_derivatives_at_points(
+          new_rho, new_q, values);
+    } else {
+      isothermaleulerequation.flux_and_source_at_points(
+          new_rho, new_q, values);
+    }
+
+    if (rootvalues != nullptr) {
+      Eigen::ArrayXd last_rho;
+      Eigen::ArrayXd last_q;
+      split_states(last_state, first_equation - 1, points, last_rho, last_q);
+      using Strided = Eigen::Map<Eigen::ArrayXd, 0, Eigen::InnerStride<2>>;
+      Strided result0(rootvalues->data() + first_equation, cells);
+      Strided result1(rootvalues->data() + first_equation + 1, cells);
+      // The source has no first component:
+      result0 = 0.5 * (new_rho.head(cells) + new_rho.tail(cells))
+                - 0.5 * (last_rho.head(cells) + last_rho.tail(cells))
+                - Delta_t / Delta_x
+                      * (values.flux0.head(cells) - values.flux0.tail(cells));
+      result1 = 0.5 * (new_q.head(cells) + new_q.tail(cells))
+                - 0.5 * (last_q.head(cells) + last_q.tail(cells))
+                - Delta_t / Delta_x
+                      * (values.flux1.head(cells) - values.flux1.tail(cells))
+                - 0.5 * Delta_t
+                      * (values.source1.tail(cells)
+                         + values.source1.head(cells));
+    }
+
+    if (jacobianhandler == nullptr) {
+      return;
+    }
+    // The derivatives of a cell with respect to its left and right point,
+    // see Scheme::Implicitboxscheme::evaluate_point_with_derivatives:
+    double const d_left01 = -Delta_t / Delta_x * values.dflux01;
+    double const d_right01 = Delta_t / Delta_x * values.dflux01;
+    Eigen::ArrayXd const d_left10 = -Delta_t / Delta_x * values.dflux10
+                                    - 0.5 * Delta_t * values.dsource10;
+    Eigen::ArrayXd const d_left11 = 0.5 - Delta_t / Delta_x * values.dflux11
+                                    - 0.5 * Delta_t * values.dsource11;
+    Eigen::ArrayXd const d_right10 = Delta_t / Delta_x * values.dflux10
+                                     - 0.5 * Delta_t * values.dsource10;
+    Eigen::ArrayXd const d_right11 = 0.5 + Delta_t / Delta_x * values.dflux11
+                                     - 0.5 * Delta_t * values.dsource11;
+    for (Eigen::Index cell = 0; cell != cells; ++cell) {
+      auto const i = first_equation + 2 * cell;
+      // Same order as in d_evaluate_d_new_state:
+      jacobianhandler->add_constant_to_coefficient(i, i - 1, 0.5);
+      jacobianhandler->add_to_coefficient(i, i, d_left01);
+      jacobianhandler->add_to_coefficient(i + 1, i - 1, d_left10[cell]);
+      jacobianhandler->add_to_coefficient(i + 1, i, d_left11[cell]);
+
+      jacobianhandler->add_constant_to_coefficient(i, i + 1, 0.5);
+      jacobianhandler->add_to_coefficient(i, i + 2, d_right01);
+      jacobianhandler->add_to_coefficient(
+          i + 1, i + 1, d_right10[cell + 1]);
+      jacobianhandler->add_to_coefficient(
+          i + 1, i + 2, d_right11[cell + 1]);
+    }
+  }
+
+  template <typename Concretescheme, typename Concretelaw>
+  void PipeT<Concretescheme, Concretelaw>::evaluate(
+      Eigen::Ref<Eigen::VectorXd> rootvalues, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+    if constexpr (evaluates_at_points) {
+      evaluate_box_scheme_at_points(
+          &rootvalues, nullptr, last_time, new_time, last_state, new_state);
+      return;
+    }
+    for (auto i = get_equation_start_index(); i != get_equation_after_index();
+         i += 2) {
+
+      auto rootvalue_segment = rootvalues.segment<2>(i);
+
+      auto last_left = last_state.segment<2>(i - 1);
+      auto last_right = last_state.segment<2>(i + 1);
+      auto new_left = new_state.segment<2>(i - 1);
+      auto new_right = new_state.segment<2>(i + 1);
+
+      scheme.evaluate_point(
+          rootvalue_segment, last_time, new_time, Delta_x, last_left,
+          last_right, new_left, new_right, isothermaleulerequation);
+    }
+  }
+
+  template <typename Concretescheme, typename Concretelaw>
+  void PipeT<Concretescheme, Concretelaw>::d_evaluate_d_new_state(
+      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+    if constexpr (evaluates_at_points) {
+      evaluate_box_scheme_at_points(
+          nullptr, &jacobianhandler, last_time, new_time, last_state,
+          new_state);
+      return;
+    }
+    for (auto i = get_equation_start_index(); i != get_equation_after_index();
+         i += 2) {
+      // maybe use Eigen::Ref here to avoid copies.
+      auto last_left = last_state.segment<2>(i - 1);
+      auto last_right = last_state.segment<2>(i + 1);
+      auto new_left = new_state.segment<2>(i - 1);
+      auto new_right = new_state.segment<2>(i + 1);
+
+      Eigen::Matrix2d current_derivative_left
+          = scheme.devaluate_point_d_new_left(
+              last_time, new_time, Delta_x, last_left, last_right, new_left,
+              new_right, isothermaleulerequation);
+
+      jacobianhandler.add_to_coefficient(
+          i, i - 1, current_derivative_left(0, 0));
+      jacobianhandler.add_to_coefficient(i, i, current_derivative_left(0, 1));
+      jacobianhandler.add_to_coefficient(
+          i + 1, i - 1, current_derivative_left(1, 0));
+      jacobianhandler.add_to_coefficient(
+          i + 1, i, current_derivative_left(1, 1));
+
+      Eigen::Matrix2d current_derivative_right
+          = scheme.devaluate_point_d_new_right(
+              last_time, new_time, Delta_x, last_left, last_right, new_left,
+              new_right, isothermaleulerequation);
+
+      jacobianhandler.add_to_coefficient(
+          i, i + 1, current_derivative_right(0, 0));
+      jacobianhandler.add_to_coefficient(
+          i, i + 2, current_derivative_right(0, 1));
+      jacobianhandler.add_to_coefficient(
+          i + 1, i + 1, current_derivative_right(1, 0));
+      jacobianhandler.add_to_coefficient(
+          i + 1, i + 2, current_derivative_right(1, 1));
+    }
+  }
+
+  template <typename Concretescheme, typename Concretelaw>
+  void PipeT<Concretescheme, Concretelaw>::evaluate_with_derivative(
+      Eigen::Ref<Eigen::VectorXd> rootvalues,
+      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+    if constexpr (evaluates_at_points) {
+      evaluate_box_scheme_at_points(
+          &rootvalues, &jacobianhandler, last_time, new_time, last_state,
+          new_state);
+      return;
+    }
+    for (auto i = get_equation_start_index(); i != get_equation_after_index();
+         i += 2) {
+
+      auto rootvalue_segment = rootvalues.segment<2>(i);
+
+      auto last_left = last_state.segment<2>(i - 1);
+      auto last_right = last_state.segment<2>(i + 1);
+      auto new_left = new_state.segment<2>(i - 1);
+      auto new_right = new_state.segment<2>(i + 1);
+
+      Eigen::Matrix2d current_derivative_left;
+      Eigen::Matrix2d current_derivative_right;
+      scheme.evaluate_point_with_derivatives(
+          rootvalue_segment, current_derivative_left, current_derivative_right,
+          last_time, new_time, Delta_x, last_left, last_right, new_left,
+          new_right, isothermaleulerequation);
+
+      // Same order as in d_evaluate_d_new_state:
+      jacobianhandler.add_to_coefficient(
+          i, i - 1, current_derivative_left(0, 0));
+      jacobianhandler.add_to_coefficient(i, i, current_derivative_left(0, 1));
+      jacobianhandler.add_to_coefficient(
+          i + 1, i - 1, current_derivative_left(1, 0));
+      jacobianhandler.add_to_coefficient(
+          i + 1, i, current_derivative_left(1, 1));
+
+      jacobianhandler.add_to_coefficient(
+          i, i + 1, current_derivative_right(0, 0));
+      jacobianhandler.add_to_coefficient(
+          i, i + 2, current_derivative_right(0, 1));
+      jacobianhandler.add_to_coefficient(
+          i + 1, i + 1, current_derivative_right(1, 0));
+      jacobianhandler.add_to_coefficient(
+          i + 1, i + 2, current_derivative_right(1, 1));
+    }
+  }
+
+  template <typename Concretescheme, typename Concretelaw>
+  void PipeT<Concretescheme, Concretelaw>::d_evaluate_d_last_state(
+      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+    if (scheme.has_constant_last_state_derivatives()
+        and jacobianhandler.constants_recorded()) {
+      // The matrix already holds the derivatives of an earlier fill.
+      return;
+    }
+    auto add = [&jacobianhandler,
+                constant = scheme.has_constant_last_state_derivatives()](
+                   Eigen::Index row, Eigen::Index col, double value) {
+      if (constant) {
+        jacobianhandler.add_constant_to_coefficient(row, col, value);
+      } else {
+        jacobianhandler.add_to_coefficient(row, col, value);
+      }
+    };
+    for (auto i = get_equation_start_index(); i != get_equation_after_index();
+         i += 2) {
+      // maybe use Eigen::Ref here to avoid copies.
+      auto last_left = last_state.segment<2>(i - 1);
+      auto last_right = last_state.segment<2>(i + 1);
+      auto new_left = new_state.segment<2>(i - 1);
+      auto new_right = new_state.segment<2>(i + 1);
+
+      Eigen::Matrix2d current_derivative_left
+          = scheme.devaluate_point_d_last_left(
+              last_time, new_time, Delta_x, last_left, last_right, new_left,
+              new_right, isothermaleulerequation);
+
+      add(i, i - 1, current_derivative_left(0, 0));
+      add(i, i, current_derivative_left(0, 1));
+      add(i + 1, i - 1, current_derivative_left(1, 0));
+      add(i + 1, i, current_derivative_left(1, 1));
+
+      Eigen::Matrix2d current_derivative_right
+          = scheme.devaluate_point_d_last_right(
+              last_time, new_time, Delta_x, last_left, last_right, new_left,
+              new_right, isothermaleulerequation);
+
+      add(i, i + 1, current_derivative_right(0, 0));
+      add(i, i + 2, current_derivative_right(0, 1));
+      add(i + 1, i + 1, current_derivative_right(1, 0));
+      add(i + 1, i + 2, current_derivative_right(1, 1));
+    }
+  }
+
+  template class PipeT<
+      Scheme::Implicitboxscheme<2>, Balancelaw::Isothermaleulerequation>;
+
+} // namespace Model::Gas
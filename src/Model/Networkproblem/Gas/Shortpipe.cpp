@@ -42,6 +42,9 @@ namespace Model::Gas {
       double /*new_time*/,
       Eigen::Ref<Eigen::VectorXd const> const & /*last_state*/,
       Eigen::Ref<Eigen::VectorXd const> const & /*new_state*/) const {
+    if (jacobianhandler.constants_recorded()) {
+      return;
+    }
 
     auto start_p_index = get_boundary_state_index(start);
     auto start_q_index = start_p_index + 1;
@@ -51,11 +54,14 @@ namespace Model::Gas {
     auto start_equation_index = get_equation_start_index();
     auto end_equation_index = start_equation_index + 1;
 
-    jacobianhandler.add_to_coefficient(
+    jacobianhandler.add_constant_to_coefficient(
         start_equation_index, start_p_index, 1.0);
-    jacobianhandler.add_to_coefficient(start_equation_index, end_p_index, -1.0);
-    jacobianhandler.add_to_coefficient(end_equation_index, start_q_index, 1.0);
-    jacobianhandler.add_to_coefficient(end_equation_index, end_q_index, -1.0);
+    jacobianhandler.add_constant_to_coefficient(
+        start_equation_index, end_p_index, -1.0);
+    jacobianhandler.add_constant_to_coefficient(
+        end_equation_index, start_q_index, 1.0);
+    jacobianhandler.add_constant_to_coefficient(
+        end_equation_index, end_q_index, -1.0);
   }
 
   void Shortpipe::d_evaluate_d_last_state(
@@ -19,11 +19,17 @@
 #include "Equationcomponent.hpp"
 #include "Gasedge.hpp"
 #include "Isothermaleulerequation.hpp"
-#include "Threepointscheme.hpp"
+#include <memory>
 
 namespace Model::Gas {
 
-  class Pipe final :
+  /** \brief A pipe, discretized on an equidistant grid.
+   *
+   * The evaluation of the equations is implemented by PipeT for each
+   * combination of scheme and balance law, so that it needs no virtual
+   * calls. Create pipes with #make_instance.
+   */
+  class Pipe :
       public Equationcomponent,
       public Gasedge,
       public Network::Edge {
@@ -34,26 +40,20 @@ namespace Model::Gas {
     static nlohmann::json get_schema();
     static nlohmann::json get_initial_schema();
 
-    Pipe(
+    /** \brief Creates the PipeT for the "scheme" and "balancelaw" given in
+     * topology.
+     */
+    static std::unique_ptr<Pipe> make_instance(
         nlohmann::json const &topology,
         std::vector<std::unique_ptr<Network::Node>> &nodes);
 
-    ~Pipe() final;
-
-    void evaluate(
-        Eigen::Ref<Eigen::VectorXd> rootvalues, double last_time,
-        double new_time, Eigen::Ref<Eigen::VectorXd const> const &last_state,
-        Eigen::Ref<Eigen::VectorXd const> const &new_state) const final;
-    void d_evaluate_d_new_state(
-        Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
-        Eigen::Ref<Eigen::VectorXd const> const &,
-        Eigen::Ref<Eigen::VectorXd const> const &new_state) const final;
-    void d_evaluate_d_last_state(
-        Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
-        Eigen::Ref<Eigen::VectorXd const> const &last_state,
-        Eigen::Ref<Eigen::VectorXd const> const &new_state) const final;
+    ~Pipe() override;
+
     void setup() final;
 
+    std::vector<std::pair<Eigen::Index, Eigen::Index>>
+    get_condensable_ranges() const final;
+
     Eigen::Index needed_number_of_states() const final;
 
     void add_results_to_json(nlohmann::json &new_output) final;
@@ -79,12 +79,17 @@ namespace Model::Gas {
     int get_number_of_points() const;
     double get_Delta_x() const;
 
-  private:
-    double get_length() const;
+  protected:
+    Pipe(
+        nlohmann::json const &topology,
+        std::vector<std::unique_ptr<Network::Node>> &nodes);
+
     int const number_of_points;
     double const Delta_x;
     Balancelaw::Isothermaleulerequation const isothermaleulerequation;
-    std::unique_ptr<Scheme::Threepointscheme<2> const> scheme;
+
+  private:
+    double get_length() const;
   };
 
 } // namespace Model::Gas
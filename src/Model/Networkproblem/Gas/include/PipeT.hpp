@@ -0,0 +1,83 @@
+/*
+ * Grazer - network simulation and optimization tool
+ *
+ * Copyright 2020-2022 Uni Mannheim <e.fokken+grazer@posteo.de>,
+ *
+ * SPDX-License-Identifier:	MIT
+ *
+ * Licensed under the MIT License, found in the file LICENSE and at
+ * https://opensource.org/licenses/MIT
+ * This file may not be copied, modified, or distributed except according to
+ * those terms.
+ *
+ * Distributed on an "AS IS" BASIS, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied.  See your chosen license for details.
+ *
+ */
+#pragma once
+#include "Implicitboxscheme.hpp"
+#include "Pipe.hpp"
+#include <type_traits>
+
+namespace Model::Gas {
+
+  /** \brief A #Pipe with a fixed scheme and balance law.
+   *
+   * Knowing both types at compile time, the evaluation calls them without
+   * virtual dispatch. For the implicit box scheme with the isothermal Euler
+   * equations, all points of the pipe are evaluated at once.
+   *
+   * @tparam Concretescheme A Scheme::Threepointscheme<2>.
+   * @tparam Concretelaw The balance law, which is stored by #Pipe.
+   */
+  template <typename Concretescheme, typename Concretelaw>
+  class PipeT final : public Pipe {
+    static_assert(
+        std::is_same_v<Concretelaw, Balancelaw::Isothermaleulerequation>,
+        "Pipe only stores an Isothermaleulerequation so far.");
+
+  public:
+    PipeT(
+        nlohmann::json const &topology,
+        std::vector<std::unique_ptr<Network::Node>> &nodes);
+
+    void evaluate(
+        Eigen::Ref<Eigen::VectorXd> rootvalues, double last_time,
+        double new_time, Eigen::Ref<Eigen::VectorXd const> const &last_state,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state) const final;
+    void d_evaluate_d_new_state(
+        Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+        Eigen::Ref<Eigen::VectorXd const> const &,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state) const final;
+    void d_evaluate_d_last_state(
+        Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+        Eigen::Ref<Eigen::VectorXd const> const &last_state,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state) const final;
+    void evaluate_with_derivative(
+        Eigen::Ref<Eigen::VectorXd> rootvalues,
+        Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+        Eigen::Ref<Eigen::VectorXd const> const &last_state,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state) const final;
+
+  private:
+    /** \brief Evaluates the implicit box scheme at all points at once, see
+     * Balancelaw::Isothermaleulerequation::flux_and_source_at_points.
+     *
+     * Writes the values to rootvalues, if it is not null, and the derivatives
+     * with respect to the new state to jacobianhandler, if it is not null.
+     */
+    void evaluate_box_scheme_at_points(
+        Eigen::Ref<Eigen::VectorXd> *rootvalues,
+        Aux::Matrixhandler *jacobianhandler, double last_time, double new_time,
+        Eigen::Ref<Eigen::VectorXd const> const &last_state,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state) const;
+
+    /// Is true, if #evaluate_box_scheme_at_points can replace the pointwise
+    /// evaluation of #scheme.
+    static constexpr bool evaluates_at_points
+        = std::is_same_v<Concretescheme, Scheme::Implicitboxscheme<2>>;
+
+    Concretescheme const scheme;
+  };
+
+} // namespace Model::Gas
@@ -19,7 +19,7 @@
 
 namespace Model::Gas {
 
-  class Shortpipe : public Equationcomponent, public Shortcomponent {
+  class Shortpipe final : public Equationcomponent, public Shortcomponent {
 
   public:
     static std::string get_type();
@@ -85,8 +85,10 @@ namespace Model::Gaspowerconnection {
 
   void ExternalPowerplant::json_save(
       double time, Eigen::Ref<Eigen::VectorXd const> const &state) {
-    double P_val = P(state);
-    double Q_val = Q(state);
+    Linecache cache;
+    fill_line_cache(state, cache);
+    double P_val = P(state, cache);
+    double Q_val = Q(state, cache);
     json_save_power(time, state, P_val, Q_val);
   }
 
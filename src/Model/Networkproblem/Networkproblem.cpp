@@ -15,25 +15,52 @@
  *
  */
 #include "Networkproblem.hpp"
+#include "Admittancematrix.hpp"
 #include "ComponentJsonHelpers.hpp"
+#include "Compressorstation.hpp"
+#include "ConstraintSink.hpp"
+#include "Controlvalve.hpp"
 #include "Edge.hpp"
 #include "Equationcomponent.hpp"
 #include "Exception.hpp"
+#include "ExternalPowerplant.hpp"
+#include "Gaspowerconnection.hpp"
 #include "Idobject.hpp"
+#include "Innode.hpp"
+#include "Matrixhandler.hpp"
 #include "Net.hpp"
 #include "Node.hpp"
+#include "PQnode.hpp"
+#include "PVnode.hpp"
+#include "PipeT.hpp"
+#include "Powernode.hpp"
+#include "Pressureboundarynode.hpp"
+#include "Shortpipe.hpp"
+#include "Sink.hpp"
+#include "Source.hpp"
+#include "StochasticPQnode.hpp"
+#include "Threadpool.hpp"
+#include "Vphinode.hpp"
 #include <Eigen/Sparse>
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
 #include <iostream>
 #include <iterator>
+#include <map>
 #include <memory>
 #include <nlohmann/json.hpp>
+#include <queue>
+#include <set>
 #include <sstream>
 #include <string>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
 #include <utility>
 #include <vector>
-// #include <execution>
+
 namespace Model {
 
   /** \brief Creates a vector of Idobject pointers from some component type.
@@ -56,6 +83,179 @@ namespace Model {
     return ids;
   }
 
+  /** \brief Splits components into number_of_parts contiguous parts with
+   * roughly the same work, where the work of a component is estimated by its
+   * number of states.
+   *
+   * Returns the starts of the parts followed by the number of components.
+   */
+  template <typename Componenttype>
+  static std::vector<std::size_t> partition_by_work(
+      std::vector<Componenttype *> const &components, int number_of_parts) {
+    auto work = [](Componenttype *component) -> Eigen::Index {
+      auto statecomponent = dynamic_cast<Statecomponent *>(component);
+      if (statecomponent == nullptr) {
+        return 1;
+      }
+      return 1 + statecomponent->get_number_of_states();
+    };
+    Eigen::Index total_work = 0;
+    for (auto *component : components) {
+      total_work += work(component);
+    }
+    std::vector<std::size_t> part_starts(
+        static_cast<size_t>(number_of_parts) + 1, components.size());
+    Eigen::Index finished_work = 0;
+    std::size_t next_part = 0;
+    for (std::size_t index = 0; index != components.size(); ++index) {
+      auto part
+          = static_cast<size_t>(finished_work * number_of_parts / total_work);
+      while (next_part <= part) {
+        part_starts[next_part] = index;
+        ++next_part;
+      }
+      finished_work += work(components[index]);
+    }
+    return part_starts;
+  }
+
+  template <typename... Components> struct Componenttypes {};
+
+  /// The final component classes, whose buckets are run with non-virtual
+  /// calls, see Networkproblem::run_buckets.
+  using Bucketedtypes = Componenttypes<
+      Gas::PipeT<
+          Scheme::Implicitboxscheme<2>, Balancelaw::Isothermaleulerequation>,
+      Gas::Shortpipe, Gas::Innode, Gas::Source, Gas::Sink, Gas::ConstraintSink,
+      Gas::Pressureboundarynode, Gas::Compressorstation, Gas::Controlvalve,
+      Power::Vphinode, Power::PQnode, Power::PVnode, Power::StochasticPQnode,
+      Gaspowerconnection::Gaspowerconnection,
+      Gaspowerconnection::ExternalPowerplant>;
+
+  /** \brief Calls kernel on the components [first, after) as pointers to
+   * the first of Components, that is their concrete type.
+   *
+   * Returns false, if their concrete type is none of Components.
+   */
+  template <typename Componenttype, typename Kernel, typename... Components>
+  static bool run_as_concrete_type(
+      Componenttype *const *first, Componenttype *const *after,
+      std::type_index type, Kernel const &kernel,
+      Componenttypes<Components...>) {
+    auto run_as = [&](auto *tag) {
+      using Component = std::remove_pointer_t<decltype(tag)>;
+      if constexpr (std::is_base_of_v<Componenttype, Component>) {
+        if (type == std::type_index(typeid(Component))) {
+          for (auto *component = first; component != after; ++component) {
+            kernel(static_cast<Component *>(*component));
+          }
+          return true;
+        }
+      }
+      return false;
+    };
+    return (run_as(static_cast<Components *>(nullptr)) or ...);
+  }
+
+  /** \brief The line values of all buses of admittancematrix at state, or
+   * an empty cache, if there is no matrix.
+   */
+  static Power::Powernode::Linecache lines_of_all_buses(
+      Power::Admittancematrix const *admittancematrix,
+      Eigen::Ref<Eigen::VectorXd const> const &state) {
+    Power::Powernode::Linecache lines;
+    if (admittancematrix) {
+      admittancematrix->fill_line_cache(
+          state, 0, admittancematrix->get_number_of_buses(), lines);
+    }
+    return lines;
+  }
+
+  /// Power nodes read their line values from the cache of all buses.
+  template <typename Component>
+  static constexpr bool is_powernode
+      = std::is_base_of_v<Power::Powernode, Component>;
+
+  template <typename Componenttype>
+  std::vector<Networkproblem::Componentbucket>
+  Networkproblem::group_by_type(std::vector<Componenttype *> &components) {
+    std::vector<std::type_index> types;
+    for (auto *component : components) {
+      std::type_index type(typeid(*component));
+      if (std::find(types.begin(), types.end(), type) == types.end()) {
+        types.push_back(type);
+      }
+    }
+    auto rank = [&types](Componenttype *component) {
+      return std::find(
+                 types.begin(), types.end(),
+                 std::type_index(typeid(*component)))
+             - types.begin();
+    };
+    std::stable_sort(
+        components.begin(), components.end(),
+        [&rank](Componenttype *left, Componenttype *right) {
+          return rank(left) < rank(right);
+        });
+    return find_buckets(components);
+  }
+
+  template <typename Componenttype>
+  std::vector<Networkproblem::Componentbucket> Networkproblem::find_buckets(
+      std::vector<Componenttype *> const &components) {
+    std::vector<Componentbucket> buckets;
+    for (std::size_t index = 0; index != components.size(); ++index) {
+      std::type_index type(typeid(*components[index]));
+      if (buckets.empty() or buckets.back().type != type) {
+        buckets.push_back({type, index, index});
+      }
+      buckets.back().after = index + 1;
+    }
+    return buckets;
+  }
+
+  template <typename Componenttype, typename Kernel>
+  void Networkproblem::run_buckets(
+      std::vector<Componenttype *> const &components,
+      std::vector<Componentbucket> const &buckets, std::size_t first,
+      std::size_t after, Kernel const &kernel) {
+    for (auto const &bucket : buckets) {
+      auto const bucket_first = std::max(first, bucket.first);
+      auto const bucket_after = std::min(after, bucket.after);
+      if (bucket_first >= bucket_after) {
+        continue;
+      }
+      auto const *begin = components.data() + bucket_first;
+      auto const *end = components.data() + bucket_after;
+      if (not run_as_concrete_type(
+              begin, end, bucket.type, kernel, Bucketedtypes{})) {
+        for (auto const *component = begin; component != end; ++component) {
+          kernel(*component);
+        }
+      }
+    }
+  }
+
+  template <typename Equationkernel, typename Controlkernel>
+  void Networkproblem::run_components(
+      std::size_t first, std::size_t after,
+      Equationkernel const &equationkernel,
+      Controlkernel const &controlkernel) const {
+    auto const number_of_equationcomponents = equationcomponents.size();
+    if (first < number_of_equationcomponents) {
+      run_buckets(
+          equationcomponents, equationcomponent_buckets, first,
+          std::min(after, number_of_equationcomponents), equationkernel);
+    }
+    if (after > number_of_equationcomponents) {
+      run_buckets(
+          controlcomponents, controlcomponent_buckets,
+          std::max(first, number_of_equationcomponents)
+              - number_of_equationcomponents,
+          after - number_of_equationcomponents, controlkernel);
+    }
+  }
+
   template <typename Componenttype>
   static void check_components_in_json(
       std::vector<Componenttype *> const &components, nlohmann::json json,
@@ -165,6 +365,9 @@ namespace Model {
         constraintcomponents.push_back(constraintcomponent);
       }
     }
+    state_index_order = statecomponents;
+    equationcomponent_buckets = group_by_type(equationcomponents);
+    controlcomponent_buckets = find_buckets(controlcomponents);
   }
 
   void Networkproblem::init(
@@ -177,6 +380,80 @@ namespace Model {
     setup();
   }
 
+  void Networkproblem::order_states_by_topology() {
+    // The graph has the nodes and edges of the network as vertices, every
+    // edge is adjacent to its two nodes.
+    auto neighbours_of = [](Network::Node const *node) {
+      auto edges = node->get_starting_edges();
+      auto const ending_edges = node->get_ending_edges();
+      edges.insert(edges.end(), ending_edges.begin(), ending_edges.end());
+      return edges;
+    };
+    auto degree_of = [&neighbours_of](Network::Node const *node) {
+      return neighbours_of(node).size();
+    };
+    std::vector<Network::Node *> by_degree = network->get_nodes();
+    std::stable_sort(
+        by_degree.begin(), by_degree.end(),
+        [&degree_of](auto const *left, auto const *right) {
+          return degree_of(left) < degree_of(right);
+        });
+
+    // Cuthill-McKee: breadth-first searches from nodes of low degree, that
+    // visit the neighbours of a node in the order of increasing degree.
+    std::vector<Statecomponent *> order;
+    auto list = [&order](auto *component) {
+      if (auto statecomponent = dynamic_cast<Statecomponent *>(component)) {
+        order.push_back(statecomponent);
+      }
+    };
+    std::set<Network::Node const *> listed_nodes;
+    std::set<Network::Edge const *> listed_edges;
+    for (auto *start_node : by_degree) {
+      if (not listed_nodes.insert(start_node).second) {
+        continue;
+      }
+      std::queue<Network::Node *> queue;
+      queue.push(start_node);
+      list(start_node);
+      while (not queue.empty()) {
+        auto *node = queue.front();
+        queue.pop();
+        std::vector<Network::Node *> new_nodes;
+        for (auto *edge : neighbours_of(node)) {
+          if (not listed_edges.insert(edge).second) {
+            continue;
+          }
+          list(edge);
+          for (auto *neighbour :
+               {edge->get_starting_node(), edge->get_ending_node()}) {
+            if (listed_nodes.insert(neighbour).second) {
+              new_nodes.push_back(neighbour);
+            }
+          }
+        }
+        std::stable_sort(
+            new_nodes.begin(), new_nodes.end(),
+            [&degree_of](auto const *left, auto const *right) {
+              return degree_of(left) < degree_of(right);
+            });
+        for (auto *neighbour : new_nodes) {
+          list(neighbour);
+          queue.push(neighbour);
+        }
+      }
+    }
+    // Statecomponents outside of the network keep their order at the end:
+    std::set<Statecomponent *> ordered(order.begin(), order.end());
+    for (auto *statecomponent : statecomponents) {
+      if (ordered.count(statecomponent) == 0) {
+        order.push_back(statecomponent);
+      }
+    }
+    std::reverse(order.begin(), order.end());
+    state_index_order = std::move(order);
+  }
+
   ////////////////////////////////////////////////////////////////////////////
   // Statecomponent methods
   ////////////////////////////////////////////////////////////////////////////
@@ -220,7 +497,7 @@ namespace Model {
 
   Eigen::Index Networkproblem::set_state_indices(Eigen::Index next_free_index) {
     state_startindex = next_free_index;
-    for (auto *statecomponent : statecomponents) {
+    for (auto *statecomponent : state_index_order) {
       next_free_index = statecomponent->set_state_indices(next_free_index);
     }
     state_afterindex = next_free_index;
@@ -236,28 +513,58 @@ namespace Model {
       Eigen::Ref<Eigen::VectorXd const> const &last_state,
       Eigen::Ref<Eigen::VectorXd const> const &new_state,
       Eigen::Ref<Eigen::VectorXd const> const &control) const {
-
-    for (auto *equationcomponent : equationcomponents) {
-      equationcomponent->evaluate(
-          rootvalues, last_time, new_time, last_state, new_state);
-    }
-    for (auto *controlcomponent : controlcomponents) {
+    auto const new_lines
+        = lines_of_all_buses(admittancematrix.get(), new_state);
+    auto evaluate_equationcomponent = [&](auto *equationcomponent) {
+      using Component = std::remove_pointer_t<decltype(equationcomponent)>;
+      if constexpr (is_powernode<Component>) {
+        equationcomponent->evaluate_on_lines(
+            rootvalues, last_time, new_time, last_state, new_state, new_lines);
+      } else {
+        equationcomponent->evaluate(
+            rootvalues, last_time, new_time, last_state, new_state);
+      }
+    };
+    auto evaluate_controlcomponent = [&](auto *controlcomponent) {
       controlcomponent->evaluate(
           rootvalues, last_time, new_time, last_state, new_state, control);
+    };
+
+    if (threadpool) {
+      // Every component writes only its own equations, so the parts can be
+      // evaluated concurrently.
+      threadpool->run([&](int thread_index) {
+        auto index = static_cast<size_t>(thread_index);
+        run_buckets(
+            equationcomponents, equationcomponent_buckets,
+            equationcomponent_part_starts[index],
+            equationcomponent_part_starts[index + 1],
+            evaluate_equationcomponent);
+        run_buckets(
+            controlcomponents, controlcomponent_buckets,
+            controlcomponent_part_starts[index],
+            controlcomponent_part_starts[index + 1], evaluate_controlcomponent);
+      });
+      return;
     }
+    run_components(
+        0, equationcomponents.size() + controlcomponents.size(),
+        evaluate_equationcomponent, evaluate_controlcomponent);
   }
 
   void Networkproblem::prepare_timestep(
       double last_time, double new_time,
       Eigen::Ref<Eigen::VectorXd const> const &last_state,
       Eigen::Ref<Eigen::VectorXd const> const &control) {
-    for (auto *equationcomponent : equationcomponents) {
-      equationcomponent->prepare_timestep(last_time, new_time, last_state);
-    }
-    for (auto *controlcomponent : controlcomponents) {
-      controlcomponent->prepare_timestep(
-          last_time, new_time, last_state, control);
-    }
+    run_components(
+        0, equationcomponents.size() + controlcomponents.size(),
+        [&](auto *equationcomponent) {
+          equationcomponent->prepare_timestep(last_time, new_time, last_state);
+        },
+        [&](auto *controlcomponent) {
+          controlcomponent->prepare_timestep(
+              last_time, new_time, last_state, control);
+        });
   }
 
   void Networkproblem::d_evaluate_d_new_state(
@@ -265,15 +572,32 @@ namespace Model {
       Eigen::Ref<Eigen::VectorXd const> const &last_state,
       Eigen::Ref<Eigen::VectorXd const> const &new_state,
       Eigen::Ref<Eigen::VectorXd const> const &control) const {
-
-    for (auto *equationcomponent : equationcomponents) {
-      equationcomponent->d_evaluate_d_new_state(
-          jacobianhandler, last_time, new_time, last_state, new_state);
-    }
-    for (auto *controlcomponent : controlcomponents) {
-      controlcomponent->d_evaluate_d_new_state(
-          jacobianhandler, last_time, new_time, last_state, new_state, control);
-    }
+    auto const new_lines
+        = lines_of_all_buses(admittancematrix.get(), new_state);
+    assemble_derivative(
+        jacobianhandler, new_state_plans,
+        [&](std::size_t first, std::size_t after,
+            Aux::Matrixhandler &handler) {
+          run_components(
+              first, after,
+              [&](auto *equationcomponent) {
+                using Component
+                    = std::remove_pointer_t<decltype(equationcomponent)>;
+                if constexpr (is_powernode<Component>) {
+                  equationcomponent->d_evaluate_d_new_state_on_lines(
+                      handler, last_time, new_time, last_state, new_state,
+                      new_lines);
+                } else {
+                  equationcomponent->d_evaluate_d_new_state(
+                      handler, last_time, new_time, last_state, new_state);
+                }
+              },
+              [&](auto *controlcomponent) {
+                controlcomponent->d_evaluate_d_new_state(
+                    handler, last_time, new_time, last_state, new_state,
+                    control);
+              });
+        });
   }
 
   void Networkproblem::d_evaluate_d_last_state(
@@ -282,14 +606,62 @@ namespace Model {
       Eigen::Ref<Eigen::VectorXd const> const &new_state,
       Eigen::Ref<Eigen::VectorXd const> const &control) const {
 
-    for (auto *equationcomponent : equationcomponents) {
-      equationcomponent->d_evaluate_d_last_state(
-          jacobianhandler, last_time, new_time, last_state, new_state);
-    }
-    for (auto *controlcomponent : controlcomponents) {
-      controlcomponent->d_evaluate_d_last_state(
-          jacobianhandler, last_time, new_time, last_state, new_state, control);
-    }
+    assemble_derivative(
+        jacobianhandler, last_state_plans,
+        [&](std::size_t first, std::size_t after,
+            Aux::Matrixhandler &handler) {
+          run_components(
+              first, after,
+              [&](auto *equationcomponent) {
+                equationcomponent->d_evaluate_d_last_state(
+                    handler, last_time, new_time, last_state, new_state);
+              },
+              [&](auto *controlcomponent) {
+                controlcomponent->d_evaluate_d_last_state(
+                    handler, last_time, new_time, last_state, new_state,
+                    control);
+              });
+        });
+  }
+
+  void Networkproblem::evaluate_with_derivative(
+      Eigen::Ref<Eigen::VectorXd> rootvalues,
+      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Eigen::Ref<Eigen::VectorXd const> const &control) const {
+    auto const new_lines
+        = lines_of_all_buses(admittancematrix.get(), new_state);
+    // The components write to disjoint parts of rootvalues, so the coloring
+    // of the derivative also protects rootvalues.
+    assemble_derivative(
+        jacobianhandler, evaluate_with_derivative_plans,
+        [&](std::size_t first, std::size_t after,
+            Aux::Matrixhandler &handler) {
+          run_components(
+              first, after,
+              [&](auto *equationcomponent) {
+                using Component
+                    = std::remove_pointer_t<decltype(equationcomponent)>;
+                if constexpr (is_powernode<Component>) {
+                  equationcomponent->evaluate_on_lines(
+                      rootvalues, last_time, new_time, last_state, new_state,
+                      new_lines);
+                  equationcomponent->d_evaluate_d_new_state_on_lines(
+                      handler, last_time, new_time, last_state, new_state,
+                      new_lines);
+                } else {
+                  equationcomponent->evaluate_with_derivative(
+                      rootvalues, handler, last_time, new_time, last_state,
+                      new_state);
+                }
+              },
+              [&](auto *controlcomponent) {
+                controlcomponent->evaluate_with_derivative(
+                    rootvalues, handler, last_time, new_time, last_state,
+                    new_state, control);
+              });
+        });
   }
 
   void Networkproblem::d_evaluate_d_control(
@@ -297,10 +669,13 @@ namespace Model {
       Eigen::Ref<Eigen::VectorXd const> const &last_state,
       Eigen::Ref<Eigen::VectorXd const> const &new_state,
       Eigen::Ref<Eigen::VectorXd const> const &control) const {
-    for (auto *controlcomponent : controlcomponents) {
-      controlcomponent->d_evaluate_d_control(
-          jacobianhandler, last_time, new_time, last_state, new_state, control);
-    }
+    run_buckets(
+        controlcomponents, controlcomponent_buckets, 0,
+        controlcomponents.size(), [&](auto *controlcomponent) {
+          controlcomponent->d_evaluate_d_control(
+              jacobianhandler, last_time, new_time, last_state, new_state,
+              control);
+        });
   }
 
   void Networkproblem::set_initial_controls(
@@ -396,6 +771,101 @@ namespace Model {
     for (auto *controlcomponent : controlcomponents) {
       controlcomponent->setup();
     }
+
+    std::vector<Power::Powernode *> powernodes;
+    for (auto *equationcomponent : equationcomponents) {
+      if (auto powernode
+          = dynamic_cast<Power::Powernode *>(equationcomponent)) {
+        powernodes.push_back(powernode);
+      }
+    }
+    admittancematrix.reset();
+    if (powernodes.empty()) {
+      return;
+    }
+    admittancematrix = std::make_shared<Power::Admittancematrix const>(
+        std::vector<Power::Powernode const *>(
+            powernodes.begin(), powernodes.end()));
+    for (std::size_t bus = 0; bus != powernodes.size(); ++bus) {
+      powernodes[bus]->set_admittancematrix(
+          admittancematrix, static_cast<Eigen::Index>(bus));
+    }
+  }
+
+  std::vector<std::vector<std::pair<Eigen::Index, Eigen::Index>>>
+  Networkproblem::get_subdomains(int number_of_subdomains) const {
+    // Order the components by breadth-first searches through the network:
+    std::vector<Statecomponent const *> order;
+    auto list = [&order](auto const *component) {
+      if (auto statecomponent = dynamic_cast<Statecomponent const *>(component);
+          statecomponent != nullptr
+          and statecomponent->get_number_of_states() > 0) {
+        order.push_back(statecomponent);
+      }
+    };
+    std::set<Network::Node const *> listed_nodes;
+    std::set<Network::Edge const *> listed_edges;
+    for (auto const *start_node : network->get_nodes()) {
+      if (not listed_nodes.insert(start_node).second) {
+        continue;
+      }
+      std::queue<Network::Node const *> queue;
+      queue.push(start_node);
+      while (not queue.empty()) {
+        auto const *node = queue.front();
+        queue.pop();
+        list(node);
+        auto edges = node->get_starting_edges();
+        auto const ending_edges = node->get_ending_edges();
+        edges.insert(edges.end(), ending_edges.begin(), ending_edges.end());
+        for (auto const *edge : edges) {
+          if (not listed_edges.insert(edge).second) {
+            continue;
+          }
+          list(edge);
+          for (auto const *neighbour :
+               {edge->get_starting_node(), edge->get_ending_node()}) {
+            if (listed_nodes.insert(neighbour).second) {
+              queue.push(neighbour);
+            }
+          }
+        }
+      }
+    }
+
+    Eigen::Index total_states = 0;
+    for (auto const *statecomponent : order) {
+      total_states += statecomponent->get_number_of_states();
+    }
+    std::vector<std::vector<std::pair<Eigen::Index, Eigen::Index>>>
+        subdomains(static_cast<size_t>(number_of_subdomains));
+    Eigen::Index finished_states = 0;
+    for (auto const *statecomponent : order) {
+      auto const subdomain
+          = finished_states * number_of_subdomains / total_states;
+      subdomains[static_cast<size_t>(subdomain)].emplace_back(
+          statecomponent->get_state_startindex(),
+          statecomponent->get_state_afterindex());
+      finished_states += statecomponent->get_number_of_states();
+    }
+    return subdomains;
+  }
+
+  std::vector<std::pair<Eigen::Index, Eigen::Index>>
+  Networkproblem::get_condensable_ranges() const {
+    std::vector<std::pair<Eigen::Index, Eigen::Index>> ranges;
+    for (auto *equationcomponent : equationcomponents) {
+      auto const component_ranges
+          = equationcomponent->get_condensable_ranges();
+      ranges.insert(
+          ranges.end(), component_ranges.begin(), component_ranges.end());
+    }
+    for (auto *controlcomponent : controlcomponents) {
+      auto const component_ranges = controlcomponent->get_condensable_ranges();
+      ranges.insert(
+          ranges.end(), component_ranges.begin(), component_ranges.end());
+    }
+    return ranges;
   }
 
   /////////////////////////////////////////////////////////
@@ -584,6 +1054,191 @@ namespace Model {
   // other methods:
   /////////////////////////////////////////////////////////
 
+  void Networkproblem::set_number_of_threads(int number_of_threads) {
+    new_state_plans = {};
+    last_state_plans = {};
+    evaluate_with_derivative_plans = {};
+    if (number_of_threads == 1) {
+      threadpool.reset();
+      equationcomponent_part_starts.clear();
+      controlcomponent_part_starts.clear();
+      return;
+    }
+    threadpool = std::make_unique<Aux::Threadpool>(number_of_threads);
+    equationcomponent_part_starts
+        = partition_by_work(equationcomponents, number_of_threads);
+    controlcomponent_part_starts
+        = partition_by_work(controlcomponents, number_of_threads);
+  }
+
+  /** \brief Assembles with a #Aux::Slothandler, see
+   * Networkproblem::assemble_derivative.
+   *
+   * Returns false, if plan doesn't fit the remembered calls of slothandler.
+   * In that case nothing has been assembled.
+   */
+  template <int Transpose>
+  static bool assemble_with_plan(
+      Aux::Slothandler<Transpose> &slothandler, Aux::Threadpool &threadpool,
+      std::vector<std::size_t> const &call_starts,
+      std::vector<std::vector<std::size_t>> const &color_classes,
+      std::function<void(std::size_t, std::size_t, Aux::Matrixhandler &)> const
+          &derive_components) {
+    auto const first_call = slothandler.get_number_of_calls();
+    if (not slothandler.remembers_calls(
+            first_call, first_call + call_starts.back())) {
+      return false;
+    }
+    auto const number_of_threads
+        = static_cast<std::size_t>(threadpool.get_number_of_threads());
+    std::vector<std::vector<Eigen::Triplet<double, Eigen::Index>>> missed(
+        number_of_threads);
+    std::vector<std::vector<Eigen::Triplet<double, Eigen::Index>>>
+        missed_constants(number_of_threads);
+    for (auto const &color_class : color_classes) {
+      // Split the color class into contiguous parts of roughly equal numbers
+      // of calls:
+      auto calls_of = [&](std::size_t component) {
+        return call_starts[component + 1] - call_starts[component];
+      };
+      std::size_t total_calls = 0;
+      for (auto component : color_class) {
+        total_calls += calls_of(component);
+      }
+      std::vector<std::size_t> part_starts(number_of_threads + 1, 0);
+      std::size_t finished_calls = 0;
+      std::size_t part = 0;
+      for (std::size_t position = 0; position != color_class.size();
+           ++position) {
+        while (part + 1 < number_of_threads
+               and finished_calls * number_of_threads
+                       >= (part + 1) * total_calls) {
+          ++part;
+          part_starts[part] = position;
+        }
+        finished_calls += calls_of(color_class[position]);
+      }
+      for (++part; part <= number_of_threads; ++part) {
+        part_starts[part] = color_class.size();
+      }
+
+      threadpool.run([&](int thread_index) {
+        auto const index = static_cast<std::size_t>(thread_index);
+        for (auto position = part_starts[index];
+             position != part_starts[index + 1]; ++position) {
+          auto const component = color_class[position];
+          auto rangehandler = slothandler.make_range_handler(
+              first_call + call_starts[component],
+              first_call + call_starts[component + 1]);
+          derive_components(component, component + 1, rangehandler);
+          auto const &component_missed = rangehandler.get_missed_coefficients();
+          missed[index].insert(
+              missed[index].end(), component_missed.begin(),
+              component_missed.end());
+          auto const &component_constants
+              = rangehandler.get_missed_constant_coefficients();
+          missed_constants[index].insert(
+              missed_constants[index].end(), component_constants.begin(),
+              component_constants.end());
+        }
+      });
+    }
+    slothandler.skip_calls(call_starts.back());
+    for (auto const &thread_constants : missed_constants) {
+      for (auto const &coefficient : thread_constants) {
+        slothandler.add_constant_to_coefficient(
+            coefficient.row(), coefficient.col(), coefficient.value());
+      }
+    }
+    for (auto const &thread_missed : missed) {
+      slothandler.add_missed_coefficients(thread_missed);
+    }
+    return true;
+  }
+
+  /** \brief Records the calls of every component in serial assembly and
+   * colors the components, see Networkproblem::assemble_derivative.
+   *
+   * Leaves call_starts empty, if the calls could not be remembered.
+   */
+  template <int Transpose>
+  static void assemble_and_record_plan(
+      Aux::Slothandler<Transpose> &slothandler,
+      std::size_t number_of_components, std::vector<std::size_t> &call_starts,
+      std::vector<std::vector<std::size_t>> &color_classes,
+      std::function<void(std::size_t, std::size_t, Aux::Matrixhandler &)> const
+          &derive_components) {
+    auto const first_call = slothandler.get_number_of_calls();
+    call_starts.assign(1, 0);
+    for (std::size_t component = 0; component != number_of_components;
+         ++component) {
+      derive_components(component, component + 1, slothandler);
+      call_starts.push_back(slothandler.get_number_of_calls() - first_call);
+    }
+    color_classes.clear();
+    if (not slothandler.remembers_calls(
+            first_call, first_call + call_starts.back())) {
+      call_starts.clear();
+      return;
+    }
+    // Every component gets a greater color than all earlier components, that
+    // write to one of its rows:
+    std::map<Eigen::Index, std::size_t> next_free_color_of_row;
+    for (std::size_t component = 0; component != number_of_components;
+         ++component) {
+      std::size_t color = 0;
+      for (auto call = call_starts[component];
+           call != call_starts[component + 1]; ++call) {
+        auto row = slothandler.remembered_row(first_call + call);
+        auto found = next_free_color_of_row.find(row);
+        if (found != next_free_color_of_row.end()) {
+          color = std::max(color, found->second);
+        }
+      }
+      for (auto call = call_starts[component];
+           call != call_starts[component + 1]; ++call) {
+        next_free_color_of_row[slothandler.remembered_row(first_call + call)]
+            = color + 1;
+      }
+      if (color_classes.size() <= color) {
+        color_classes.resize(color + 1);
+      }
+      color_classes[color].push_back(component);
+    }
+  }
+
+  void Networkproblem::assemble_derivative(
+      Aux::Matrixhandler &jacobianhandler, std::array<Assemblyplan, 2> &plans,
+      std::function<void(std::size_t, std::size_t, Aux::Matrixhandler &)>
+          const &derive_components) const {
+    auto const number_of_components
+        = equationcomponents.size() + controlcomponents.size();
+    auto assemble = [&](auto &slothandler, Assemblyplan &plan) {
+      if (plan.call_starts.size() == number_of_components + 1
+          and assemble_with_plan(
+              slothandler, *threadpool, plan.call_starts, plan.color_classes,
+              derive_components)) {
+        return;
+      }
+      assemble_and_record_plan(
+          slothandler, number_of_components, plan.call_starts,
+          plan.color_classes, derive_components);
+    };
+    if (threadpool) {
+      if (auto regular
+          = dynamic_cast<Aux::Slothandler<Aux::Regular> *>(&jacobianhandler)) {
+        assemble(*regular, plans[Aux::Regular]);
+        return;
+      }
+      if (auto transposed = dynamic_cast<Aux::Slothandler<Aux::Transposed> *>(
+              &jacobianhandler)) {
+        assemble(*transposed, plans[Aux::Transposed]);
+        return;
+      }
+    }
+    derive_components(0, number_of_components, jacobianhandler);
+  }
+
   Network::Net const &Networkproblem::get_network() const { return *network; }
 
 } // namespace Model
@@ -0,0 +1,191 @@
+/*
+ * Grazer - network simulation and optimization tool
+ *
+ * Copyright 2020-2022 Uni Mannheim <e.fokken+grazer@posteo.de>,
+ *
+ * SPDX-License-Identifier:	MIT
+ *
+ * Licensed under the MIT License, found in the file LICENSE and at
+ * https://opensource.org/licenses/MIT
+ * This file may not be copied, modified, or distributed except according to
+ * those terms.
+ *
+ * Distributed on an "AS IS" BASIS, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied.  See your chosen license for details.
+ *
+ */
+#include "Admittancematrix.hpp"
+#include "Matrixhandler.hpp"
+#include "Powernode.hpp"
+#include "Transmissionline.hpp"
+
+namespace Model::Power {
+
+  Admittancematrix::Admittancematrix(
+      std::vector<Powernode const *> const &buses) {
+    auto const number_of_buses = static_cast<Eigen::Index>(buses.size());
+    shunt_G.resize(number_of_buses);
+    shunt_B.resize(number_of_buses);
+    std::vector<double> G;
+    std::vector<double> B;
+    row_starts.push_back(0);
+    for (Eigen::Index bus = 0; bus != number_of_buses; ++bus) {
+      auto const *node = buses[static_cast<size_t>(bus)];
+      bus_V_indices.push_back(node->get_state_startindex());
+      shunt_G[bus] = node->get_G();
+      shunt_B[bus] = node->get_B();
+      for (auto *start_edge : node->get_starting_edges()) {
+        if (auto line = dynamic_cast<Transmissionline const *>(start_edge)) {
+          G.push_back(line->get_G());
+          B.push_back(line->get_B());
+          line_V_indices.push_back(
+              line->get_ending_powernode()->get_state_startindex());
+        }
+      }
+      for (auto *end_edge : node->get_ending_edges()) {
+        if (auto line = dynamic_cast<Transmissionline const *>(end_edge)) {
+          G.push_back(line->get_G());
+          B.push_back(line->get_B());
+          line_V_indices.push_back(
+              line->get_starting_powernode()->get_state_startindex());
+        }
+      }
+      row_starts.push_back(static_cast<Eigen::Index>(line_V_indices.size()));
+    }
+    line_G = Eigen::Map<Eigen::ArrayXd>(G.data(), row_starts.back());
+    line_B = Eigen::Map<Eigen::ArrayXd>(B.data(), row_starts.back());
+  }
+
+  Eigen::Index Admittancematrix::get_number_of_buses() const {
+    return static_cast<Eigen::Index>(bus_V_indices.size());
+  }
+
+  void Admittancematrix::fill_line_cache(
+      Eigen::Ref<Eigen::VectorXd const> const &state, Eigen::Index first_bus,
+      Eigen::Index after_bus, Linecache &cache) const {
+    auto const first_line = row_starts[static_cast<size_t>(first_bus)];
+    auto const after_line = row_starts[static_cast<size_t>(after_bus)];
+    Eigen::ArrayXd phi_ik(after_line - first_line);
+    cache.first_line = first_line;
+    cache.V_k.resize(after_line - first_line);
+    for (auto bus = first_bus; bus != after_bus; ++bus) {
+      auto const phi_i = state[bus_V_indices[static_cast<size_t>(bus)] + 1];
+      for (auto line = row_starts[static_cast<size_t>(bus)];
+           line != row_starts[static_cast<size_t>(bus) + 1]; ++line) {
+        auto const V_index_k = line_V_indices[static_cast<size_t>(line)];
+        cache.V_k[line - first_line] = state[V_index_k];
+        phi_ik[line - first_line] = phi_i - state[V_index_k + 1];
+      }
+    }
+    cache.cos_phi_ik = phi_ik.cos();
+    cache.sin_phi_ik = phi_ik.sin();
+  }
+
+  double Admittancematrix::P(
+      Eigen::Index bus, Eigen::Ref<Eigen::VectorXd const> const &state,
+      Linecache const &cache) const {
+    auto const V_i = state[bus_V_indices[static_cast<size_t>(bus)]];
+    double line_sum = 0.0;
+    for (auto line = row_starts[static_cast<size_t>(bus)];
+         line != row_starts[static_cast<size_t>(bus) + 1]; ++line) {
+      auto const cached = line - cache.first_line;
+      line_sum += cache.V_k[cached]
+                  * (line_G[line] * cache.cos_phi_ik[cached]
+                     + line_B[line] * cache.sin_phi_ik[cached]);
+    }
+    return shunt_G[bus] * V_i * V_i + V_i * line_sum;
+  }
+
+  double Admittancematrix::Q(
+      Eigen::Index bus, Eigen::Ref<Eigen::VectorXd const> const &state,
+      Linecache const &cache) const {
+    auto const V_i = state[bus_V_indices[static_cast<size_t>(bus)]];
+    double line_sum = 0.0;
+    for (auto line = row_starts[static_cast<size_t>(bus)];
+         line != row_starts[static_cast<size_t>(bus) + 1]; ++line) {
+      auto const cached = line - cache.first_line;
+      line_sum += cache.V_k[cached]
+                  * (line_G[line] * cache.sin_phi_ik[cached]
+                     - line_B[line] * cache.cos_phi_ik[cached]);
+    }
+    return -shunt_B[bus] * V_i * V_i + V_i * line_sum;
+  }
+
+  void Admittancematrix::add_P_derivative(
+      Eigen::Index equationindex, Aux::Matrixhandler &jacobianhandler,
+      Eigen::Index bus, Eigen::Ref<Eigen::VectorXd const> const &state,
+      Linecache const &cache) const {
+    auto V_index = bus_V_indices[static_cast<size_t>(bus)];
+    auto phi_index = V_index + 1;
+    auto V_i = state[V_index];
+
+    jacobianhandler.add_to_coefficient(
+        equationindex, V_index, 2 * shunt_G[bus] * V_i);
+    jacobianhandler.add_to_coefficient(equationindex, phi_index, 0.0);
+
+    for (auto line = row_starts[static_cast<size_t>(bus)];
+         line != row_starts[static_cast<size_t>(bus) + 1]; ++line) {
+      auto const cached = line - cache.first_line;
+      auto G_ik = line_G[line];
+      auto B_ik = line_B[line];
+      auto V_index_k = line_V_indices[static_cast<size_t>(line)];
+      auto phi_index_k = V_index_k + 1;
+      auto V_k = cache.V_k[cached];
+      auto cos_phi_ik = cache.cos_phi_ik[cached];
+      auto sin_phi_ik = cache.sin_phi_ik[cached];
+
+      jacobianhandler.add_to_coefficient(
+          equationindex, V_index,
+          V_k * (G_ik * cos_phi_ik + B_ik * sin_phi_ik));
+      jacobianhandler.add_to_coefficient(
+          equationindex, phi_index,
+          V_i * V_k * (-G_ik * sin_phi_ik + B_ik * cos_phi_ik));
+
+      jacobianhandler.add_to_coefficient(
+          equationindex, V_index_k,
+          V_i * (G_ik * cos_phi_ik + B_ik * sin_phi_ik));
+      jacobianhandler.add_to_coefficient(
+          equationindex, phi_index_k,
+          V_i * V_k * (G_ik * sin_phi_ik - B_ik * cos_phi_ik));
+    }
+  }
+
+  void Admittancematrix::add_Q_derivative(
+      Eigen::Index equationindex, Aux::Matrixhandler &jacobianhandler,
+      Eigen::Index bus, Eigen::Ref<Eigen::VectorXd const> const &state,
+      Linecache const &cache) const {
+    auto V_index = bus_V_indices[static_cast<size_t>(bus)];
+    auto phi_index = V_index + 1;
+    auto V_i = state[V_index];
+
+    jacobianhandler.add_to_coefficient(
+        equationindex, V_index, -2 * shunt_B[bus] * V_i);
+    jacobianhandler.add_to_coefficient(equationindex, phi_index, 0.0);
+
+    for (auto line = row_starts[static_cast<size_t>(bus)];
+         line != row_starts[static_cast<size_t>(bus) + 1]; ++line) {
+      auto const cached = line - cache.first_line;
+      auto G_ik = line_G[line];
+      auto B_ik = line_B[line];
+      auto V_index_k = line_V_indices[static_cast<size_t>(line)];
+      auto phi_index_k = V_index_k + 1;
+      auto V_k = cache.V_k[cached];
+      auto cos_phi_ik = cache.cos_phi_ik[cached];
+      auto sin_phi_ik = cache.sin_phi_ik[cached];
+
+      jacobianhandler.add_to_coefficient(
+          equationindex, V_index,
+          V_k * (G_ik * sin_phi_ik - B_ik * cos_phi_ik));
+      jacobianhandler.add_to_coefficient(
+          equationindex, phi_index,
+          V_i * V_k * (G_ik * cos_phi_ik + B_ik * sin_phi_ik));
+      jacobianhandler.add_to_coefficient(
+          equationindex, V_index_k,
+          V_i * (G_ik * sin_phi_ik - B_ik * cos_phi_ik));
+      jacobianhandler.add_to_coefficient(
+          equationindex, phi_index_k,
+          V_i * V_k * (-G_ik * cos_phi_ik - B_ik * sin_phi_ik));
+    }
+  }
+
+} // namespace Model::Power
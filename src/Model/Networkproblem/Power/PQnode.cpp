@@ -26,29 +26,52 @@ namespace Model::Power {
   std::string PQnode::get_type() { return "PQnode"; }
   std::string PQnode::get_power_type() const { return get_type(); }
   void PQnode::evaluate(
-      Eigen::Ref<Eigen::VectorXd> rootvalues, double, double new_time,
-      Eigen::Ref<Eigen::VectorXd const> const & /*last_state*/,
+      Eigen::Ref<Eigen::VectorXd> rootvalues, double last_time,
+      double new_time, Eigen::Ref<Eigen::VectorXd const> const &last_state,
       Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+    Linecache new_lines;
+    fill_line_cache(new_state, new_lines);
+    evaluate_on_lines(
+        rootvalues, last_time, new_time, last_state, new_state, new_lines);
+  }
+
+  void PQnode::evaluate_on_lines(
+      Eigen::Ref<Eigen::VectorXd> rootvalues, double /*last_time*/,
+      double new_time, Eigen::Ref<Eigen::VectorXd const> const & /*last_state*/,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Linecache const &new_lines) const {
     auto V_index = get_state_startindex();
     auto phi_index = V_index + 1;
-    rootvalues[V_index] = P(new_state) - boundaryvalue(new_time)[0];
-    rootvalues[phi_index] = Q(new_state) - boundaryvalue(new_time)[1];
+    rootvalues[V_index] = P(new_state, new_lines) - boundaryvalue(new_time)[0];
+    rootvalues[phi_index]
+        = Q(new_state, new_lines) - boundaryvalue(new_time)[1];
   }
 
   void PQnode::setup() { Powernode::setup_helper(); }
 
   void PQnode::d_evaluate_d_new_state(
-      Aux::Matrixhandler &jacobianhandler,
-      double // last_time
-      ,
-      double // new_time
-      ,
-      Eigen::Ref<Eigen::VectorXd const> const &,
+      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
       Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+    Linecache new_lines;
+    fill_line_cache(new_state, new_lines);
+    d_evaluate_d_new_state_on_lines(
+        jacobianhandler, last_time, new_time, last_state, new_state,
+        new_lines);
+  }
+
+  void PQnode::d_evaluate_d_new_state_on_lines(
+      Aux::Matrixhandler &jacobianhandler, double /*last_time*/,
+      double /*new_time*/,
+      Eigen::Ref<Eigen::VectorXd const> const & /*last_state*/,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Linecache const &new_lines) const {
     auto first_equation_index = get_state_startindex();
     auto second_equation_index = first_equation_index + 1;
-    evaluate_P_derivative(first_equation_index, jacobianhandler, new_state);
-    evaluate_Q_derivative(second_equation_index, jacobianhandler, new_state);
+    evaluate_P_derivative(
+        first_equation_index, jacobianhandler, new_state, new_lines);
+    evaluate_Q_derivative(
+        second_equation_index, jacobianhandler, new_state, new_lines);
   }
 
   void PQnode::d_evaluate_d_last_state(
@@ -57,6 +80,20 @@ namespace Model::Power {
       Eigen::Ref<Eigen::VectorXd const> const & /*last_state*/,
       Eigen::Ref<Eigen::VectorXd const> const & /*new_state*/) const {}
 
+  void PQnode::evaluate_with_derivative(
+      Eigen::Ref<Eigen::VectorXd> rootvalues,
+      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+    Linecache new_lines;
+    fill_line_cache(new_state, new_lines);
+    evaluate_on_lines(
+        rootvalues, last_time, new_time, last_state, new_state, new_lines);
+    d_evaluate_d_new_state_on_lines(
+        jacobianhandler, last_time, new_time, last_state, new_state,
+        new_lines);
+  }
+
   void PQnode::json_save(
       double time, Eigen::Ref<Eigen::VectorXd const> const &state) {
     auto P_val = boundaryvalue(time)[0];
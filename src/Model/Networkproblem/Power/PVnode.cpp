@@ -25,12 +25,23 @@ namespace Model::Power {
   std::string PVnode::get_power_type() const { return get_type(); }
 
   void PVnode::evaluate(
-      Eigen::Ref<Eigen::VectorXd> rootvalues, double, double new_time,
-      Eigen::Ref<Eigen::VectorXd const> const &,
+      Eigen::Ref<Eigen::VectorXd> rootvalues, double last_time,
+      double new_time, Eigen::Ref<Eigen::VectorXd const> const &last_state,
       Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+    Linecache new_lines;
+    fill_line_cache(new_state, new_lines);
+    evaluate_on_lines(
+        rootvalues, last_time, new_time, last_state, new_state, new_lines);
+  }
+
+  void PVnode::evaluate_on_lines(
+      Eigen::Ref<Eigen::VectorXd> rootvalues, double /*last_time*/,
+      double new_time, Eigen::Ref<Eigen::VectorXd const> const & /*last_state*/,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Linecache const &new_lines) const {
     auto V_index = get_state_startindex();
     auto phi_index = V_index + 1;
-    rootvalues[V_index] = P(new_state) - boundaryvalue(new_time)[0];
+    rootvalues[V_index] = P(new_state, new_lines) - boundaryvalue(new_time)[0];
 
     rootvalues[phi_index] = new_state[V_index] - boundaryvalue(new_time)[1];
   }
@@ -38,16 +49,25 @@ namespace Model::Power {
   void PVnode::setup() { Powernode::setup_helper(); }
 
   void PVnode::d_evaluate_d_new_state(
-      Aux::Matrixhandler &jacobianhandler,
-      double // last_time
-      ,
-      double // new_time
-      ,
-      Eigen::Ref<Eigen::VectorXd const> const &,
+      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
       Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+    Linecache new_lines;
+    fill_line_cache(new_state, new_lines);
+    d_evaluate_d_new_state_on_lines(
+        jacobianhandler, last_time, new_time, last_state, new_state,
+        new_lines);
+  }
+
+  void PVnode::d_evaluate_d_new_state_on_lines(
+      Aux::Matrixhandler &jacobianhandler, double /*last_time*/,
+      double /*new_time*/,
+      Eigen::Ref<Eigen::VectorXd const> const & /*last_state*/,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Linecache const &new_lines) const {
     auto V_index = get_state_startindex();
     auto phi_index = V_index + 1;
-    evaluate_P_derivative(V_index, jacobianhandler, new_state);
+    evaluate_P_derivative(V_index, jacobianhandler, new_state, new_lines);
     jacobianhandler.add_to_coefficient(phi_index, V_index, 1.0);
   }
 
@@ -57,6 +77,20 @@ namespace Model::Power {
       Eigen::Ref<Eigen::VectorXd const> const & /*last_state*/,
       Eigen::Ref<Eigen::VectorXd const> const & /*new_state*/) const {}
 
+  void PVnode::evaluate_with_derivative(
+      Eigen::Ref<Eigen::VectorXd> rootvalues,
+      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+    Linecache new_lines;
+    fill_line_cache(new_state, new_lines);
+    evaluate_on_lines(
+        rootvalues, last_time, new_time, last_state, new_state, new_lines);
+    d_evaluate_d_new_state_on_lines(
+        jacobianhandler, last_time, new_time, last_state, new_state,
+        new_lines);
+  }
+
   void PVnode::json_save(
       double time, Eigen::Ref<Eigen::VectorXd const> const &state) {
     auto P_val = boundaryvalue(time)[0];
@@ -21,7 +21,6 @@
 #include "Matrixhandler.hpp"
 #include "SimpleStatecomponent.hpp"
 #include "Statecomponent.hpp"
-#include "Transmissionline.hpp"
 #include "make_schema.hpp"
 #include <algorithm>
 #include <fstream>
@@ -74,33 +73,10 @@ namespace Model::Power {
 
   void Powernode::setup_helper() {
     setup_output_json_helper(get_id());
-    attached_component_data.clear();
-
-    for (auto &start_edge : get_starting_edges()) {
-      auto line = dynamic_cast<Transmissionline const *>(start_edge);
-      if (!line) {
-        continue;
-      }
-      auto *endnode = line->get_ending_powernode();
-
-      auto line_G = line->get_G();
-      auto line_B = line->get_B();
-
-      attached_component_data.push_back({line_G, line_B, endnode});
-    }
-
-    for (auto &end_edge : get_ending_edges()) {
-      auto line = dynamic_cast<Transmissionline const *>(end_edge);
-      if (!line) {
-        continue;
-      }
-      auto *startnode = line->get_starting_powernode();
-
-      auto line_G = line->get_G();
-      auto line_B = line->get_B();
-
-      attached_component_data.push_back({line_G, line_B, startnode});
-    }
+    set_admittancematrix(
+        std::make_shared<Admittancematrix const>(
+            std::vector<Powernode const *>{this}),
+        0);
   }
 
   double Powernode::get_G() const { return G; }
@@ -128,127 +104,88 @@ namespace Model::Power {
     output_json["data"].push_back(std::move(current_value));
   }
 
+  void Powernode::set_admittancematrix(
+      std::shared_ptr<Admittancematrix const> matrix, Eigen::Index _bus) {
+    admittancematrix = std::move(matrix);
+    bus = _bus;
+  }
+
+  void Powernode::fill_line_cache(
+      Eigen::Ref<Eigen::VectorXd const> const &state, Linecache &cache) const {
+    admittancematrix->fill_line_cache(state, bus, bus + 1, cache);
+  }
+
   double Powernode::P(Eigen::Ref<Eigen::VectorXd const> const &state) const {
-    auto V_index = get_state_startindex();
-    auto phi_index = V_index + 1;
-    auto G_i = get_G();
-
-    auto V_i = state[V_index];
-    auto phi_i = state[phi_index];
-
-    double P = 0.0;
-    P += G_i * V_i * V_i;
-    for (auto &triple : attached_component_data) {
-      auto G_ik = std::get<0>(triple);
-      auto B_ik = std::get<1>(triple);
-      auto *othernode = std::get<2>(triple);
-      auto V_index_k = othernode->get_state_startindex();
-      auto phi_index_k = V_index_k + 1;
-      auto V_k = state[V_index_k];
-      auto phi_k = state[phi_index_k];
-      auto phi_ik = phi_i - phi_k;
-      P += V_i * V_k * (G_ik * cos(phi_ik) + B_ik * sin(phi_ik));
-    }
-    return P;
+    Linecache cache;
+    fill_line_cache(state, cache);
+    return P(state, cache);
+  }
+
+  double Powernode::P(
+      Eigen::Ref<Eigen::VectorXd const> const &state,
+      Linecache const &cache) const {
+    return admittancematrix->P(bus, state, cache);
   }
 
   double Powernode::Q(Eigen::Ref<Eigen::VectorXd const> const &state) const {
-    auto V_index = get_state_startindex();
-    auto phi_index = V_index + 1;
-    auto B_i = get_B();
-    auto V_i = state[V_index];
-    auto phi_i = state[phi_index];
-
-    double Q = 0.0;
-    Q -= B_i * V_i * V_i;
-    for (auto &triple : attached_component_data) {
-
-      auto G_ik = std::get<0>(triple);
-      auto B_ik = std::get<1>(triple);
-      auto *othernode = std::get<2>(triple);
-      auto V_index_k = othernode->get_state_startindex();
-      auto phi_index_k = V_index_k + 1;
-      auto V_k = state[V_index_k];
-      auto phi_k = state[phi_index_k];
-      auto phi_ik = phi_i - phi_k;
-      Q += V_i * V_k * (G_ik * sin(phi_ik) - B_ik * cos(phi_ik));
-    }
-    return Q;
+    Linecache cache;
+    fill_line_cache(state, cache);
+    return Q(state, cache);
+  }
+
+  double Powernode::Q(
+      Eigen::Ref<Eigen::VectorXd const> const &state,
+      Linecache const &cache) const {
+    return admittancematrix->Q(bus, state, cache);
   }
 
   void Powernode::evaluate_P_derivative(
       Eigen::Index equationindex, Aux::Matrixhandler &jacobianhandler,
       Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
-    auto V_index = get_state_startindex();
-    auto phi_index = V_index + 1;
-    auto G_i = get_G();
-    auto V_i = new_state[V_index];
-    auto phi_i = new_state[phi_index];
-
-    jacobianhandler.add_to_coefficient(equationindex, V_index, 2 * G_i * V_i);
-    jacobianhandler.add_to_coefficient(equationindex, phi_index, 0.0);
-
-    for (auto &triple : attached_component_data) {
-      auto G_ik = std::get<0>(triple);
-      auto B_ik = std::get<1>(triple);
-      auto *othernode = std::get<2>(triple);
-      auto V_index_k = othernode->get_state_startindex();
-      auto phi_index_k = V_index_k + 1;
-      auto V_k = new_state[V_index_k];
-      auto phi_k = new_state[phi_index_k];
-      auto phi_ik = phi_i - phi_k;
-
-      jacobianhandler.add_to_coefficient(
-          equationindex, V_index,
-          V_k * (G_ik * cos(phi_ik) + B_ik * sin(phi_ik)));
-      jacobianhandler.add_to_coefficient(
-          equationindex, phi_index,
-          V_i * V_k * (-G_ik * sin(phi_ik) + B_ik * cos(phi_ik)));
-
-      jacobianhandler.add_to_coefficient(
-          equationindex, V_index_k,
-          V_i * (G_ik * cos(phi_ik) + B_ik * sin(phi_ik)));
-      jacobianhandler.add_to_coefficient(
-          equationindex, phi_index_k,
-          V_i * V_k * (G_ik * sin(phi_ik) - B_ik * cos(phi_ik)));
-    }
+    Linecache cache;
+    fill_line_cache(new_state, cache);
+    evaluate_P_derivative(equationindex, jacobianhandler, new_state, cache);
+  }
+
+  void Powernode::evaluate_P_derivative(
+      Eigen::Index equationindex, Aux::Matrixhandler &jacobianhandler,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Linecache const &cache) const {
+    admittancematrix->add_P_derivative(
+        equationindex, jacobianhandler, bus, new_state, cache);
   }
 
   void Powernode::evaluate_Q_derivative(
       Eigen::Index equationindex, Aux::Matrixhandler &jacobianhandler,
       Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
-    auto V_index = get_state_startindex();
-    auto phi_index = V_index + 1;
-    auto B_i = get_B();
-    auto V_i = new_state[V_index];
-    auto phi_i = new_state[phi_index];
-
-    jacobianhandler.add_to_coefficient(equationindex, V_index, -2 * B_i * V_i);
-    jacobianhandler.add_to_coefficient(equationindex, phi_index, 0.0);
-
-    for (auto &triple : attached_component_data) {
-      auto G_ik = std::get<0>(triple);
-      auto B_ik = std::get<1>(triple);
-      auto *othernode = std::get<2>(triple);
-      auto V_index_k = othernode->get_state_startindex();
-      auto phi_index_k = V_index_k + 1;
-      auto V_k = new_state[V_index_k];
-      auto phi_k = new_state[phi_index_k];
-      auto phi_ik = phi_i - phi_k;
-
-      jacobianhandler.add_to_coefficient(
-          equationindex, V_index,
-          V_k * (G_ik * sin(phi_ik) - B_ik * cos(phi_ik)));
-      jacobianhandler.add_to_coefficient(
-          equationindex, phi_index,
-          V_i * V_k * (G_ik * cos(phi_ik) + B_ik * sin(phi_ik)));
-      jacobianhandler.add_to_coefficient(
-          equationindex, V_index_k,
-          V_i * (G_ik * sin(phi_ik) - B_ik * cos(phi_ik)));
-      jacobianhandler.add_to_coefficient(
-          equationindex, phi_index_k,
-          V_i * V_k * (-G_ik * cos(phi_ik) - B_ik * sin(phi_ik)));
-    }
+    Linecache cache;
+    fill_line_cache(new_state, cache);
+    evaluate_Q_derivative(equationindex, jacobianhandler, new_state, cache);
+  }
+
+  void Powernode::evaluate_Q_derivative(
+      Eigen::Index equationindex, Aux::Matrixhandler &jacobianhandler,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Linecache const &cache) const {
+    admittancematrix->add_Q_derivative(
+        equationindex, jacobianhandler, bus, new_state, cache);
+  }
+
+  void Powernode::evaluate_on_lines(
+      Eigen::Ref<Eigen::VectorXd> rootvalues, double last_time,
+      double new_time, Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Linecache const & /*new_lines*/) const {
+    evaluate(rootvalues, last_time, new_time, last_state, new_state);
+  }
+
+  void Powernode::d_evaluate_d_new_state_on_lines(
+      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Linecache const & /*new_lines*/) const {
+    d_evaluate_d_new_state(
+        jacobianhandler, last_time, new_time, last_state, new_state);
   }
 
 } // namespace Model::Power
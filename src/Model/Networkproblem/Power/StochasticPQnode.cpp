@@ -76,27 +76,40 @@ namespace Model::Power {
   }
 
   void StochasticPQnode::evaluate(
+      Eigen::Ref<Eigen::VectorXd> rootvalues, double last_time,
+      double new_time, Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+    Linecache new_lines;
+    fill_line_cache(new_state, new_lines);
+    evaluate_on_lines(
+        rootvalues, last_time, new_time, last_state, new_state, new_lines);
+  }
+
+  void StochasticPQnode::evaluate_on_lines(
       Eigen::Ref<Eigen::VectorXd> rootvalues, double /*last_time*/,
       double /*new_time*/,
       Eigen::Ref<Eigen::VectorXd const> const & /*last_state*/,
-      Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Linecache const &new_lines) const {
     auto V_index = get_state_startindex();
     auto phi_index = V_index + 1;
-    rootvalues[V_index] = P(new_state) - current_P;
-    rootvalues[phi_index] = Q(new_state) - current_Q;
+    rootvalues[V_index] = P(new_state, new_lines) - current_P;
+    rootvalues[phi_index] = Q(new_state, new_lines) - current_Q;
   }
 
   void StochasticPQnode::prepare_timestep(
       double last_time, double new_time,
       Eigen::Ref<Eigen::VectorXd const> const &last_state) {
-    auto last_P = P(last_state);
+    Linecache cache;
+    fill_line_cache(last_state, cache);
+    auto last_P = P(last_state, cache);
     current_P = Aux::euler_maruyama_oup(
         stochasticdata->stability_parameter, stochasticdata->cut_off_factor,
         last_P, stochasticdata->theta_P, boundaryvalue(new_time)[0],
         new_time - last_time, stochasticdata->sigma_P,
         stochasticdata->distribution,
         stochasticdata->number_of_stochastic_steps);
-    auto last_Q = Q(last_state);
+    auto last_Q = Q(last_state, cache);
     current_Q = Aux::euler_maruyama_oup(
         stochasticdata->stability_parameter, stochasticdata->cut_off_factor,
         last_Q, stochasticdata->theta_Q, boundaryvalue(new_time)[1],
@@ -131,14 +144,28 @@ namespace Model::Power {
   // }
 
   void StochasticPQnode::d_evaluate_d_new_state(
+      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+    Linecache new_lines;
+    fill_line_cache(new_state, new_lines);
+    d_evaluate_d_new_state_on_lines(
+        jacobianhandler, last_time, new_time, last_state, new_state,
+        new_lines);
+  }
+
+  void StochasticPQnode::d_evaluate_d_new_state_on_lines(
       Aux::Matrixhandler &jacobianhandler, double /*last_time*/,
       double /*new_time*/,
       Eigen::Ref<Eigen::VectorXd const> const & /*last_state*/,
-      Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Linecache const &new_lines) const {
     auto first_equation_index = get_state_startindex();
     auto second_equation_index = first_equation_index + 1;
-    evaluate_P_derivative(first_equation_index, jacobianhandler, new_state);
-    evaluate_Q_derivative(second_equation_index, jacobianhandler, new_state);
+    evaluate_P_derivative(
+        first_equation_index, jacobianhandler, new_state, new_lines);
+    evaluate_Q_derivative(
+        second_equation_index, jacobianhandler, new_state, new_lines);
   }
 
   void StochasticPQnode::d_evaluate_d_last_state(
@@ -147,6 +174,20 @@ namespace Model::Power {
       Eigen::Ref<Eigen::VectorXd const> const & /*last_state*/,
       Eigen::Ref<Eigen::VectorXd const> const & /*new_state*/) const {}
 
+  void StochasticPQnode::evaluate_with_derivative(
+      Eigen::Ref<Eigen::VectorXd> rootvalues,
+      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state) const {
+    Linecache new_lines;
+    fill_line_cache(new_state, new_lines);
+    evaluate_on_lines(
+        rootvalues, last_time, new_time, last_state, new_state, new_lines);
+    d_evaluate_d_new_state_on_lines(
+        jacobianhandler, last_time, new_time, last_state, new_state,
+        new_lines);
+  }
+
   void StochasticPQnode::json_save(
       double time, Eigen::Ref<Eigen::VectorXd const> const &state) {
     auto P_val = current_P;
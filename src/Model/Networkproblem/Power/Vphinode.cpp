@@ -56,8 +56,10 @@ namespace Model::Power {
 
   void Vphinode::json_save(
       double time, Eigen::Ref<Eigen::VectorXd const> const &state) {
-    auto P_val = P(state);
-    auto Q_val = Q(state);
+    Linecache cache;
+    fill_line_cache(state, cache);
+    auto P_val = P(state, cache);
+    auto Q_val = Q(state, cache);
     json_save_power(time, state, P_val, Q_val);
   }
 
@@ -0,0 +1,106 @@
+/*
+ * Grazer - network simulation and optimization tool
+ *
+ * Copyright 2020-2022 Uni Mannheim <e.fokken+grazer@posteo.de>,
+ *
+ * SPDX-License-Identifier:	MIT
+ *
+ * Licensed under the MIT License, found in the file LICENSE and at
+ * https://opensource.org/licenses/MIT
+ * This file may not be copied, modified, or distributed except according to
+ * those terms.
+ *
+ * Distributed on an "AS IS" BASIS, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied.  See your chosen license for details.
+ *
+ */
+#pragma once
+#include <Eigen/Dense>
+#include <vector>
+
+namespace Aux {
+  class Matrixhandler;
+}
+
+namespace Model::Power {
+
+  class Powernode;
+
+  /** \brief The bus admittance matrix of a power network in compressed
+   * sparse row format.
+   *
+   * Row k holds the admittances G_ik + i B_ik of all transmission lines
+   * attached to bus k, together with the state index of V_k of the bus at
+   * their other end. The shunt admittance of bus k is kept separately. The
+   * lines of all buses lie contiguously in memory, so the trigonometric
+   * functions of all phase differences can be evaluated in one pass.
+   */
+  class Admittancematrix {
+
+  public:
+    /** \brief V_k, cos(phi_i - phi_k) and sin(phi_i - phi_k) of the lines of
+     * some consecutive buses at one state.
+     *
+     * The values of line j of the matrix are stored at j - first_line.
+     */
+    struct Linecache {
+      Eigen::Index first_line{0};
+      Eigen::ArrayXd V_k;
+      Eigen::ArrayXd cos_phi_ik;
+      Eigen::ArrayXd sin_phi_ik;
+    };
+
+    /** \brief Collects the transmission lines of buses, whose state indices
+     * must be set already.
+     *
+     * Row k of the matrix belongs to buses[k].
+     */
+    Admittancematrix(std::vector<Powernode const *> const &buses);
+
+    Eigen::Index get_number_of_buses() const;
+
+    /** \brief Fills cache with the line values of the buses [first_bus,
+     * after_bus) at state.
+     */
+    void fill_line_cache(
+        Eigen::Ref<Eigen::VectorXd const> const &state, Eigen::Index first_bus,
+        Eigen::Index after_bus, Linecache &cache) const;
+
+    /// \brief Active power flowing into the network at bus.
+    double
+    P(Eigen::Index bus, Eigen::Ref<Eigen::VectorXd const> const &state,
+      Linecache const &cache) const;
+
+    /// \brief Reactive power flowing into the network at bus.
+    double
+    Q(Eigen::Index bus, Eigen::Ref<Eigen::VectorXd const> const &state,
+      Linecache const &cache) const;
+
+    /// \brief Adds the derivative of #P at bus to the row equationindex.
+    void add_P_derivative(
+        Eigen::Index equationindex, Aux::Matrixhandler &jacobianhandler,
+        Eigen::Index bus, Eigen::Ref<Eigen::VectorXd const> const &state,
+        Linecache const &cache) const;
+
+    /// \brief Adds the derivative of #Q at bus to the row equationindex.
+    void add_Q_derivative(
+        Eigen::Index equationindex, Aux::Matrixhandler &jacobianhandler,
+        Eigen::Index bus, Eigen::Ref<Eigen::VectorXd const> const &state,
+        Linecache const &cache) const;
+
+  private:
+    /// The lines of bus k are [row_starts[k], row_starts[k + 1]).
+    std::vector<Eigen::Index> row_starts;
+    /// State index of V_i of each bus, phi_i follows it.
+    std::vector<Eigen::Index> bus_V_indices;
+    Eigen::ArrayXd shunt_G;
+    Eigen::ArrayXd shunt_B;
+
+    /// State index of V_k of the bus at the other end of each line, phi_k
+    /// follows it.
+    std::vector<Eigen::Index> line_V_indices;
+    Eigen::ArrayXd line_G;
+    Eigen::ArrayXd line_B;
+  };
+
+} // namespace Model::Power
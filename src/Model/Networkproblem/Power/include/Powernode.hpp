@@ -15,12 +15,14 @@
  *
  */
 #pragma once
+#include "Admittancematrix.hpp"
 #include "Boundaryvaluecomponent.hpp"
 #include "Equationcomponent.hpp"
 #include "InterpolatingVector.hpp"
 #include "Node.hpp"
 #include "SimpleStatecomponent.hpp"
 #include <Eigen/Sparse>
+#include <memory>
 
 namespace Model::Power {
 
@@ -50,14 +52,75 @@ namespace Model::Power {
         Eigen::Ref<Eigen::VectorXd> new_state,
         nlohmann::json const &initial_json) const final;
 
+    /** \brief Makes this node read its transmission lines from row bus of
+     * a matrix shared with other nodes.
+     *
+     * Until then, #setup_helper gives each node a matrix of its own.
+     */
+    void set_admittancematrix(
+        std::shared_ptr<Admittancematrix const> matrix, Eigen::Index bus);
+
+    /** \brief The voltages V_k at the other ends of all attached
+     * transmission lines and sin and cos of the phase differences phi_i -
+     * phi_k at one state.
+     *
+     * Filled once by #fill_line_cache, it serves #P, #Q and their derivatives
+     * at that state, so that sin and cos are evaluated only once per line.
+     * A cache filled by the shared Admittancematrix for many nodes serves
+     * all of them.
+     */
+    using Linecache = Admittancematrix::Linecache;
+
+    void fill_line_cache(
+        Eigen::Ref<Eigen::VectorXd const> const &state,
+        Linecache &cache) const;
+
     double P(Eigen::Ref<Eigen::VectorXd const> const &state) const;
+    double P(
+        Eigen::Ref<Eigen::VectorXd const> const &state,
+        Linecache const &cache) const;
     double Q(Eigen::Ref<Eigen::VectorXd const> const &state) const;
+    double Q(
+        Eigen::Ref<Eigen::VectorXd const> const &state,
+        Linecache const &cache) const;
     void evaluate_P_derivative(
         Eigen::Index equationindex, Aux::Matrixhandler &jacobianhandler,
         Eigen::Ref<Eigen::VectorXd const> const &new_state) const;
+    void evaluate_P_derivative(
+        Eigen::Index equationindex, Aux::Matrixhandler &jacobianhandler,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state,
+        Linecache const &cache) const;
     void evaluate_Q_derivative(
         Eigen::Index equationindex, Aux::Matrixhandler &jacobianhandler,
         Eigen::Ref<Eigen::VectorXd const> const &new_state) const;
+    void evaluate_Q_derivative(
+        Eigen::Index equationindex, Aux::Matrixhandler &jacobianhandler,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state,
+        Linecache const &cache) const;
+
+    /** \brief Like #evaluate, but with the line values of new_state in
+     * new_lines.
+     *
+     * The default ignores new_lines, nodes whose equations contain P or Q
+     * override it.
+     */
+    virtual void evaluate_on_lines(
+        Eigen::Ref<Eigen::VectorXd> rootvalues, double last_time,
+        double new_time, Eigen::Ref<Eigen::VectorXd const> const &last_state,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state,
+        Linecache const &new_lines) const;
+
+    /** \brief Like #d_evaluate_d_new_state, but with the line values of
+     * new_state in new_lines.
+     *
+     * The default ignores new_lines, nodes whose equations contain P or Q
+     * override it.
+     */
+    virtual void d_evaluate_d_new_state_on_lines(
+        Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+        Eigen::Ref<Eigen::VectorXd const> const &last_state,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state,
+        Linecache const &new_lines) const;
 
   protected:
     void setup_helper();
@@ -75,11 +138,9 @@ namespace Model::Power {
     /// \brief number of state variables, this component needs.
     static constexpr Eigen::Index number_of_state_variables{2};
 
-    /// \brief Holds data on all attached transmission lines.
-    std::vector<std::tuple<double, double, Powernode *>>
-        attached_component_data;
-    // TODO: Should be replaced by a struct {double line_G, double line_B, ... *
-    // node}
+    /// \brief Holds the attached transmission lines in row #bus.
+    std::shared_ptr<Admittancematrix const> admittancematrix;
+    Eigen::Index bus{0};
   };
 
 } // namespace Model::Power
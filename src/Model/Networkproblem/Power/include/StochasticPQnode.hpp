@@ -54,6 +54,24 @@ namespace Model::Power {
         Eigen::Ref<Eigen::VectorXd const> const & /*last_state*/,
         Eigen::Ref<Eigen::VectorXd const> const & /*new_state*/) const final;
 
+    void evaluate_with_derivative(
+        Eigen::Ref<Eigen::VectorXd> rootvalues,
+        Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+        Eigen::Ref<Eigen::VectorXd const> const &last_state,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state) const final;
+
+    void evaluate_on_lines(
+        Eigen::Ref<Eigen::VectorXd> rootvalues, double last_time,
+        double new_time, Eigen::Ref<Eigen::VectorXd const> const &last_state,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state,
+        Linecache const &new_lines) const final;
+
+    void d_evaluate_d_new_state_on_lines(
+        Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+        Eigen::Ref<Eigen::VectorXd const> const &last_state,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state,
+        Linecache const &new_lines) const final;
+
     void prepare_timestep(
         double last_time, double new_time,
         Eigen::Ref<Eigen::VectorXd const> const &last_state) final;
@@ -19,18 +19,28 @@
 #include "Statecomponent.hpp"
 #include "Timedata.hpp"
 #include <Eigen/Sparse>
+#include <array>
+#include <cstddef>
+#include <functional>
 #include <memory>
+#include <typeindex>
 #include <vector>
 
 namespace Network {
   class Net;
 }
+namespace Aux {
+  class Threadpool;
+}
 
 // This namespace holds all data relating to problems that construct the model
 // equations from a network from the namespace Network.
 namespace Model {
 
   class Equationcomponent;
+  namespace Power {
+    class Admittancematrix;
+  }
 
   // This class defines a problem, that builds the model equations from a
   // network.
@@ -63,6 +73,16 @@ namespace Model {
         Eigen::Index next_free_control_index = 0,
         Eigen::Index next_free_constraint_index = 0);
 
+    /** \brief Makes #init() number the states in a reverse Cuthill-McKee
+     * order of the network graph instead of in the order of the components.
+     *
+     * Neighbouring nodes and edges then get neighbouring state indices, which
+     * reduces the bandwidth of the jacobian and so the fill-in of its
+     * factorization. Only the state indices change, the outputs are still
+     * written per component. Must be called before #init().
+     */
+    void order_states_by_topology();
+
     ////////////////////////////////////////////////////////////////////////////
     // Statecomponent methods
     ////////////////////////////////////////////////////////////////////////////
@@ -105,6 +125,13 @@ namespace Model {
         Eigen::Ref<Eigen::VectorXd const> const &new_state,
         Eigen::Ref<Eigen::VectorXd const> const &control) const final;
 
+    void evaluate_with_derivative(
+        Eigen::Ref<Eigen::VectorXd> rootvalues, Aux::Matrixhandler &jacobian,
+        double last_time, double new_time,
+        Eigen::Ref<Eigen::VectorXd const> const &last_state,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state,
+        Eigen::Ref<Eigen::VectorXd const> const &control) const final;
+
     void d_evaluate_d_control(
         Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
         Eigen::Ref<Eigen::VectorXd const> const &last_state,
@@ -127,6 +154,21 @@ namespace Model {
 
     void setup() final;
 
+    /** \brief Partitions the network graph into connected pieces of
+     * roughly equal numbers of states.
+     *
+     * The nodes are ordered by breadth-first searches, each followed by its
+     * edges, that are not listed yet. This order is cut into
+     * number_of_subdomains contiguous parts, so that the parts are mostly
+     * connected and touch each other only at few nodes.
+     */
+    std::vector<std::vector<std::pair<Eigen::Index, Eigen::Index>>>
+    get_subdomains(int number_of_subdomains) const final;
+
+    /// \brief Collects the condensable ranges of all components.
+    std::vector<std::pair<Eigen::Index, Eigen::Index>>
+    get_condensable_ranges() const final;
+
     void save_controls_to_json(
         Aux::InterpolatingVector_Base const &controls,
         nlohmann::json &json) const final;
@@ -203,13 +245,128 @@ namespace Model {
   public:
     Network::Net const &get_network() const;
 
+    /** \brief Lets #evaluate, #evaluate_with_derivative and the state
+     * derivatives run in number_of_threads threads.
+     *
+     * For #evaluate the components are split into contiguous parts of
+     * roughly equal numbers of states, one per thread. The split depends only
+     * on the components, so results do not depend on the scheduling. For the
+     * derivatives see #assemble_derivative. Must be called after #init().
+     * With one thread, everything runs serially again.
+     */
+    void set_number_of_threads(int number_of_threads);
+
   private:
+    /** \brief Which calls to Aux::Matrixhandler::add_to_coefficient each
+     * component makes in a derivative, and an ordered coloring of the
+     * components.
+     */
+    struct Assemblyplan {
+      /// The calls of component k are [call_starts[k], call_starts[k + 1]),
+      /// counted from the first call of the whole derivative. The components
+      /// are numbered like in #assemble_derivative.
+      std::vector<std::size_t> call_starts;
+      /// The components of each color in increasing order. Components of the
+      /// same color write to different rows. If two components write to a
+      /// common row, the later one has the greater color.
+      std::vector<std::vector<std::size_t>> color_classes;
+    };
+
+    /** \brief A maximal range [first, after) of #equationcomponents or
+     * #controlcomponents of the same concrete type.
+     */
+    struct Componentbucket {
+      std::type_index type;
+      std::size_t first;
+      std::size_t after;
+    };
+
+    /** \brief Sorts components by their concrete type, in the order of the
+     * first appearance of each type, and returns the resulting buckets.
+     */
+    template <typename Componenttype>
+    static std::vector<Componentbucket>
+    group_by_type(std::vector<Componenttype *> &components);
+
+    /** \brief Returns the buckets of the maximal runs of components with the
+     * same concrete type, without reordering them.
+     */
+    template <typename Componenttype>
+    static std::vector<Componentbucket>
+    find_buckets(std::vector<Componenttype *> const &components);
+
+    /** \brief Calls kernel(component) for the components [first, after).
+     *
+     * In every bucket of a known final component class, kernel is called
+     * with a pointer to that class, so that it can make non-virtual calls.
+     */
+    template <typename Componenttype, typename Kernel>
+    static void run_buckets(
+        std::vector<Componenttype *> const &components,
+        std::vector<Componentbucket> const &buckets, std::size_t first,
+        std::size_t after, Kernel const &kernel);
+
+    /** \brief Runs the equation and control components [first, after),
+     * counting first the #equationcomponents and then the
+     * #controlcomponents, with run_buckets().
+     */
+    template <typename Equationkernel, typename Controlkernel>
+    void run_components(
+        std::size_t first, std::size_t after,
+        Equationkernel const &equationkernel,
+        Controlkernel const &controlkernel) const;
+
+    /** \brief Computes a derivative of all equation and control components
+     * into jacobianhandler.
+     *
+     * derive_components(first, after, handler) must compute the derivatives
+     * of the components [first, after), counting first the
+     * #equationcomponents and then the #controlcomponents.
+     *
+     * If a #threadpool is present and jacobianhandler is an Aux::Slothandler,
+     * the first call records the plan for its kind of Aux::Slothandler,
+     * plans[Aux::Regular] or plans[Aux::Transposed], and all following calls
+     * assemble the
+     * color classes one after the other, each color class in parallel and
+     * directly into the value array of the matrix. Because of the ordering
+     * of the colors, every coefficient sums up its contributions in the same
+     * order as in serial assembly, so the results are bit-identical.
+     */
+    void assemble_derivative(
+        Aux::Matrixhandler &jacobianhandler, std::array<Assemblyplan, 2> &plans,
+        std::function<void(std::size_t, std::size_t, Aux::Matrixhandler &)>
+            const &derive_components) const;
+
     std::unique_ptr<Network::Net> network;
+    /// Sorted by concrete type, see #equationcomponent_buckets.
     std::vector<Equationcomponent *> equationcomponents;
     std::vector<Statecomponent *> statecomponents;
+    /// The order in which #set_state_indices numbers #statecomponents.
+    std::vector<Statecomponent *> state_index_order;
     std::vector<Controlcomponent *> controlcomponents;
     std::vector<Costcomponent *> costcomponents;
     std::vector<Constraintcomponent *> constraintcomponents;
+    std::vector<Componentbucket> equationcomponent_buckets;
+    /// The #controlcomponents keep the order of the network, because their
+    /// order numbers the controls.
+    std::vector<Componentbucket> controlcomponent_buckets;
+
+    /// The transmission lines of all power nodes, whose line values
+    /// #evaluate and the state derivatives compute at once. Only present, if
+    /// there are power nodes.
+    std::shared_ptr<Power::Admittancematrix const> admittancematrix;
+
+    /// Only present, if #set_number_of_threads was called with more than one
+    /// thread.
+    std::unique_ptr<Aux::Threadpool> threadpool;
+    /// The components [part_starts[k], part_starts[k + 1]) are evaluated by
+    /// the thread k of #threadpool.
+    std::vector<std::size_t> equationcomponent_part_starts;
+    std::vector<std::size_t> controlcomponent_part_starts;
+    /// Plans for the parallel assembly of the state derivatives.
+    mutable std::array<Assemblyplan, 2> new_state_plans;
+    mutable std::array<Assemblyplan, 2> last_state_plans;
+    mutable std::array<Assemblyplan, 2> evaluate_with_derivative_plans;
   };
 
 } // namespace Model
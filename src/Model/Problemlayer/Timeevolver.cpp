@@ -22,9 +22,13 @@
 #include "make_schema.hpp"
 #include "schema_validation.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <nlohmann/json.hpp>
 
@@ -40,6 +44,85 @@ namespace Model {
     Aux::schema::add_required(schema, "retries", Aux::schema::type::number());
     Aux::schema::add_required(
         schema, "use_simplified_newton", Aux::schema::type::boolean());
+    auto linear_solver_schema = Aux::schema::type::string(
+        "The linear solver for the jacobians, defaults to SparseLU. With "
+        "jacobian_free_newton it only preconditions and defaults to "
+        "BlockJacobi.");
+    linear_solver_schema["enum"] = Solver::get_linearsolver_names();
+    Aux::schema::add_property(schema, "linear_solver", linear_solver_schema);
+    Aux::schema::add_property(
+        schema, "reuse_pivots",
+        Aux::schema::type::boolean(
+            "Refactorize jacobians with the old pivot sequence. Only "
+            "supported by the linear solver KLU."));
+    Aux::schema::add_property(
+        schema, "jacobian_free_newton",
+        Aux::schema::type::boolean(
+            "Solve for the Newton steps with GMRES from finite differences of "
+            "the model equations. The linear solver then only preconditions, "
+            "by default with the blocks of the pipes."));
+    Aux::schema::add_property(
+        schema, "use_broyden_updates",
+        Aux::schema::type::boolean(
+            "Improve the jacobian of simplified Newton iterations by Broyden "
+            "updates after every step."));
+    Aux::schema::add_property(
+        schema, "reuse_jacobian_across_timesteps",
+        Aux::schema::type::boolean(
+            "Keep the factorized jacobian over several time steps. Only used "
+            "together with use_simplified_newton."));
+    Aux::schema::add_property(
+        schema, "jacobian_refresh_contraction",
+        Aux::schema::type::number(
+            "Refresh a kept jacobian after a time step with a worse Newton "
+            "contraction rate than this."));
+    Aux::schema::add_property(
+        schema, "jacobian_refresh_iterations",
+        Aux::schema::type::number(
+            "Refresh a kept jacobian after a time step with more Newton "
+            "iterations than this."));
+    Aux::schema::add_property(
+        schema, "use_adaptive_timesteps",
+        Aux::schema::type::boolean(
+            "Choose the time steps by a local error estimate and interpolate "
+            "the results to the output time points. Can't be used for "
+            "optimization."));
+    Aux::schema::add_property(
+        schema, "adaptive_tolerance",
+        Aux::schema::type::number(
+            "Relative and absolute tolerance for the local error estimate of "
+            "adaptive time steps."));
+    Aux::schema::add_property(
+        schema, "minimal_delta_t",
+        Aux::schema::type::number(
+            "Smallest admissible adaptive time step or pseudo time step of "
+            "the stationary solve."));
+    Aux::schema::add_property(
+        schema, "maximal_delta_t",
+        Aux::schema::type::number(
+            "Largest admissible adaptive time step or pseudo time step of the "
+            "stationary solve."));
+    auto predictor_order_schema = Aux::schema::type::number(
+        "Polynomial order of the extrapolation from the last accepted states, "
+        "that gives the initial guess of the Newton method. 0 starts from the "
+        "last state.");
+    predictor_order_schema["enum"] = {0, 1, 2};
+    Aux::schema::add_property(
+        schema, "predictor_order", predictor_order_schema);
+    auto number_of_threads_schema = Aux::schema::type::number(
+        "Number of threads for the evaluation of the model equations and "
+        "for the linear solvers \"Condensation\" and "
+        "\"DomainDecomposition\", defaults to 1.");
+    number_of_threads_schema["minimum"] = 1;
+    Aux::schema::add_property(
+        schema, "number_of_threads", number_of_threads_schema);
+    auto state_ordering_schema = Aux::schema::type::string(
+        "Order of the state indices: \"components\" numbers the components "
+        "in the order of the problem json, \"reverse_cuthill_mckee\" along "
+        "the network graph, which reduces the fill-in of the jacobian "
+        "factorizations. Defaults to \"components\".");
+    state_ordering_schema["enum"] = {"components", "reverse_cuthill_mckee"};
+    Aux::schema::add_property(schema, "state_ordering", state_ordering_schema);
 
     return schema;
   }
@@ -59,9 +142,40 @@ namespace Model {
   Timeevolver::Timeevolver(nlohmann::json const &timeevolver_data) :
       solver(
           timeevolver_data["tolerance"],
-          timeevolver_data["maximal_number_of_newton_iterations"]),
+          timeevolver_data["maximal_number_of_newton_iterations"],
+          timeevolver_data.value(
+              "linear_solver",
+              timeevolver_data.value("jacobian_free_newton", false)
+                  ? "BlockJacobi"
+                  : "SparseLU"),
+          timeevolver_data.value("reuse_pivots", false),
+          timeevolver_data.value("jacobian_free_newton", false),
+          timeevolver_data.value("use_broyden_updates", false)),
       retries(timeevolver_data["retries"]),
-      use_simplified_newton(timeevolver_data["use_simplified_newton"]) {}
+      use_simplified_newton(timeevolver_data["use_simplified_newton"]),
+      reuse_jacobian_across_timesteps(
+          timeevolver_data.value("reuse_jacobian_across_timesteps", false)),
+      jacobian_refresh_contraction(
+          timeevolver_data.value("jacobian_refresh_contraction", 0.5)),
+      jacobian_refresh_iterations(
+          timeevolver_data.value("jacobian_refresh_iterations", 3)),
+      use_adaptive_timesteps(
+          timeevolver_data.value("use_adaptive_timesteps", false)),
+      adaptive_tolerance(timeevolver_data.value("adaptive_tolerance", 1e-4)),
+      minimal_delta_t(timeevolver_data.value("minimal_delta_t", 1e-3)),
+      maximal_delta_t(timeevolver_data.value(
+          "maximal_delta_t", std::numeric_limits<double>::max())),
+      predictor_order(timeevolver_data.value("predictor_order", 0)),
+      steady_state_tolerance(timeevolver_data["tolerance"]) {
+    if (timeevolver_data.value("reuse_pivots", false)
+        and not solver.can_reuse_pivots()) {
+      gthrow(
+          {"The option \"reuse_pivots\" is set, but the linear solver can't "
+           "reuse pivots. Use \"KLU\" or unset the option."});
+    }
+    solver.set_number_of_threads(
+        timeevolver_data.value("number_of_threads", 1));
+  }
 
   void Timeevolver::simulate(
       Eigen::Ref<Eigen::VectorXd const> const &initial_state,
@@ -83,14 +197,12 @@ namespace Model {
       current_controls = controls(new_time);
     }
 
-    // TODO: include logic to hand in a jacobian, if this method is called from
-    // optimization. In that case we don't have to re-allocate the jacobian on
-    // every optimization step!
-
-    // Here we set the Jacobian structure, never to be
-    // changed again.
-    solver.evaluate_state_derivative_triplets(
+    // Here we set the Jacobian structure. If this method is called repeatedly,
+    // e.g. from optimization, the structure and its analysis from the first
+    // call are kept.
+    solver.evaluate_state_derivative_keep_pattern(
         problem, last_time, new_time, last_state, new_state, current_controls);
+    refresh_jacobian = true;
     // std::cout << "Number of rows (== number of cols) of Jacobian: "
     //           << solver.get_dimension_of_jacobian() << std::endl;
     // std::cout << "Number of nonzeros in Jacobian: "
@@ -100,12 +212,20 @@ namespace Model {
     // // csv heading:
     // std::cout << "t, residual, used_iterations" << std::endl;
 
+    if (use_adaptive_timesteps) {
+      simulate_adaptively(controls, problem, saved_states);
+      return;
+    }
+
+    std::deque<double> accepted_times{last_time};
+    std::deque<Eigen::VectorXd> accepted_states{last_state};
     for (int i = 1; i != saved_states.size(); ++i) {
       new_time = saved_states.interpolation_point_at_index(i);
       if (actual_controls) {
         current_controls = controls(new_time);
       }
 
+      extrapolate(accepted_times, accepted_states, new_time, new_state);
       auto solstruct = make_one_step(
           last_time, new_time, last_state, new_state, current_controls,
           problem);
@@ -118,10 +238,182 @@ namespace Model {
       saved_states.mut_timestep(i) = new_state;
       last_time = new_time;
       last_state = new_state;
+      remember_accepted_state(
+          accepted_times, accepted_states, new_time, new_state);
     }
     // std::cout << "=== simulation end ===" << std::endl; // provide regex help
   }
 
+  bool Timeevolver::uses_adaptive_timesteps() const {
+    return use_adaptive_timesteps;
+  }
+
+  void Timeevolver::simulate_adaptively(
+      Aux::InterpolatingVector_Base const &controls, Controlcomponent &problem,
+      Aux::InterpolatingVector_Base &saved_states) {
+    // Safety factor and bounds for the change of the time step:
+    double const safety = 0.9;
+    double const minimal_factor = 0.2;
+    double const maximal_factor = 5.0;
+
+    double const end_time
+        = saved_states.interpolation_point_at_index(saved_states.size() - 1);
+    double last_time = saved_states.interpolation_point_at_index(0);
+    Eigen::VectorXd last_state = saved_states.vector_at_index(0);
+    Eigen::VectorXd new_state = last_state;
+
+    // The accepted state before last_state, needed for the error estimate.
+    double previous_time = last_time;
+    Eigen::VectorXd previous_state;
+    bool have_previous_state = false;
+
+    std::deque<double> accepted_times{last_time};
+    std::deque<Eigen::VectorXd> accepted_states{last_state};
+
+    Eigen::VectorXd current_controls;
+    bool actual_controls = (controls.get_inner_length() > 0);
+
+    // The first step has no error estimate, so it is chosen small. The
+    // following steps grow quickly, if the solution is smooth.
+    Eigen::Index next_saved_index = 1;
+    double delta_t = std::clamp(
+        0.01 * (saved_states.interpolation_point_at_index(1) - last_time),
+        minimal_delta_t, maximal_delta_t);
+    // The end of a step of length step_length from last_time. A remainder
+    // before end_time, that is shorter than minimal_delta_t, is avoided by
+    // ending the step minimal_delta_t before end_time or, if there is no room
+    // for that, at end_time.
+    auto step_end = [&](double step_length) {
+      double const new_time = last_time + step_length;
+      if (end_time - new_time >= minimal_delta_t) {
+        return new_time;
+      }
+      if (new_time < end_time
+          and end_time - last_time >= 2 * minimal_delta_t) {
+        return end_time - minimal_delta_t;
+      }
+      return end_time;
+    };
+    while (last_time < end_time) {
+      double const new_time = step_end(delta_t);
+      delta_t = new_time - last_time;
+      if (actual_controls) {
+        current_controls = controls(new_time);
+      }
+
+      extrapolate(accepted_times, accepted_states, new_time, new_state);
+      problem.prepare_timestep(
+          last_time, new_time, last_state, current_controls);
+      Solver::Solutionstruct solstruct;
+      try {
+        solstruct = solver.solve(
+            new_state, problem, false, not use_simplified_newton, last_time,
+            new_time, last_state, current_controls);
+      } catch (Solver::SolverNumericalProblem &) {
+        solstruct.success = false;
+      }
+
+      // Heuristic error estimate, see simulate_adaptively in the header:
+      double error = 0.0;
+      if (solstruct.success and have_previous_state) {
+        Eigen::VectorXd predicted
+            = last_state
+              + (delta_t / (last_time - previous_time))
+                    * (last_state - previous_state);
+        Eigen::VectorXd scale
+            = adaptive_tolerance * (1.0 + new_state.array().abs());
+        error = 0.5
+                * std::sqrt(
+                    ((new_state - predicted).array() / scale.array())
+                        .square()
+                        .mean());
+      }
+
+      if (not solstruct.success or error > 1.0) {
+        double factor = minimal_factor;
+        if (solstruct.success) {
+          factor = std::max(minimal_factor, safety / std::sqrt(error));
+        }
+        double const shorter_delta_t
+            = std::max(minimal_delta_t, factor * delta_t);
+        // The step can't be shortened any more, if it has minimal length or
+        // if it is the last step and can't be split into two steps of at
+        // least minimal length.
+        if (step_end(shorter_delta_t) - last_time >= delta_t) {
+          if (not solstruct.success) {
+            gthrow({"Failed timestep irrevocably!", std::to_string(new_time)});
+          }
+          gthrow(
+              {"The local error estimate of the time step to ",
+               std::to_string(new_time),
+               " exceeds adaptive_tolerance, but the step can't be made "
+               "shorter than minimal_delta_t. Decrease minimal_delta_t or "
+               "increase adaptive_tolerance."});
+        }
+        delta_t = shorter_delta_t;
+        continue;
+      }
+
+      // Interpolate the results to all output time points that were passed:
+      while (next_saved_index < saved_states.size()
+             and saved_states.interpolation_point_at_index(next_saved_index)
+                     <= new_time) {
+        double theta
+            = (saved_states.interpolation_point_at_index(next_saved_index)
+               - last_time)
+              / delta_t;
+        saved_states.mut_timestep(next_saved_index)
+            = (1 - theta) * last_state + theta * new_state;
+        ++next_saved_index;
+      }
+
+      previous_time = last_time;
+      previous_state = last_state;
+      have_previous_state = true;
+      last_time = new_time;
+      last_state = new_state;
+      remember_accepted_state(
+          accepted_times, accepted_states, new_time, new_state);
+
+      double factor = maximal_factor;
+      if (error > 0.0) {
+        factor = std::clamp(
+            safety / std::sqrt(error), minimal_factor, maximal_factor);
+      }
+      delta_t = std::min(maximal_delta_t, factor * delta_t);
+    }
+  }
+
+  void Timeevolver::extrapolate(
+      std::deque<double> const &accepted_times,
+      std::deque<Eigen::VectorXd> const &accepted_states, double time,
+      Eigen::Ref<Eigen::VectorXd> new_state) const {
+    // Lagrange extrapolation through all remembered states:
+    new_state.setZero();
+    for (size_t j = 0; j != accepted_times.size(); ++j) {
+      double weight = 1.0;
+      for (size_t m = 0; m != accepted_times.size(); ++m) {
+        if (m != j) {
+          weight *= (time - accepted_times[m])
+                    / (accepted_times[j] - accepted_times[m]);
+        }
+      }
+      new_state += weight * accepted_states[j];
+    }
+  }
+
+  void Timeevolver::remember_accepted_state(
+      std::deque<double> &accepted_times,
+      std::deque<Eigen::VectorXd> &accepted_states, double time,
+      Eigen::Ref<Eigen::VectorXd const> const &state) const {
+    accepted_times.push_back(time);
+    accepted_states.push_back(state);
+    while (accepted_times.size() > static_cast<size_t>(predictor_order) + 1) {
+      accepted_times.pop_front();
+      accepted_states.pop_front();
+    }
+  }
+
   Solver::Solutionstruct Timeevolver::make_one_step(
       double last_time, double new_time, Eigen::Ref<Eigen::VectorXd> last_state,
       Eigen::Ref<Eigen::VectorXd> new_state,
@@ -140,13 +432,25 @@ namespace Model {
     } else {
       use_full_jacobian = true;
     }
+    bool reuse_factorization = use_simplified_newton
+                               and reuse_jacobian_across_timesteps
+                               and not refresh_jacobian;
     Eigen::VectorXd new_state_backup = new_state;
     while (not solstruct.success) {
       new_state = new_state_backup;
       problem.prepare_timestep(last_time, new_time, last_state, control);
-      solstruct = solver.solve(
-          new_state, problem, false, use_full_jacobian, last_time, new_time,
-          last_state, control);
+      try {
+        solstruct = solver.solve(
+            new_state, problem, false, use_full_jacobian, last_time, new_time,
+            last_state, control, reuse_factorization);
+      } catch (Solver::SolverNumericalProblem &) {
+        if (not reuse_factorization) {
+          throw;
+        }
+        // The kept jacobian was too far off, try again with a fresh one.
+        reuse_factorization = false;
+        continue;
+      }
       if (solstruct.success) {
 
         if (use_simplified_newton and retry > 0) {
@@ -157,6 +461,8 @@ namespace Model {
         // Found a successful solution, so leave the function!
         break;
       }
+      // Retries always start with a fresh jacobian:
+      reuse_factorization = false;
       if (use_simplified_newton and retry == retries) {
         use_full_jacobian = true;
         std::cout << "Switching to updated Jacobian in every step."
@@ -178,7 +484,75 @@ namespace Model {
         std::cout << solstruct.used_iterations << std::endl;
       }
     }
+    refresh_jacobian
+        = solstruct.contraction > jacobian_refresh_contraction
+          or solstruct.used_iterations > jacobian_refresh_iterations;
     return solstruct;
   }
 
+  void Timeevolver::solve_steady_state(
+      double time, double initial_delta_t, Eigen::Ref<Eigen::VectorXd> state,
+      Eigen::Ref<Eigen::VectorXd const> const &control,
+      Controlcomponent &problem) {
+    // Bound for the growth of the pseudo time step per step:
+    double const maximal_growth = 10.0;
+    int const maximal_steps = 1000;
+
+    // Length of the time step, whose residual with equal last and new state
+    // is the stationary residual. Its time-derivative terms vanish for any
+    // length, only stochastic components draw their values for a step of
+    // this length:
+    double const stationary_delta_t = 1.0;
+
+    Eigen::VectorXd residual(state.size());
+    auto stationary_residual_norm = [&]() {
+      problem.prepare_timestep(time - stationary_delta_t, time, state, control);
+      problem.evaluate(
+          residual, time - stationary_delta_t, time, state, state, control);
+      return residual.norm();
+    };
+    double residual_norm = stationary_residual_norm();
+
+    double delta_t = initial_delta_t;
+    solver.evaluate_state_derivative_keep_pattern(
+        problem, time - delta_t, time, state, state, control);
+    Eigen::VectorXd new_state = state;
+    int step = 0;
+    while (residual_norm > steady_state_tolerance) {
+      if (step == maximal_steps) {
+        gthrow(
+            {"Found no stationary state in ", std::to_string(maximal_steps),
+             " pseudo time steps, the residual is still ",
+             std::to_string(residual_norm), "."});
+      }
+      ++step;
+      new_state = state;
+      problem.prepare_timestep(time - delta_t, time, state, control);
+      Solver::Solutionstruct solstruct;
+      try {
+        solstruct = solver.solve(
+            new_state, problem, false, true, time - delta_t, time, state,
+            control);
+      } catch (Solver::SolverNumericalProblem &) {
+        solstruct.success = false;
+      }
+      if (not solstruct.success) {
+        delta_t *= 0.5;
+        if (delta_t < minimal_delta_t) {
+          gthrow(
+              {"Pseudo time step fell below minimal_delta_t while searching "
+               "for a stationary state, the residual is ",
+               std::to_string(residual_norm), "."});
+        }
+        continue;
+      }
+      state = new_state;
+      double const last_residual_norm = residual_norm;
+      residual_norm = stationary_residual_norm();
+      double const growth
+          = std::min(last_residual_norm / residual_norm, maximal_growth);
+      delta_t = std::min(maximal_delta_t, growth * delta_t);
+    }
+  }
+
 } // namespace Model
@@ -17,6 +17,7 @@
 #pragma once
 #include "Newtonsolver.hpp"
 #include "Timedata.hpp"
+#include <deque>
 #include <memory>
 #include <nlohmann/json.hpp>
 
@@ -48,12 +49,107 @@ namespace Model {
         Eigen::Ref<Eigen::VectorXd const> const &control,
         Controlcomponent &problem);
 
+    /** \brief Computes a stationary state of problem at the given time by
+     * pseudo-transient continuation.
+     *
+     * Starting from state, implicit time steps towards time are made, whose
+     * length starts at initial_delta_t and grows with the decrease of the
+     * stationary residual (switched evolution relaxation) up to
+     * #maximal_delta_t. Failed steps are halved down to #minimal_delta_t.
+     * The boundary values are always those at time. The stationary residual
+     * is that of a time step of length 1 to time with equal last and new
+     * state, so its time-derivative terms vanish. Stochastic components draw
+     * their values for this step length, as problem.prepare_timestep() is
+     * called before every evaluation of the stationary residual. It iterates
+     * until the residual is below the Newton tolerance and throws, if it
+     * can't get there. On return state holds the stationary state.
+     */
+    void solve_steady_state(
+        double time, double initial_delta_t, Eigen::Ref<Eigen::VectorXd> state,
+        Eigen::Ref<Eigen::VectorXd const> const &control,
+        Controlcomponent &problem);
+
+    /** \brief Returns true, if #simulate chooses the time steps adaptively.
+     *
+     * Then the states at the output time points are interpolated, so they
+     * don't fulfill the discretized model equations on these time points,
+     * which the optimization relies on.
+     */
+    bool uses_adaptive_timesteps() const;
+
   private:
     Timeevolver(nlohmann::json const &timeevolver_data);
 
+    /** \brief Simulates with time steps chosen by a local error estimate and
+     * interpolates the results linearly to the time points of saved_states.
+     *
+     * The error estimate is a heuristic, neither an embedded method nor step
+     * doubling: the implicit time discretization is of first order, so half
+     * the distance of the new state to the linear extrapolation of the last
+     * two accepted states is taken as local error, scaled by
+     * #adaptive_tolerance * (1 + |state|) in every component. The first step
+     * has no estimate and is always accepted, if the Newton method
+     * converges. Steps with a scaled error above 1 are rejected and repeated
+     * with a shorter time step. The time step changes at most by a factor
+     * between 0.2 and 5 per step and stays within #minimal_delta_t and
+     * #maximal_delta_t. The last step ends exactly at the last time point of
+     * saved_states.
+     *
+     * Throws, if a step fails or its error is too large, but it can't be
+     * made shorter without falling below #minimal_delta_t.
+     *
+     * The first entry of saved_states must already hold the initial state.
+     */
+    void simulate_adaptively(
+        Aux::InterpolatingVector_Base const &controls,
+        Controlcomponent &problem, Aux::InterpolatingVector_Base &saved_states);
+
+    /** \brief Writes the polynomial extrapolation of the accepted states to
+     * time into new_state, as initial guess for the Newton method.
+     */
+    void extrapolate(
+        std::deque<double> const &accepted_times,
+        std::deque<Eigen::VectorXd> const &accepted_states, double time,
+        Eigen::Ref<Eigen::VectorXd> new_state) const;
+
+    /** \brief Appends an accepted state and forgets those, that are not
+     * needed for an extrapolation of order #predictor_order.
+     */
+    void remember_accepted_state(
+        std::deque<double> &accepted_times,
+        std::deque<Eigen::VectorXd> &accepted_states, double time,
+        Eigen::Ref<Eigen::VectorXd const> const &state) const;
+
     Solver::Newtonsolver solver;
     int const retries;
     bool const use_simplified_newton;
+
+    /// If true (and #use_simplified_newton is true), the factorized jacobian
+    /// is kept over many time steps, until the Newton iteration converges
+    /// too slowly.
+    bool const reuse_jacobian_across_timesteps;
+    /// The jacobian is refreshed after a time step with a worse contraction
+    /// rate than this.
+    double const jacobian_refresh_contraction;
+    /// The jacobian is refreshed after a time step with more Newton
+    /// iterations than this.
+    int const jacobian_refresh_iterations;
+    /// Is true, if the next time step must start with a fresh jacobian.
+    bool refresh_jacobian{true};
+
+    /// If true, #simulate uses #simulate_adaptively.
+    bool const use_adaptive_timesteps;
+    /// Relative and absolute tolerance of the local error estimate.
+    double const adaptive_tolerance;
+    /// Bounds for the adaptive time steps.
+    double const minimal_delta_t;
+    double const maximal_delta_t;
+
+    /// Polynomial order of the predictor for the Newton initial guess.
+    int const predictor_order;
+
+    /// A stationary state is accepted with a residual below this.
+    double const steady_state_tolerance;
   };
 
 } // namespace Model
@@ -41,6 +41,45 @@ namespace Model::Scheme {
                - 0.5 * Delta_t * (bl.source(new_right) + bl.source(new_left));
     }
 
+    /// Evaluates flux and source only once at each of the new states.
+    void evaluate_point_with_derivatives(
+        Eigen::Ref<Eigen::Vector<double, Dimension>> result,
+        Eigen::Ref<Eigen::Matrix<double, Dimension, Dimension>> d_new_left,
+        Eigen::Ref<Eigen::Matrix<double, Dimension, Dimension>> d_new_right,
+        double last_time, double new_time, double Delta_x,
+        Eigen::Ref<Eigen::Vector<double, Dimension> const> last_left,
+        Eigen::Ref<Eigen::Vector<double, Dimension> const> last_right,
+        Eigen::Ref<Eigen::Vector<double, Dimension> const> new_left,
+        Eigen::Ref<Eigen::Vector<double, Dimension> const> new_right,
+        Model::Balancelaw::Balancelaw<Dimension> const &bl) const final {
+
+      Eigen::Vector<double, Dimension> flux_left;
+      Eigen::Matrix<double, Dimension, Dimension> dflux_left;
+      Eigen::Vector<double, Dimension> source_left;
+      Eigen::Matrix<double, Dimension, Dimension> dsource_left;
+      bl.flux_and_source_with_derivatives(
+          new_left, flux_left, dflux_left, source_left, dsource_left);
+
+      Eigen::Vector<double, Dimension> flux_right;
+      Eigen::Matrix<double, Dimension, Dimension> dflux_right;
+      Eigen::Vector<double, Dimension> source_right;
+      Eigen::Matrix<double, Dimension, Dimension> dsource_right;
+      bl.flux_and_source_with_derivatives(
+          new_right, flux_right, dflux_right, source_right, dsource_right);
+
+      double Delta_t = new_time - last_time;
+      result = 0.5 * (new_left + new_right) - 0.5 * (last_left + last_right)
+               - Delta_t / Delta_x * (flux_left - flux_right)
+               - 0.5 * Delta_t * (source_right + source_left);
+
+      Eigen::Matrix<double, Dimension, Dimension> id;
+      id.setIdentity();
+      d_new_left = 0.5 * id - Delta_t / Delta_x * dflux_left
+                   - 0.5 * Delta_t * dsource_left;
+      d_new_right = 0.5 * id + Delta_t / Delta_x * dflux_right
+                    - 0.5 * Delta_t * dsource_right;
+    }
+
     Eigen::Matrix<double, Dimension, Dimension> devaluate_point_d_new_left(
         double last_time, double new_time, double Delta_x,
         Eigen::Ref<Eigen::Vector<double, Dimension> const> /*last_left*/,
@@ -103,5 +142,7 @@ namespace Model::Scheme {
       jac = -0.5 * id;
       return jac;
     }
+
+    bool has_constant_last_state_derivatives() const final { return true; }
   };
 } // namespace Model::Scheme
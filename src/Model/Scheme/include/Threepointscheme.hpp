@@ -36,6 +36,33 @@ namespace Model::Scheme {
         Model::Balancelaw::Balancelaw<Dimension> const &bl) const
         = 0;
 
+    /// \brief Computes the scheme at one point together with its derivatives
+    /// with respect to \code{.cpp}new_left\endcode and
+    /// \code{.cpp}new_right\endcode.
+    ///
+    /// The default calls #evaluate_point and the two derivatives, schemes can
+    /// override it to evaluate the balance law only once per state.
+    virtual void evaluate_point_with_derivatives(
+        Eigen::Ref<Eigen::Vector<double, Dimension>> result,
+        Eigen::Ref<Eigen::Matrix<double, Dimension, Dimension>> d_new_left,
+        Eigen::Ref<Eigen::Matrix<double, Dimension, Dimension>> d_new_right,
+        double last_time, double new_time, double Delta_x,
+        Eigen::Ref<Eigen::Vector<double, Dimension> const> last_left,
+        Eigen::Ref<Eigen::Vector<double, Dimension> const> last_right,
+        Eigen::Ref<Eigen::Vector<double, Dimension> const> new_left,
+        Eigen::Ref<Eigen::Vector<double, Dimension> const> new_right,
+        Model::Balancelaw::Balancelaw<Dimension> const &bl) const {
+      evaluate_point(
+          result, last_time, new_time, Delta_x, last_left, last_right,
+          new_left, new_right, bl);
+      d_new_left = devaluate_point_d_new_left(
+          last_time, new_time, Delta_x, last_left, last_right, new_left,
+          new_right, bl);
+      d_new_right = devaluate_point_d_new_right(
+          last_time, new_time, Delta_x, last_left, last_right, new_left,
+          new_right, bl);
+    }
+
     /// The derivative with respect to \code{.cpp}new_left\endcode
     virtual Eigen::Matrix<double, Dimension, Dimension>
     devaluate_point_d_new_left(
@@ -79,5 +106,11 @@ namespace Model::Scheme {
         Eigen::Ref<Eigen::Vector<double, Dimension> const> new_right,
         Model::Balancelaw::Balancelaw<Dimension> const &bl) const
         = 0;
+
+    /// \brief Returns true, if #devaluate_point_d_last_left and
+    /// #devaluate_point_d_last_right depend neither on their arguments nor
+    /// on the time, so that their coefficients can be kept between fills of
+    /// a jacobian, see Aux::Matrixhandler::add_constant_to_coefficient().
+    virtual bool has_constant_last_state_derivatives() const { return false; }
   };
 } // namespace Model::Scheme
@@ -0,0 +1,1165 @@
+/*
+ * Grazer - network simulation and optimization tool
+ *
+ * Copyright 2020-2022 Uni Mannheim <e.fokken+grazer@posteo.de>,
+ *
+ * SPDX-License-Identifier:	MIT
+ *
+ * Licensed under the MIT License, found in the file LICENSE and at
+ * https://opensource.org/licenses/MIT
+ * This file may not be copied, modified, or distributed except according to
+ * those terms.
+ *
+ * Distributed on an "AS IS" BASIS, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied.  See your chosen license for details.
+ *
+ */
+#include "Linearsolver.hpp"
+#include "Exception.hpp"
+#include "Threadpool.hpp"
+
+#include <Eigen/IterativeLinearSolvers>
+#include <Eigen/SparseLU>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <unsupported/Eigen/IterativeSolvers>
+#ifdef GRAZER_HAVE_KLU
+#include <klu.h>
+#endif
+#ifdef GRAZER_HAVE_UMFPACK
+#include <Eigen/UmfPackSupport>
+#endif
+
+namespace Solver {
+
+  Linearsolver::~Linearsolver() {}
+
+  void Linearsolver::refactorize(Eigen::SparseMatrix<double> const &matrix) {
+    factorize(matrix);
+  }
+
+  bool Linearsolver::can_reuse_pivots() const { return false; }
+
+  bool Linearsolver::reused_pivots() const { return false; }
+
+  void Linearsolver::set_condensable_ranges(
+      std::vector<std::pair<Eigen::Index, Eigen::Index>> const &) {}
+
+  int Linearsolver::get_number_of_subdomains() const { return 0; }
+
+  void Linearsolver::set_subdomains(
+      std::vector<std::vector<std::pair<Eigen::Index, Eigen::Index>>> const
+          &) {}
+
+  void Linearsolver::set_number_of_threads(int) {}
+
+  namespace {
+    /// \brief Wraps any solver with the interface of the Eigen sparse solvers.
+    template <typename Eigensolver>
+    class Eigenlinearsolver final : public Linearsolver {
+    public:
+      void analyze_pattern(Eigen::SparseMatrix<double> const &matrix) final {
+        solver.analyzePattern(matrix);
+      }
+
+      void factorize(Eigen::SparseMatrix<double> const &matrix) final {
+        solver.factorize(matrix);
+      }
+
+      Eigen::ComputationInfo info() const final { return solver.info(); }
+
+      Eigen::MatrixXd
+      solve(Eigen::Ref<Eigen::MatrixXd const> const &rhs) final {
+        return solver.solve(rhs);
+      }
+
+    private:
+      Eigensolver solver;
+    };
+
+    using SparseMatrix = Eigen::SparseMatrix<double>;
+
+    /// \brief Solves exactly with the diagonal blocks of the condensable
+    /// ranges and with the diagonal everywhere else.
+    ///
+    /// The condensable ranges are the interiors of the pipes, whose blocks
+    /// carry the stiff local part of the jacobian. Every block is factorized
+    /// with SparseLU on its own, the coupling between blocks is ignored. As
+    /// a solver on its own this is only a crude approximation, it is meant
+    /// as a cheap preconditioner for the jacobian-free Newton method.
+    /// Singular blocks fall back to their diagonal, as do zero diagonal
+    /// entries to 1.
+    class Blockjacobilinearsolver final : public Linearsolver {
+    public:
+      void set_condensable_ranges(
+          std::vector<std::pair<Eigen::Index, Eigen::Index>> const &ranges)
+          final {
+        condensable_ranges = ranges;
+      }
+
+      void analyze_pattern(SparseMatrix const &matrix) final {
+        auto const size = matrix.rows();
+        std::vector<bool> in_block(static_cast<size_t>(size), false);
+        blocks.clear();
+        for (auto const &[first, after] : condensable_ranges) {
+          if (first < 0 or after > size or first >= after
+              or std::any_of(
+                  in_block.begin() + first, in_block.begin() + after,
+                  [](bool taken) { return taken; })) {
+            continue;
+          }
+          std::fill(in_block.begin() + first, in_block.begin() + after, true);
+          Block block;
+          block.first = first;
+          block.size = after - first;
+          block.matrix = matrix.block(first, first, block.size, block.size);
+          block.matrix.makeCompressed();
+          block.solver = std::make_unique<Eigen::SparseLU<SparseMatrix>>();
+          block.solver->analyzePattern(block.matrix);
+          blocks.push_back(std::move(block));
+        }
+      }
+
+      void factorize(SparseMatrix const &matrix) final {
+        inverse_diagonal = matrix.diagonal().unaryExpr(
+            [](double entry) { return entry != 0.0 ? 1.0 / entry : 1.0; });
+        for (auto &block : blocks) {
+          block.matrix
+              = matrix.block(block.first, block.first, block.size, block.size);
+          block.matrix.makeCompressed();
+          block.solver->factorize(block.matrix);
+        }
+      }
+
+      Eigen::ComputationInfo info() const final { return Eigen::Success; }
+
+      Eigen::MatrixXd
+      solve(Eigen::Ref<Eigen::MatrixXd const> const &rhs) final {
+        Eigen::MatrixXd solution = inverse_diagonal.asDiagonal() * rhs;
+        for (auto &block : blocks) {
+          if (block.solver->info() == Eigen::Success) {
+            solution.middleRows(block.first, block.size)
+                = block.solver->solve(rhs.middleRows(block.first, block.size));
+          }
+        }
+        return solution;
+      }
+
+    private:
+      struct Block {
+        Eigen::Index first{0};
+        Eigen::Index size{0};
+        SparseMatrix matrix;
+        std::unique_ptr<Eigen::SparseLU<SparseMatrix>> solver;
+      };
+
+      std::vector<std::pair<Eigen::Index, Eigen::Index>> condensable_ranges;
+      std::vector<Block> blocks;
+      Eigen::VectorXd inverse_diagonal;
+    };
+
+    /// \brief Eliminates the unknowns of the condensable ranges by static
+    /// condensation and factorizes only the remaining system with SparseLU.
+    ///
+    /// The matrix is block tridiagonal with 2x2 blocks on each condensable
+    /// range, a chain, as on the interior of a pipe. Chains are factorized by
+    /// the block Thomas algorithm, independently of each other and in
+    /// parallel. Their Schur complement is added to the system of the
+    /// remaining unknowns, whose solution is then back-substituted into the
+    /// chains. Ranges, whose entries don't have this structure, are not
+    /// eliminated and a warning tells how many. Without ranges this is just
+    /// SparseLU.
+    class Condensationlinearsolver final : public Linearsolver {
+    public:
+      void set_condensable_ranges(
+          std::vector<std::pair<Eigen::Index, Eigen::Index>> const &ranges)
+          final {
+        condensable_ranges = ranges;
+      }
+
+      void set_number_of_threads(int number_of_threads) final {
+        if (number_of_threads == 1) {
+          threadpool.reset();
+        } else {
+          threadpool = std::make_unique<Aux::Threadpool>(number_of_threads);
+        }
+        split_chains();
+      }
+
+      void analyze_pattern(SparseMatrix const &matrix) final {
+        auto const size = matrix.rows();
+        chain_of_index.assign(static_cast<size_t>(size), no_chain);
+        chains.clear();
+        size_t number_of_rejected_ranges = 0;
+        for (auto const &[first, after] : condensable_ranges) {
+          if (first < 0 or after > size or first >= after
+              or (after - first) % 2 != 0) {
+            ++number_of_rejected_ranges;
+            continue;
+          }
+          if (std::any_of(
+                  chain_of_index.begin() + first,
+                  chain_of_index.begin() + after,
+                  [](Eigen::Index chain) { return chain != no_chain; })) {
+            ++number_of_rejected_ranges;
+            continue;
+          }
+          Chain chain;
+          chain.first = first;
+          chain.number_of_pairs = (after - first) / 2;
+          mark_chain(chain, static_cast<Eigen::Index>(chains.size()));
+          chains.push_back(std::move(chain));
+        }
+        number_of_rejected_ranges += drop_unstructured_chains(matrix);
+        if (number_of_rejected_ranges != 0) {
+          std::cout << "[Warning] Condensation: " << number_of_rejected_ranges
+                    << " of " << condensable_ranges.size()
+                    << " condensable ranges are not block tridiagonal or "
+                       "overlap others and are left to SparseLU."
+                    << std::endl;
+        }
+
+        reduced_to_full.clear();
+        reduced_index.assign(static_cast<size_t>(size), -1);
+        for (Eigen::Index index = 0; index != size; ++index) {
+          if (chain_of(index) == no_chain) {
+            reduced_index[static_cast<size_t>(index)]
+                = static_cast<Eigen::Index>(reduced_to_full.size());
+            reduced_to_full.push_back(index);
+          }
+        }
+
+        for (Eigen::Index col = 0; col != matrix.outerSize(); ++col) {
+          for (SparseMatrix::InnerIterator it(matrix, col); it; ++it) {
+            auto const row_chain = chain_of(it.row());
+            auto const col_chain = chain_of(col);
+            if (col_chain != no_chain and row_chain == no_chain) {
+              chains[static_cast<size_t>(col_chain)].coupling_rows.push_back(
+                  it.row());
+            }
+            if (row_chain != no_chain and col_chain == no_chain) {
+              chains[static_cast<size_t>(row_chain)]
+                  .coupling_columns.push_back(col);
+            }
+          }
+        }
+        for (auto &chain : chains) {
+          make_unique_sorted(chain.coupling_rows);
+          make_unique_sorted(chain.coupling_columns);
+          auto const interior_size = 2 * chain.number_of_pairs;
+          auto const number_of_pairs
+              = static_cast<size_t>(chain.number_of_pairs);
+          chain.lower.resize(number_of_pairs);
+          chain.diagonal_inverse.resize(number_of_pairs);
+          chain.upper.resize(number_of_pairs);
+          chain.to_interior.resize(
+              static_cast<Eigen::Index>(chain.coupling_rows.size()),
+              interior_size);
+          chain.from_coupling.resize(
+              interior_size,
+              static_cast<Eigen::Index>(chain.coupling_columns.size()));
+          chain.schur_complement.setZero(
+              static_cast<Eigen::Index>(chain.coupling_rows.size()),
+              static_cast<Eigen::Index>(chain.coupling_columns.size()));
+        }
+        split_chains();
+
+        assemble_reduced_matrix(matrix);
+        reduced_solver.analyzePattern(reduced_matrix);
+      }
+
+      void factorize(SparseMatrix const &matrix) final {
+        for_all_chains(
+            [&matrix](Chain &chain) { factorize_chain(matrix, chain); });
+        status = Eigen::Success;
+        for (auto const &chain : chains) {
+          if (chain.singular) {
+            status = Eigen::NumericalIssue;
+            return;
+          }
+        }
+        assemble_reduced_matrix(matrix);
+        reduced_solver.factorize(reduced_matrix);
+        status = reduced_solver.info();
+      }
+
+      Eigen::ComputationInfo info() const final { return status; }
+
+      Eigen::MatrixXd
+      solve(Eigen::Ref<Eigen::MatrixXd const> const &rhs) final {
+        Eigen::MatrixXd solution = rhs;
+        for_all_chains([&solution](Chain &chain) {
+          solve_chain(
+              chain,
+              solution.middleRows(chain.first, 2 * chain.number_of_pairs));
+        });
+
+        Eigen::MatrixXd reduced_rhs(
+            static_cast<Eigen::Index>(reduced_to_full.size()), rhs.cols());
+        for (size_t index = 0; index != reduced_to_full.size(); ++index) {
+          reduced_rhs.row(static_cast<Eigen::Index>(index))
+              = rhs.row(reduced_to_full[index]);
+        }
+        for (auto const &chain : chains) {
+          auto interior_solution
+              = solution.middleRows(chain.first, 2 * chain.number_of_pairs);
+          for (size_t row = 0; row != chain.coupling_rows.size(); ++row) {
+            reduced_rhs.row(reduced_of(chain.coupling_rows[row]))
+                -= chain.to_interior.row(static_cast<Eigen::Index>(row))
+                   * interior_solution;
+          }
+        }
+
+        Eigen::MatrixXd reduced_solution = reduced_solver.solve(reduced_rhs);
+        status = reduced_solver.info();
+        for (size_t index = 0; index != reduced_to_full.size(); ++index) {
+          solution.row(reduced_to_full[index])
+              = reduced_solution.row(static_cast<Eigen::Index>(index));
+        }
+
+        for_all_chains([this, &solution, &reduced_solution](Chain &chain) {
+          Eigen::MatrixXd coupling_solution(
+              static_cast<Eigen::Index>(chain.coupling_columns.size()),
+              solution.cols());
+          for (size_t col = 0; col != chain.coupling_columns.size(); ++col) {
+            coupling_solution.row(static_cast<Eigen::Index>(col))
+                = reduced_solution.row(reduced_of(chain.coupling_columns[col]));
+          }
+          solution.middleRows(chain.first, 2 * chain.number_of_pairs)
+              -= chain.from_coupling * coupling_solution;
+        });
+        return solution;
+      }
+
+    private:
+      /// \brief The data of one condensable range.
+      struct Chain {
+        Eigen::Index first{0};
+        Eigen::Index number_of_pairs{0};
+        /// Rows outside of all chains with entries in the columns of this
+        /// chain.
+        std::vector<Eigen::Index> coupling_rows;
+        /// Columns outside of all chains with entries in the rows of this
+        /// chain.
+        std::vector<Eigen::Index> coupling_columns;
+        /// Block k holds the coupling of pair k to pair k - 1, after the
+        /// factorization the multiplier of the Thomas algorithm.
+        std::vector<Eigen::Matrix2d> lower;
+        /// Inverses of the pivot blocks of the Thomas algorithm.
+        std::vector<Eigen::Matrix2d> diagonal_inverse;
+        /// Block k holds the coupling of pair k to pair k + 1.
+        std::vector<Eigen::Matrix2d> upper;
+        /// Entries of the coupling rows in the columns of the chain.
+        Eigen::MatrixXd to_interior;
+        /// The inverse of the chain times its entries in the coupling
+        /// columns.
+        Eigen::MatrixXd from_coupling;
+        /// What the chain subtracts from the reduced matrix in the coupling
+        /// rows and columns.
+        Eigen::MatrixXd schur_complement;
+        bool singular{false};
+      };
+
+      static constexpr Eigen::Index no_chain{-1};
+
+      /// Relative size of the determinant, below which a pivot block is
+      /// treated as singular.
+      static constexpr double singular_block{1e-14};
+
+      Eigen::Index chain_of(Eigen::Index index) const {
+        return chain_of_index[static_cast<size_t>(index)];
+      }
+
+      Eigen::Index reduced_of(Eigen::Index index) const {
+        return reduced_index[static_cast<size_t>(index)];
+      }
+
+      void mark_chain(Chain const &chain, Eigen::Index chain_number) {
+        std::fill(
+            chain_of_index.begin() + chain.first,
+            chain_of_index.begin() + chain.first + 2 * chain.number_of_pairs,
+            chain_number);
+      }
+
+      static void make_unique_sorted(std::vector<Eigen::Index> &indices) {
+        std::sort(indices.begin(), indices.end());
+        indices.erase(
+            std::unique(indices.begin(), indices.end()), indices.end());
+      }
+
+      /// \brief Removes the chains, that are coupled to other chains or
+      /// whose own block is not block tridiagonal, and returns their number.
+      size_t drop_unstructured_chains(SparseMatrix const &matrix) {
+        std::vector<bool> structured(chains.size(), true);
+        for (Eigen::Index col = 0; col != matrix.outerSize(); ++col) {
+          auto const col_chain = chain_of(col);
+          if (col_chain == no_chain) {
+            continue;
+          }
+          for (SparseMatrix::InnerIterator it(matrix, col); it; ++it) {
+            auto const row_chain = chain_of(it.row());
+            if (row_chain == no_chain) {
+              continue;
+            }
+            if (row_chain != col_chain) {
+              structured[static_cast<size_t>(row_chain)] = false;
+              structured[static_cast<size_t>(col_chain)] = false;
+              continue;
+            }
+            auto const first = chains[static_cast<size_t>(col_chain)].first;
+            if (std::abs((it.row() - first) / 2 - (col - first) / 2) > 1) {
+              structured[static_cast<size_t>(col_chain)] = false;
+            }
+          }
+        }
+        std::vector<Chain> kept_chains;
+        std::fill(chain_of_index.begin(), chain_of_index.end(), no_chain);
+        for (size_t chain = 0; chain != chains.size(); ++chain) {
+          if (structured[chain]) {
+            mark_chain(
+                chains[chain], static_cast<Eigen::Index>(kept_chains.size()));
+            kept_chains.push_back(std::move(chains[chain]));
+          }
+        }
+        auto const number_of_dropped_chains
+            = chains.size() - kept_chains.size();
+        chains = std::move(kept_chains);
+        return number_of_dropped_chains;
+      }
+
+      /// \brief Splits the chains into contiguous parts of roughly equal
+      /// size, one per thread.
+      void split_chains() {
+        size_t const number_of_threads
+            = threadpool
+                  ? static_cast<size_t>(threadpool->get_number_of_threads())
+                  : 1;
+        Eigen::Index total_pairs = 0;
+        for (auto const &chain : chains) {
+          total_pairs += chain.number_of_pairs;
+        }
+        chain_parts.assign(number_of_threads + 1, chains.size());
+        chain_parts[0] = 0;
+        Eigen::Index finished_pairs = 0;
+        size_t part = 1;
+        for (size_t chain = 0; chain != chains.size(); ++chain) {
+          while (part < number_of_threads
+                 and finished_pairs * static_cast<Eigen::Index>(
+                         number_of_threads)
+                         >= static_cast<Eigen::Index>(part) * total_pairs) {
+            chain_parts[part] = chain;
+            ++part;
+          }
+          finished_pairs += chains[chain].number_of_pairs;
+        }
+      }
+
+      void for_all_chains(std::function<void(Chain &)> const &task) {
+        if (not threadpool) {
+          for (auto &chain : chains) {
+            task(chain);
+          }
+          return;
+        }
+        threadpool->run([&](int thread_index) {
+          auto const index = static_cast<size_t>(thread_index);
+          for (auto chain = chain_parts[index]; chain != chain_parts[index + 1];
+               ++chain) {
+            task(chains[chain]);
+          }
+        });
+      }
+
+      /// \brief Collects the entries of the chain and factorizes it.
+      static void factorize_chain(SparseMatrix const &matrix, Chain &chain) {
+        auto const first = chain.first;
+        auto const interior_size = 2 * chain.number_of_pairs;
+        for (size_t pair = 0; pair != chain.lower.size(); ++pair) {
+          chain.lower[pair].setZero();
+          chain.diagonal_inverse[pair].setZero();
+          chain.upper[pair].setZero();
+        }
+        chain.to_interior.setZero();
+        Eigen::MatrixXd coupling_entries = Eigen::MatrixXd::Zero(
+            interior_size,
+            static_cast<Eigen::Index>(chain.coupling_columns.size()));
+
+        for (auto col = first; col != first + interior_size; ++col) {
+          auto const col_pair = (col - first) / 2;
+          for (SparseMatrix::InnerIterator it(matrix, col); it; ++it) {
+            auto const row = it.row();
+            if (row < first or row >= first + interior_size) {
+              auto const found = std::lower_bound(
+                  chain.coupling_rows.begin(), chain.coupling_rows.end(), row);
+              chain.to_interior(
+                  found - chain.coupling_rows.begin(), col - first)
+                  = it.value();
+              continue;
+            }
+            auto const row_pair = (row - first) / 2;
+            auto const pair = static_cast<size_t>(row_pair);
+            auto const local_row = (row - first) % 2;
+            auto const local_col = (col - first) % 2;
+            if (col_pair == row_pair) {
+              chain.diagonal_inverse[pair](local_row, local_col) = it.value();
+            } else if (col_pair < row_pair) {
+              chain.lower[pair](local_row, local_col) = it.value();
+            } else {
+              chain.upper[pair](local_row, local_col) = it.value();
+            }
+          }
+        }
+        for (size_t coupling = 0; coupling != chain.coupling_columns.size();
+             ++coupling) {
+          for (SparseMatrix::InnerIterator it(
+                   matrix, chain.coupling_columns[coupling]);
+               it; ++it) {
+            auto const row = it.row();
+            if (row >= first and row < first + interior_size) {
+              coupling_entries(
+                  row - first, static_cast<Eigen::Index>(coupling))
+                  = it.value();
+            }
+          }
+        }
+
+        // Block Thomas algorithm:
+        chain.singular = false;
+        for (size_t pair = 0; pair != chain.lower.size(); ++pair) {
+          Eigen::Matrix2d pivot = chain.diagonal_inverse[pair];
+          if (pair > 0) {
+            chain.lower[pair] *= chain.diagonal_inverse[pair - 1];
+            pivot -= chain.lower[pair] * chain.upper[pair - 1];
+          }
+          double const scale = pivot.cwiseAbs().maxCoeff();
+          if (not(std::abs(pivot.determinant())
+                  > singular_block * scale * scale)) {
+            chain.singular = true;
+            return;
+          }
+          chain.diagonal_inverse[pair] = pivot.inverse();
+        }
+
+        chain.from_coupling = coupling_entries;
+        solve_chain(chain, chain.from_coupling);
+        chain.schur_complement = chain.to_interior * chain.from_coupling;
+      }
+
+      /// \brief Overwrites values with the solution of the chain block
+      /// times the solution equals values.
+      static void
+      solve_chain(Chain const &chain, Eigen::Ref<Eigen::MatrixXd> values) {
+        auto const number_of_pairs = chain.lower.size();
+        for (size_t pair = 1; pair != number_of_pairs; ++pair) {
+          auto const row = 2 * static_cast<Eigen::Index>(pair);
+          values.middleRows<2>(row)
+              -= chain.lower[pair] * values.middleRows<2>(row - 2);
+        }
+        for (size_t pair = number_of_pairs; pair-- != 0;) {
+          auto const row = 2 * static_cast<Eigen::Index>(pair);
+          if (pair + 1 != number_of_pairs) {
+            values.middleRows<2>(row)
+                -= chain.upper[pair] * values.middleRows<2>(row + 2);
+          }
+          values.middleRows<2>(row)
+              = chain.diagonal_inverse[pair] * values.middleRows<2>(row);
+        }
+      }
+
+      /// \brief Assembles the entries of the unknowns outside of the chains
+      /// and subtracts the Schur complements of the chains.
+      void assemble_reduced_matrix(SparseMatrix const &matrix) {
+        std::vector<Eigen::Triplet<double>> triplets;
+        triplets.reserve(static_cast<size_t>(matrix.nonZeros()));
+        for (auto col : reduced_to_full) {
+          for (SparseMatrix::InnerIterator it(matrix, col); it; ++it) {
+            if (chain_of(it.row()) == no_chain) {
+              triplets.emplace_back(
+                  reduced_of(it.row()), reduced_of(col), it.value());
+            }
+          }
+        }
+        for (auto const &chain : chains) {
+          for (size_t row = 0; row != chain.coupling_rows.size(); ++row) {
+            for (size_t col = 0; col != chain.coupling_columns.size(); ++col) {
+              triplets.emplace_back(
+                  reduced_of(chain.coupling_rows[row]),
+                  reduced_of(chain.coupling_columns[col]),
+                  -chain.schur_complement(
+                      static_cast<Eigen::Index>(row),
+                      static_cast<Eigen::Index>(col)));
+            }
+          }
+        }
+        auto const reduced_size
+            = static_cast<Eigen::Index>(reduced_to_full.size());
+        reduced_matrix.resize(reduced_size, reduced_size);
+        reduced_matrix.setFromTriplets(triplets.begin(), triplets.end());
+      }
+
+      std::vector<std::pair<Eigen::Index, Eigen::Index>> condensable_ranges;
+      std::vector<Chain> chains;
+      /// The number of the chain of every index or #no_chain.
+      std::vector<Eigen::Index> chain_of_index;
+      /// The position of every index outside of the chains in the reduced
+      /// system, -1 for the others.
+      std::vector<Eigen::Index> reduced_index;
+      std::vector<Eigen::Index> reduced_to_full;
+      /// The chains of thread i are [chain_parts[i], chain_parts[i + 1]).
+      std::vector<size_t> chain_parts;
+      SparseMatrix reduced_matrix;
+      Eigen::SparseLU<SparseMatrix> reduced_solver;
+      std::unique_ptr<Aux::Threadpool> threadpool;
+      Eigen::ComputationInfo status{Eigen::InvalidInput};
+    };
+
+    /// \brief Solves by a Schur complement domain decomposition.
+    ///
+    /// The unknowns are split into one subdomain per thread. An unknown is
+    /// interior to its subdomain, if its row and column have entries only in
+    /// its own subdomain, all others form the interface. Every subdomain
+    /// factorizes its interior block with SparseLU in its own thread and
+    /// adds its Schur complement to the interface system, which is then
+    /// factorized with SparseLU. Unknowns outside of all subdomains belong to
+    /// the interface.
+    class Domaindecompositionlinearsolver final : public Linearsolver {
+    public:
+      int get_number_of_subdomains() const final {
+        return threadpool ? threadpool->get_number_of_threads() : 1;
+      }
+
+      void set_subdomains(
+          std::vector<std::vector<std::pair<Eigen::Index, Eigen::Index>>> const
+              &_subdomains) final {
+        subdomain_ranges = _subdomains;
+      }
+
+      void set_number_of_threads(int number_of_threads) final {
+        if (number_of_threads == 1) {
+          threadpool.reset();
+        } else {
+          threadpool = std::make_unique<Aux::Threadpool>(number_of_threads);
+        }
+      }
+
+      void analyze_pattern(SparseMatrix const &matrix) final {
+        auto const size = matrix.rows();
+        subdomain_of_index.assign(static_cast<size_t>(size), interface);
+        local_index.assign(static_cast<size_t>(size), -1);
+        for (size_t subdomain = 0; subdomain != subdomain_ranges.size();
+             ++subdomain) {
+          for (auto const &[first, after] : subdomain_ranges[subdomain]) {
+            for (auto index = std::max(first, Eigen::Index{0});
+                 index < std::min(after, size); ++index) {
+              subdomain_of_index[static_cast<size_t>(index)]
+                  = static_cast<Eigen::Index>(subdomain);
+            }
+          }
+        }
+        // Unknowns coupled to another subdomain move to the interface:
+        std::vector<bool> coupled(static_cast<size_t>(size), false);
+        for (Eigen::Index col = 0; col != matrix.outerSize(); ++col) {
+          for (SparseMatrix::InnerIterator it(matrix, col); it; ++it) {
+            if (subdomain_of(it.row()) != subdomain_of(col)) {
+              coupled[static_cast<size_t>(it.row())] = true;
+              coupled[static_cast<size_t>(col)] = true;
+            }
+          }
+        }
+        for (size_t index = 0; index != coupled.size(); ++index) {
+          if (coupled[index]) {
+            subdomain_of_index[index] = interface;
+          }
+        }
+
+        subdomains.clear();
+        subdomains.resize(subdomain_ranges.size());
+        for (size_t subdomain = 0; subdomain != subdomains.size();
+             ++subdomain) {
+          subdomains[subdomain].number = static_cast<Eigen::Index>(subdomain);
+          subdomains[subdomain].solver
+              = std::make_unique<Eigen::SparseLU<SparseMatrix>>();
+        }
+        interface_to_full.clear();
+        for (Eigen::Index index = 0; index != size; ++index) {
+          auto const subdomain = subdomain_of(index);
+          if (subdomain == interface) {
+            local_index[static_cast<size_t>(index)]
+                = static_cast<Eigen::Index>(interface_to_full.size());
+            interface_to_full.push_back(index);
+          } else {
+            auto &indices = subdomains[static_cast<size_t>(subdomain)].indices;
+            local_index[static_cast<size_t>(index)]
+                = static_cast<Eigen::Index>(indices.size());
+            indices.push_back(index);
+          }
+        }
+
+        for (Eigen::Index col = 0; col != matrix.outerSize(); ++col) {
+          for (SparseMatrix::InnerIterator it(matrix, col); it; ++it) {
+            auto const row_subdomain = subdomain_of(it.row());
+            auto const col_subdomain = subdomain_of(col);
+            if (col_subdomain != interface and row_subdomain == interface) {
+              subdomains[static_cast<size_t>(col_subdomain)]
+                  .coupling_rows.push_back(it.row());
+            }
+            if (row_subdomain != interface and col_subdomain == interface) {
+              subdomains[static_cast<size_t>(row_subdomain)]
+                  .coupling_columns.push_back(col);
+            }
+          }
+        }
+        for (auto &subdomain : subdomains) {
+          make_unique_sorted(subdomain.coupling_rows);
+          make_unique_sorted(subdomain.coupling_columns);
+          subdomain.schur_complement.setZero(
+              static_cast<Eigen::Index>(subdomain.coupling_rows.size()),
+              static_cast<Eigen::Index>(subdomain.coupling_columns.size()));
+        }
+
+        for_all_subdomains([this, &matrix](Subdomain &subdomain) {
+          gather_interior(matrix, subdomain);
+          if (not subdomain.indices.empty()) {
+            subdomain.solver->analyzePattern(subdomain.interior);
+          }
+        });
+        assemble_interface_matrix(matrix);
+        // SparseLU can't handle empty matrices:
+        if (interface_matrix.rows() != 0) {
+          interface_solver.analyzePattern(interface_matrix);
+        }
+      }
+
+      void factorize(SparseMatrix const &matrix) final {
+        for_all_subdomains([this, &matrix](Subdomain &subdomain) {
+          factorize_subdomain(matrix, subdomain);
+        });
+        status = Eigen::Success;
+        for (auto const &subdomain : subdomains) {
+          if (not subdomain.indices.empty()
+              and subdomain.solver->info() != Eigen::Success) {
+            status = subdomain.solver->info();
+            return;
+          }
+        }
+        assemble_interface_matrix(matrix);
+        if (interface_matrix.rows() != 0) {
+          interface_solver.factorize(interface_matrix);
+          status = interface_solver.info();
+        }
+      }
+
+      Eigen::ComputationInfo info() const final { return status; }
+
+      Eigen::MatrixXd
+      solve(Eigen::Ref<Eigen::MatrixXd const> const &rhs) final {
+        Eigen::MatrixXd solution(rhs.rows(), rhs.cols());
+        std::vector<Eigen::MatrixXd> interior_solutions(subdomains.size());
+        for_all_subdomains([&](Subdomain &subdomain) {
+          Eigen::MatrixXd interior_rhs(
+              static_cast<Eigen::Index>(subdomain.indices.size()), rhs.cols());
+          for (size_t index = 0; index != subdomain.indices.size(); ++index) {
+            interior_rhs.row(static_cast<Eigen::Index>(index))
+                = rhs.row(subdomain.indices[index]);
+          }
+          interior_solutions[static_cast<size_t>(subdomain.number)]
+              = solve_interior(subdomain, interior_rhs);
+        });
+
+        Eigen::MatrixXd interface_rhs(
+            static_cast<Eigen::Index>(interface_to_full.size()), rhs.cols());
+        for (size_t index = 0; index != interface_to_full.size(); ++index) {
+          interface_rhs.row(static_cast<Eigen::Index>(index))
+              = rhs.row(interface_to_full[index]);
+        }
+        for (auto const &subdomain : subdomains) {
+          Eigen::MatrixXd const coupling
+              = subdomain.to_interior
+                * interior_solutions[static_cast<size_t>(subdomain.number)];
+          for (size_t row = 0; row != subdomain.coupling_rows.size(); ++row) {
+            interface_rhs.row(local_of(subdomain.coupling_rows[row]))
+                -= coupling.row(static_cast<Eigen::Index>(row));
+          }
+        }
+
+        Eigen::MatrixXd interface_solution = interface_rhs;
+        if (interface_matrix.rows() != 0) {
+          interface_solution = interface_solver.solve(interface_rhs);
+          status = interface_solver.info();
+        }
+        for (size_t index = 0; index != interface_to_full.size(); ++index) {
+          solution.row(interface_to_full[index])
+              = interface_solution.row(static_cast<Eigen::Index>(index));
+        }
+
+        for_all_subdomains([&](Subdomain &subdomain) {
+          Eigen::MatrixXd coupling_solution(
+              static_cast<Eigen::Index>(subdomain.coupling_columns.size()),
+              rhs.cols());
+          for (size_t col = 0; col != subdomain.coupling_columns.size();
+               ++col) {
+            coupling_solution.row(static_cast<Eigen::Index>(col))
+                = interface_solution.row(
+                    local_of(subdomain.coupling_columns[col]));
+          }
+          auto &interior_solution
+              = interior_solutions[static_cast<size_t>(subdomain.number)];
+          interior_solution -= subdomain.from_coupling * coupling_solution;
+          for (size_t index = 0; index != subdomain.indices.size(); ++index) {
+            solution.row(subdomain.indices[index])
+                = interior_solution.row(static_cast<Eigen::Index>(index));
+          }
+        });
+        return solution;
+      }
+
+    private:
+      /// \brief The interior unknowns of one subdomain.
+      struct Subdomain {
+        Eigen::Index number{0};
+        /// The interior unknowns in ascending order.
+        std::vector<Eigen::Index> indices;
+        /// Interface rows with entries in the columns of this subdomain.
+        std::vector<Eigen::Index> coupling_rows;
+        /// Interface columns with entries in the rows of this subdomain.
+        std::vector<Eigen::Index> coupling_columns;
+        /// The block of the interior unknowns.
+        SparseMatrix interior;
+        /// Behind a pointer, because SparseLU can't be moved.
+        std::unique_ptr<Eigen::SparseLU<SparseMatrix>> solver;
+        /// Entries of the coupling rows in the interior columns.
+        Eigen::MatrixXd to_interior;
+        /// The inverse of the interior block times its entries in the
+        /// coupling columns.
+        Eigen::MatrixXd from_coupling;
+        /// What the subdomain subtracts from the interface matrix in the
+        /// coupling rows and columns.
+        Eigen::MatrixXd schur_complement;
+      };
+
+      static constexpr Eigen::Index interface{-1};
+
+      Eigen::Index subdomain_of(Eigen::Index index) const {
+        return subdomain_of_index[static_cast<size_t>(index)];
+      }
+
+      /// \brief The position of index in its subdomain or in the interface.
+      Eigen::Index local_of(Eigen::Index index) const {
+        return local_index[static_cast<size_t>(index)];
+      }
+
+      static void make_unique_sorted(std::vector<Eigen::Index> &indices) {
+        std::sort(indices.begin(), indices.end());
+        indices.erase(
+            std::unique(indices.begin(), indices.end()), indices.end());
+      }
+
+      /// \brief Runs task on every subdomain, subdomain i in thread i.
+      void for_all_subdomains(std::function<void(Subdomain &)> const &task) {
+        if (not threadpool) {
+          for (auto &subdomain : subdomains) {
+            task(subdomain);
+          }
+          return;
+        }
+        auto const number_of_threads
+            = static_cast<size_t>(threadpool->get_number_of_threads());
+        threadpool->run([&](int thread_index) {
+          for (auto subdomain = static_cast<size_t>(thread_index);
+               subdomain < subdomains.size(); subdomain += number_of_threads) {
+            task(subdomains[subdomain]);
+          }
+        });
+      }
+
+      /// \brief Solves with the interior block of subdomain, SparseLU can't
+      /// handle empty right-hand sides.
+      static Eigen::MatrixXd
+      solve_interior(Subdomain const &subdomain, Eigen::MatrixXd const &rhs) {
+        if (rhs.size() == 0) {
+          return rhs;
+        }
+        return subdomain.solver->solve(rhs);
+      }
+
+      /// \brief Copies the interior block of subdomain out of matrix.
+      void gather_interior(SparseMatrix const &matrix, Subdomain &subdomain) {
+        auto const size = static_cast<Eigen::Index>(subdomain.indices.size());
+        std::vector<Eigen::Triplet<double>> triplets;
+        for (size_t col = 0; col != subdomain.indices.size(); ++col) {
+          for (SparseMatrix::InnerIterator it(matrix, subdomain.indices[col]);
+               it; ++it) {
+            if (subdomain_of(it.row()) != interface) {
+              triplets.emplace_back(
+                  local_of(it.row()), static_cast<Eigen::Index>(col),
+                  it.value());
+            }
+          }
+        }
+        subdomain.interior.resize(size, size);
+        subdomain.interior.setFromTriplets(triplets.begin(), triplets.end());
+        subdomain.interior.makeCompressed();
+      }
+
+      /// \brief Factorizes the interior block and computes the Schur
+      /// complement of subdomain.
+      void
+      factorize_subdomain(SparseMatrix const &matrix, Subdomain &subdomain) {
+        gather_interior(matrix, subdomain);
+        if (subdomain.indices.empty()) {
+          return;
+        }
+        subdomain.solver->factorize(subdomain.interior);
+        if (subdomain.solver->info() != Eigen::Success) {
+          return;
+        }
+        auto const size = static_cast<Eigen::Index>(subdomain.indices.size());
+        subdomain.to_interior.setZero(
+            static_cast<Eigen::Index>(subdomain.coupling_rows.size()), size);
+        for (size_t col = 0; col != subdomain.indices.size(); ++col) {
+          for (SparseMatrix::InnerIterator it(matrix, subdomain.indices[col]);
+               it; ++it) {
+            if (subdomain_of(it.row()) == interface) {
+              auto const found = std::lower_bound(
+                  subdomain.coupling_rows.begin(),
+                  subdomain.coupling_rows.end(), it.row());
+              subdomain.to_interior(
+                  found - subdomain.coupling_rows.begin(),
+                  static_cast<Eigen::Index>(col))
+                  = it.value();
+            }
+          }
+        }
+        Eigen::MatrixXd coupling_entries = Eigen::MatrixXd::Zero(
+            size,
+            static_cast<Eigen::Index>(subdomain.coupling_columns.size()));
+        for (size_t coupling = 0; coupling != subdomain.coupling_columns.size();
+             ++coupling) {
+          for (SparseMatrix::InnerIterator it(
+                   matrix, subdomain.coupling_columns[coupling]);
+               it; ++it) {
+            if (subdomain_of(it.row()) == subdomain.number) {
+              coupling_entries(
+                  local_of(it.row()), static_cast<Eigen::Index>(coupling))
+                  = it.value();
+            }
+          }
+        }
+        subdomain.from_coupling = solve_interior(subdomain, coupling_entries);
+        subdomain.schur_complement
+            = subdomain.to_interior * subdomain.from_coupling;
+      }
+
+      /// \brief Assembles the entries between interface unknowns and
+      /// subtracts the Schur complements of the subdomains.
+      void assemble_interface_matrix(SparseMatrix const &matrix) {
+        std::vector<Eigen::Triplet<double>> triplets;
+        for (auto col : interface_to_full) {
+          for (SparseMatrix::InnerIterator it(matrix, col); it; ++it) {
+            if (subdomain_of(it.row()) == interface) {
+              triplets.emplace_back(
+                  local_of(it.row()), local_of(col), it.value());
+            }
+          }
+        }
+        for (auto const &subdomain : subdomains) {
+          for (size_t row = 0; row != subdomain.coupling_rows.size(); ++row) {
+            for (size_t col = 0; col != subdomain.coupling_columns.size();
+                 ++col) {
+              triplets.emplace_back(
+                  local_of(subdomain.coupling_rows[row]),
+                  local_of(subdomain.coupling_columns[col]),
+                  -subdomain.schur_complement(
+                      static_cast<Eigen::Index>(row),
+                      static_cast<Eigen::Index>(col)));
+            }
+          }
+        }
+        auto const interface_size
+            = static_cast<Eigen::Index>(interface_to_full.size());
+        interface_matrix.resize(interface_size, interface_size);
+        interface_matrix.setFromTriplets(triplets.begin(), triplets.end());
+      }
+
+      std::vector<std::vector<std::pair<Eigen::Index, Eigen::Index>>>
+          subdomain_ranges;
+      std::vector<Subdomain> subdomains;
+      /// The subdomain of every index or #interface.
+      std::vector<Eigen::Index> subdomain_of_index;
+      /// The position of every index in its subdomain or in the interface.
+      std::vector<Eigen::Index> local_index;
+      std::vector<Eigen::Index> interface_to_full;
+      SparseMatrix interface_matrix;
+      Eigen::SparseLU<SparseMatrix> interface_solver;
+      std::unique_ptr<Aux::Threadpool> threadpool;
+      Eigen::ComputationInfo status{Eigen::InvalidInput};
+    };
+
+#ifdef GRAZER_HAVE_KLU
+    /// \brief Uses KLU directly, because the Eigen wrapper does not offer the
+    /// refactorization with the pivot sequence of an earlier factorization.
+    class KLUlinearsolver final : public Linearsolver {
+    public:
+      KLUlinearsolver() { klu_defaults(&common); }
+
+      ~KLUlinearsolver() final { free_factorizations(); }
+
+      KLUlinearsolver(KLUlinearsolver const &) = delete;
+      KLUlinearsolver &operator=(KLUlinearsolver const &) = delete;
+
+      void analyze_pattern(SparseMatrix const &matrix) final {
+        assert(matrix.isCompressed());
+        free_factorizations();
+        auto &mutable_matrix = const_cast<SparseMatrix &>(matrix);
+        symbolic = klu_analyze(
+            static_cast<int>(matrix.rows()), mutable_matrix.outerIndexPtr(),
+            mutable_matrix.innerIndexPtr(), &common);
+        status = symbolic ? Eigen::Success : Eigen::InvalidInput;
+      }
+
+      void factorize(SparseMatrix const &matrix) final {
+        assert(matrix.isCompressed());
+        pivots_reused = false;
+        if (not symbolic) {
+          status = Eigen::InvalidInput;
+          return;
+        }
+        if (numeric) {
+          klu_free_numeric(&numeric, &common);
+        }
+        auto &mutable_matrix = const_cast<SparseMatrix &>(matrix);
+        numeric = klu_factor(
+            mutable_matrix.outerIndexPtr(), mutable_matrix.innerIndexPtr(),
+            mutable_matrix.valuePtr(), symbolic, &common);
+        if (not numeric or not klu_rcond(symbolic, numeric, &common)) {
+          status = Eigen::NumericalIssue;
+          return;
+        }
+        factorized_rcond = common.rcond;
+        status = Eigen::Success;
+      }
+
+      /// Keeps the pivots, unless the cheap reciprocal condition estimate of
+      /// KLU has dropped by more than #pivot_degradation since the last full
+      /// factorization.
+      void refactorize(SparseMatrix const &matrix) final {
+        assert(matrix.isCompressed());
+        if (not numeric) {
+          factorize(matrix);
+          return;
+        }
+        auto &mutable_matrix = const_cast<SparseMatrix &>(matrix);
+        bool success = klu_refactor(
+            mutable_matrix.outerIndexPtr(), mutable_matrix.innerIndexPtr(),
+            mutable_matrix.valuePtr(), symbolic, numeric, &common);
+        success = success and klu_rcond(symbolic, numeric, &common);
+        if (success and common.rcond >= pivot_degradation * factorized_rcond) {
+          pivots_reused = true;
+          status = Eigen::Success;
+          return;
+        }
+        factorize(matrix);
+      }
+
+      bool can_reuse_pivots() const final { return true; }
+
+      bool reused_pivots() const final { return pivots_reused; }
+
+      Eigen::ComputationInfo info() const final { return status; }
+
+      Eigen::MatrixXd
+      solve(Eigen::Ref<Eigen::MatrixXd const> const &rhs) final {
+        Eigen::MatrixXd solution = rhs;
+        if (not numeric
+            or not klu_solve(
+                symbolic, numeric, static_cast<int>(solution.rows()),
+                static_cast<int>(solution.cols()), solution.data(), &common)) {
+          status = Eigen::NumericalIssue;
+        }
+        return solution;
+      }
+
+    private:
+      void free_factorizations() {
+        if (numeric) {
+          klu_free_numeric(&numeric, &common);
+        }
+        if (symbolic) {
+          klu_free_symbolic(&symbolic, &common);
+        }
+      }
+
+      /// Relative drop of the reciprocal condition estimate, at which a
+      /// refactorization is replaced by a full factorization.
+      static constexpr double pivot_degradation{1e-3};
+
+      klu_common common;
+      klu_symbolic *symbolic{nullptr};
+      klu_numeric *numeric{nullptr};
+      double factorized_rcond{0.0};
+      bool pivots_reused{false};
+      Eigen::ComputationInfo status{Eigen::InvalidInput};
+    };
+#endif
+  } // namespace
+
+  std::vector<std::string> get_linearsolver_names() {
+    return {
+        "SparseLU", "BiCGSTAB", "GMRES", "BlockJacobi", "Condensation",
+        "DomainDecomposition",
+#ifdef GRAZER_HAVE_KLU
+        "KLU",
+#endif
+#ifdef GRAZER_HAVE_UMFPACK
+        "UmfPack",
+#endif
+    };
+  }
+
+  std::unique_ptr<Linearsolver> make_linearsolver(std::string const &name) {
+    if (name == "SparseLU") {
+      return std::make_unique<
+          Eigenlinearsolver<Eigen::SparseLU<SparseMatrix>>>();
+    }
+    if (name == "BiCGSTAB") {
+      return std::make_unique<Eigenlinearsolver<
+          Eigen::BiCGSTAB<SparseMatrix, Eigen::IncompleteLUT<double>>>>();
+    }
+    if (name == "GMRES") {
+      return std::make_unique<Eigenlinearsolver<
+          Eigen::GMRES<SparseMatrix, Eigen::IncompleteLUT<double>>>>();
+    }
+    if (name == "BlockJacobi") {
+      return std::make_unique<Blockjacobilinearsolver>();
+    }
+    if (name == "Condensation") {
+      return std::make_unique<Condensationlinearsolver>();
+    }
+    if (name == "DomainDecomposition") {
+      return std::make_unique<Domaindecompositionlinearsolver>();
+    }
+#ifdef GRAZER_HAVE_KLU
+    if (name == "KLU") {
+      return std::make_unique<KLUlinearsolver>();
+    }
+#endif
+#ifdef GRAZER_HAVE_UMFPACK
+    if (name == "UmfPack") {
+      return std::make_unique<
+          Eigenlinearsolver<Eigen::UmfPackLU<SparseMatrix>>>();
+    }
+#endif
+    std::string available;
+    for (auto const &available_name : get_linearsolver_names()) {
+      available += " " + available_name;
+    }
+    gthrow(
+        {"Unknown linear solver \"", name,
+         "\". The linear solvers in this build are:", available});
+  }
+
+} // namespace Solver
@@ -18,13 +18,26 @@
 #include "Controlcomponent.hpp"
 #include "Exception.hpp"
 #include "Matrixhandler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace Solver {
 
-  Newtonsolver::Newtonsolver(double _tolerance, int _maximal_iterations) :
-      tolerance(_tolerance), maximal_iterations(_maximal_iterations) {}
+  Newtonsolver::Newtonsolver(
+      double _tolerance, int _maximal_iterations,
+      std::string const &linearsolver_name, bool _reuse_pivots,
+      bool _jacobian_free, bool _broyden_updates) :
+      linearsolver(make_linearsolver(linearsolver_name)),
+      tolerance(_tolerance),
+      maximal_iterations(_maximal_iterations),
+      reuse_pivots(_reuse_pivots),
+      jacobian_free(_jacobian_free),
+      broyden_updates(_broyden_updates) {}
 
   void Newtonsolver::evaluate_state_derivative_triplets(
       Model::Controlcomponent const &problem, double last_time, double new_time,
@@ -40,7 +53,23 @@ namespace Solver {
           handler, last_time, new_time, last_state, new_state, control);
       handler.set_matrix();
     }
-    lusolver.analyzePattern(jacobian);
+    jacobian_slots.clear();
+    linearsolver->set_condensable_ranges(problem.get_condensable_ranges());
+    auto const number_of_subdomains = linearsolver->get_number_of_subdomains();
+    if (number_of_subdomains > 0) {
+      linearsolver->set_subdomains(
+          problem.get_subdomains(number_of_subdomains));
+    }
+    linearsolver->analyze_pattern(jacobian);
+    has_factorization = false;
+  }
+
+  void Newtonsolver::set_number_of_threads(int number_of_threads) {
+    linearsolver->set_number_of_threads(number_of_threads);
+  }
+
+  bool Newtonsolver::can_reuse_pivots() const {
+    return linearsolver->can_reuse_pivots();
   }
 
   void Newtonsolver::evaluate_state_derivative_coeffref(
@@ -48,9 +77,171 @@ namespace Solver {
       Eigen::Ref<Eigen::VectorXd const> const &last_state,
       Eigen::Ref<Eigen::VectorXd const> const &new_state,
       Eigen::Ref<Eigen::VectorXd const> const &control) {
-    Aux::Coeffrefhandler handler(jacobian);
-    problem.d_evaluate_d_new_state(
-        handler, last_time, new_time, last_state, new_state, control);
+    auto const old_number_of_nonzeros = jacobian.nonZeros();
+    {
+      Aux::Slothandler handler(jacobian, jacobian_slots);
+      problem.d_evaluate_d_new_state(
+          handler, last_time, new_time, last_state, new_state, control);
+    }
+    if (jacobian.nonZeros() != old_number_of_nonzeros) {
+      // The sparsity pattern has grown, so the old analysis is worthless.
+      jacobian.makeCompressed();
+      linearsolver->analyze_pattern(jacobian);
+      has_factorization = false;
+    }
+  }
+
+  void Newtonsolver::evaluate_state_derivative_keep_pattern(
+      Model::Controlcomponent const &problem, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Eigen::Ref<Eigen::VectorXd const> const &control) {
+    if (jacobian.rows() != new_state.size() or jacobian.nonZeros() == 0) {
+      evaluate_state_derivative_triplets(
+          problem, last_time, new_time, last_state, new_state, control);
+    } else {
+      evaluate_state_derivative_coeffref(
+          problem, last_time, new_time, last_state, new_state, control);
+    }
+  }
+
+  bool Newtonsolver::evaluate_with_state_derivative(
+      Eigen::Ref<Eigen::VectorXd> rootvalues,
+      Eigen::SparseMatrix<double> &matrix, Aux::Slotmap &slots,
+      Model::Controlcomponent const &problem, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Eigen::Ref<Eigen::VectorXd const> const &control) {
+    auto const old_number_of_nonzeros = matrix.nonZeros();
+    {
+      Aux::Slothandler handler(matrix, slots);
+      problem.evaluate_with_derivative(
+          rootvalues, handler, last_time, new_time, last_state, new_state,
+          control);
+    }
+    if (matrix.nonZeros() == old_number_of_nonzeros) {
+      return false;
+    }
+    matrix.makeCompressed();
+    return true;
+  }
+
+  void Newtonsolver::factorize_jacobian(double new_time) {
+    if (reuse_pivots) {
+      linearsolver->refactorize(jacobian);
+    } else {
+      linearsolver->factorize(jacobian);
+    }
+    if (linearsolver->info() != Eigen::Success) {
+      std::ostringstream o;
+      o << "Couldn't decompose a Jacobian, it may be non-invertible.\n "
+        << "time: " << std::to_string(new_time)
+        << "\n Maybe try another linear solver.\n";
+      has_factorization = false;
+      throw SolverNumericalProblem(o.str());
+    }
+    has_factorization = true;
+  }
+
+  Eigen::VectorXd Newtonsolver::solve_jacobian_free(
+      Eigen::Ref<Eigen::VectorXd const> const &rhs,
+      Model::Controlcomponent const &problem, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Eigen::Ref<Eigen::VectorXd const> const &values,
+      Eigen::Ref<Eigen::VectorXd const> const &control) {
+    auto const size = rhs.size();
+    Eigen::VectorXd solution = Eigen::VectorXd::Zero(size);
+    double const rhs_norm = rhs.norm();
+    if (rhs_norm == 0.0) {
+      return solution;
+    }
+
+    Eigen::VectorXd perturbed_values(size);
+    // Forward difference approximation of f'(new_state) * direction:
+    auto apply_jacobian = [&](Eigen::VectorXd const &direction) {
+      double const direction_norm = direction.norm();
+      if (direction_norm == 0.0) {
+        return Eigen::VectorXd::Zero(size).eval();
+      }
+      double const epsilon = std::sqrt(std::numeric_limits<double>::epsilon())
+                             * (1.0 + new_state.norm()) / direction_norm;
+      Eigen::VectorXd const perturbed_state = new_state + epsilon * direction;
+      problem.evaluate(
+          perturbed_values, last_time, new_time, last_state, perturbed_state,
+          control);
+      return ((perturbed_values - values) / epsilon).eval();
+    };
+
+    auto const dimension = std::min(Eigen::Index{krylov_dimension}, size);
+    Eigen::MatrixXd basis(size, dimension + 1);
+    Eigen::MatrixXd hessenberg
+        = Eigen::MatrixXd::Zero(dimension + 1, dimension);
+    Eigen::VectorXd cosines(dimension);
+    Eigen::VectorXd sines(dimension);
+    Eigen::VectorXd projected_residual(dimension + 1);
+
+    Eigen::VectorXd residual = rhs;
+    for (int restart = 0; restart != maximal_krylov_restarts; ++restart) {
+      double const residual_norm = residual.norm();
+      if (residual_norm <= krylov_tolerance * rhs_norm) {
+        break;
+      }
+      basis.col(0) = residual / residual_norm;
+      projected_residual.setZero();
+      projected_residual(0) = residual_norm;
+      Eigen::Index used_dimension = 0;
+      while (used_dimension != dimension) {
+        auto const j = used_dimension;
+        Eigen::VectorXd new_direction
+            = apply_jacobian(linearsolver->solve(basis.col(j)));
+        // modified Gram-Schmidt:
+        for (Eigen::Index i = 0; i <= j; ++i) {
+          hessenberg(i, j) = basis.col(i).dot(new_direction);
+          new_direction -= hessenberg(i, j) * basis.col(i);
+        }
+        double const new_direction_norm = new_direction.norm();
+        hessenberg(j + 1, j) = new_direction_norm;
+        if (new_direction_norm > 0.0) {
+          basis.col(j + 1) = new_direction / new_direction_norm;
+        }
+        // Bring the hessenberg matrix to triangular form:
+        for (Eigen::Index i = 0; i != j; ++i) {
+          double const upper = hessenberg(i, j);
+          hessenberg(i, j)
+              = cosines(i) * upper + sines(i) * hessenberg(i + 1, j);
+          hessenberg(i + 1, j)
+              = -sines(i) * upper + cosines(i) * hessenberg(i + 1, j);
+        }
+        double const radius
+            = std::hypot(hessenberg(j, j), hessenberg(j + 1, j));
+        if (radius == 0.0) {
+          break;
+        }
+        cosines(j) = hessenberg(j, j) / radius;
+        sines(j) = hessenberg(j + 1, j) / radius;
+        hessenberg(j, j) = radius;
+        hessenberg(j + 1, j) = 0.0;
+        projected_residual(j + 1) = -sines(j) * projected_residual(j);
+        projected_residual(j) *= cosines(j);
+        ++used_dimension;
+        if (std::abs(projected_residual(j + 1)) <= krylov_tolerance * rhs_norm
+            or new_direction_norm == 0.0) {
+          break;
+        }
+      }
+      if (used_dimension == 0) {
+        break;
+      }
+      Eigen::VectorXd const coefficients
+          = hessenberg.topLeftCorner(used_dimension, used_dimension)
+                .triangularView<Eigen::Upper>()
+                .solve(projected_residual.head(used_dimension));
+      solution
+          += linearsolver->solve(basis.leftCols(used_dimension) * coefficients);
+      residual = rhs - apply_jacobian(solution);
+    }
+    return solution;
   }
 
   Eigen::Index Newtonsolver::get_number_non_zeros_jacobian() {
@@ -65,16 +256,22 @@ namespace Solver {
       Model::Controlcomponent const &problem, bool newjac,
       bool use_full_jacobian, double last_time, double new_time,
       Eigen::Ref<Eigen::VectorXd const> const &last_state,
-      Eigen::Ref<Eigen::VectorXd const> const &control) {
+      Eigen::Ref<Eigen::VectorXd const> const &control,
+      bool reuse_factorization) {
     Solutionstruct solstruct;
 
     Eigen::VectorXd rootvalues(new_state.size());
 
-    // compute f(x_k);
+    bool keep_old_factorization = reuse_factorization and has_factorization
+                                  and not newjac and not use_full_jacobian;
+    // is true, while jacobian holds f'(new_state):
+    bool jacobian_is_current = false;
+
+    // compute f(x_k):
     problem.evaluate(
         rootvalues, last_time, new_time, last_state, new_state, control);
 
-    // check if already there:
+    // check if already there, before a jacobian is assembled in vain:
     if (rootvalues.norm() <= tolerance) {
       solstruct.success = true;
       solstruct.residual = rootvalues.norm();
@@ -82,53 +279,91 @@ namespace Solver {
       return solstruct;
     }
 
-    // compute f'(x_k) and write it to the jacobian.
-    if (newjac) {
-      evaluate_state_derivative_triplets(
-          problem, last_time, new_time, last_state, new_state, control);
-    } else {
-      evaluate_state_derivative_coeffref(
-          problem, last_time, new_time, last_state, new_state, control);
+    if (not keep_old_factorization) {
+      // compute f'(x_k) and write it to the jacobian.
+      if (newjac) {
+        evaluate_state_derivative_triplets(
+            problem, last_time, new_time, last_state, new_state, control);
+      } else {
+        evaluate_state_derivative_coeffref(
+            problem, last_time, new_time, last_state, new_state, control);
+      }
+      jacobian_is_current = true;
+      if (not use_full_jacobian) {
+        factorize_jacobian(new_time);
+      }
     }
-    if (not use_full_jacobian) {
-      lusolver.factorize(jacobian);
-      if (lusolver.info() != Eigen::Success) {
+    bool const use_broyden_updates
+        = broyden_updates and not use_full_jacobian and not jacobian_free;
+    // The Broyden updates of the inverse jacobian have the form
+    // H_{k+1} = (I + correction_k * step_k^T) H_k.
+    std::vector<Eigen::VectorXd> broyden_steps;
+    std::vector<Eigen::VectorXd> broyden_corrections;
+
+    // solves f'(new_state) * x = rhs, with the factorized jacobian or without
+    // the jacobian:
+    auto solve_linear_system = [&](Eigen::VectorXd const &rhs) {
+      if (jacobian_free) {
+        return solve_jacobian_free(
+            rhs, problem, last_time, new_time, last_state, new_state,
+            rootvalues, control);
+      }
+      Eigen::VectorXd solution = linearsolver->solve(rhs);
+      // Iterative linear solvers report here, whether they converged, but
+      // may also just return a non-finite solution:
+      if (linearsolver->info() != Eigen::Success or not solution.allFinite()) {
         std::ostringstream o;
-        o << "Couldn't decompose a Jacobian, it may be non-invertible.\n "
+        o << "Couldn't solve for a Newton step, the linear solver did not "
+             "converge.\n "
           << "time: " << std::to_string(new_time)
-          << "\n Note, that only LU decomposition is implemented.\n";
+          << "\n Maybe try another linear solver.\n";
         throw SolverNumericalProblem(o.str());
       }
-    }
+      for (size_t i = 0; i != broyden_steps.size(); ++i) {
+        solution += broyden_steps[i].dot(solution) * broyden_corrections[i];
+      }
+      return solution;
+    };
     while (rootvalues.norm() > tolerance
            && solstruct.used_iterations < maximal_iterations) {
       if (use_full_jacobian) {
-        evaluate_state_derivative_coeffref(
-            problem, last_time, new_time, last_state, new_state, control);
-        lusolver.factorize(jacobian);
-        if (lusolver.info() != Eigen::Success) {
-          std::ostringstream o;
-          o << "Couldn't decompose a Jacobian, it may be non-invertible.\n "
-            << "time: " << std::to_string(new_time)
-            << "\n Note, that only LU decomposition is implemented.\n";
-          throw SolverNumericalProblem(o.str());
+        if (not jacobian_is_current) {
+          evaluate_state_derivative_coeffref(
+              problem, last_time, new_time, last_state, new_state, control);
         }
+        factorize_jacobian(new_time);
       }
       // compute Dx_k:
-      Eigen::VectorXd step = -lusolver.solve(rootvalues);
+      Eigen::VectorXd step = -solve_linear_system(rootvalues);
 
       double lambda = 1.0;
       // candidate for x_{k+1}
       Eigen::VectorXd candidate_vector = new_state + lambda * step;
 
-      // f(x_{k+1}
+      // f(x_{k+1}), with full jacobians together with f'(x_{k+1}) for the
+      // next step in one pass. The first candidate is usually accepted, so
+      // the jacobian is only wasted, if it is rejected or converged:
       Eigen::VectorXd candidate_values(new_state.size());
-      problem.evaluate(
-          candidate_values, last_time, new_time, last_state, candidate_vector,
-          control);
+      bool candidate_has_jacobian = false;
+      if (use_full_jacobian) {
+        if (candidate_jacobian.rows() != jacobian.rows()
+            or candidate_jacobian.nonZeros() != jacobian.nonZeros()) {
+          candidate_jacobian = jacobian;
+          candidate_jacobian_slots.clear();
+        }
+        evaluate_with_state_derivative(
+            candidate_values, candidate_jacobian, candidate_jacobian_slots,
+            problem, last_time, new_time, last_state, candidate_vector,
+            control);
+        candidate_has_jacobian = true;
+      } else {
+        problem.evaluate(
+            candidate_values, last_time, new_time, last_state,
+            candidate_vector, control);
+      }
 
       // Delta^bar x_k+1
-      Eigen::VectorXd delta_x_bar = -lusolver.solve(candidate_values);
+      Eigen::VectorXd delta_x_bar = -solve_linear_system(candidate_values);
 
       double current_norm = delta_x_bar.norm();
 
@@ -145,10 +380,44 @@ namespace Solver {
         problem.evaluate(
             candidate_values, last_time, new_time, last_state, candidate_vector,
             control);
-        current_norm = (-lusolver.solve(candidate_values)).norm();
+        candidate_has_jacobian = false;
+        delta_x_bar = -solve_linear_system(candidate_values);
+        current_norm = delta_x_bar.norm();
+      }
+      if (testnorm > 0) {
+        solstruct.contraction
+            = std::max(solstruct.contraction, current_norm / testnorm);
+      }
+      if (use_broyden_updates) {
+        if (broyden_steps.size() == maximal_broyden_updates) {
+          broyden_steps.clear();
+          broyden_corrections.clear();
+        }
+        // H_k (f(x_{k+1}) - f(x_k)), from the two corrections above:
+        Eigen::VectorXd const inverse_times_difference = step - delta_x_bar;
+        Eigen::VectorXd accepted_step = lambda * step;
+        double const denominator = accepted_step.dot(inverse_times_difference);
+        if (std::abs(denominator) > std::numeric_limits<double>::epsilon()
+                                        * accepted_step.norm()
+                                        * inverse_times_difference.norm()) {
+          broyden_corrections.push_back(
+              (accepted_step - inverse_times_difference) / denominator);
+          broyden_steps.push_back(std::move(accepted_step));
+        }
       }
       new_state = candidate_vector;
       rootvalues = candidate_values;
+      jacobian_is_current = candidate_has_jacobian;
+      if (candidate_has_jacobian) {
+        auto const old_number_of_nonzeros = jacobian.nonZeros();
+        jacobian.swap(candidate_jacobian);
+        std::swap(jacobian_slots, candidate_jacobian_slots);
+        if (jacobian.nonZeros() != old_number_of_nonzeros) {
+          // The sparsity pattern has grown, so the old analysis is worthless.
+          linearsolver->analyze_pattern(jacobian);
+          has_factorization = false;
+        }
+      }
       ++solstruct.used_iterations;
       solstruct.residual = rootvalues.norm();
     }
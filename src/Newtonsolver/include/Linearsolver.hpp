@@ -0,0 +1,121 @@
+/*
+ * Grazer - network simulation and optimization tool
+ *
+ * Copyright 2020-2022 Uni Mannheim <e.fokken+grazer@posteo.de>,
+ *
+ * SPDX-License-Identifier:	MIT
+ *
+ * Licensed under the MIT License, found in the file LICENSE and at
+ * https://opensource.org/licenses/MIT
+ * This file may not be copied, modified, or distributed except according to
+ * those terms.
+ *
+ * Distributed on an "AS IS" BASIS, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied.  See your chosen license for details.
+ *
+ */
+#pragma once
+#include <Eigen/Sparse>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Solver {
+
+  /** \brief Common interface of the sparse linear solvers, that can be used
+   * for the jacobians.
+   *
+   * The methods mirror the interface of the Eigen sparse solvers, so that
+   * every Eigen solver can be wrapped with little effort. The matrix handed
+   * to #factorize must outlive the following calls to #solve, because the
+   * iterative solvers keep a reference to it.
+   */
+  class Linearsolver {
+  public:
+    virtual ~Linearsolver();
+
+    /** \brief Analyzes the sparsity pattern of matrix, which must not change
+     * in the following calls to #factorize.
+     */
+    virtual void analyze_pattern(Eigen::SparseMatrix<double> const &matrix)
+        = 0;
+
+    /** \brief Computes the numerical factorization (or the preconditioner)
+     * of matrix.
+     */
+    virtual void factorize(Eigen::SparseMatrix<double> const &matrix) = 0;
+
+    /** \brief Computes the numerical factorization of matrix, reusing the
+     * pivot sequence of the previous factorization, if the solver supports
+     * that.
+     *
+     * Solvers, that can't reuse pivots, just call #factorize. Those that can
+     * fall back to #factorize, if the old pivots have become too bad.
+     */
+    virtual void refactorize(Eigen::SparseMatrix<double> const &matrix);
+
+    /** \brief Returns true, if #refactorize can reuse the pivot sequence of
+     * the previous factorization instead of just calling #factorize.
+     */
+    virtual bool can_reuse_pivots() const;
+
+    /** \brief Returns true, if the last #refactorize kept the old pivot
+     * sequence, false after a fall back to #factorize.
+     */
+    virtual bool reused_pivots() const;
+
+    /** \brief Index ranges [first, after) of the following matrices, whose
+     * unknowns may be eliminated by static condensation, see
+     * Model::Equation_base::get_condensable_ranges().
+     *
+     * Takes effect with the next #analyze_pattern. Solvers, that can't make
+     * use of the ranges, ignore them.
+     */
+    virtual void set_condensable_ranges(
+        std::vector<std::pair<Eigen::Index, Eigen::Index>> const &ranges);
+
+    /** \brief Returns the number of subdomains, into which the solver wants
+     * the unknowns to be split, 0 if it doesn't decompose the matrix.
+     */
+    virtual int get_number_of_subdomains() const;
+
+    /** \brief Sets the subdomains of the following matrices, each a list of
+     * index ranges [first, after), see
+     * Model::Controlcomponent::get_subdomains().
+     *
+     * Takes effect with the next #analyze_pattern. Solvers, that don't
+     * decompose the matrix, ignore them.
+     */
+    virtual void set_subdomains(
+        std::vector<std::vector<std::pair<Eigen::Index, Eigen::Index>>> const
+            &subdomains);
+
+    /** \brief Lets solvers, that can work in parallel, use
+     * number_of_threads threads. Others ignore it.
+     */
+    virtual void set_number_of_threads(int number_of_threads);
+
+    /** \brief Reports, whether the last #factorize or #solve succeeded.
+     */
+    virtual Eigen::ComputationInfo info() const = 0;
+
+    /** \brief Solves matrix * x = rhs for the matrix last handed to
+     * #factorize. Every column of rhs is a separate right-hand side.
+     */
+    virtual Eigen::MatrixXd solve(Eigen::Ref<Eigen::MatrixXd const> const &rhs)
+        = 0;
+  };
+
+  /** \brief Returns the names of all linear solvers available in this build.
+   *
+   * The first name is the default.
+   */
+  std::vector<std::string> get_linearsolver_names();
+
+  /** \brief Constructs the linear solver of the given name, see
+   * #get_linearsolver_names.
+   */
+  std::unique_ptr<Linearsolver> make_linearsolver(std::string const &name);
+
+} // namespace Solver
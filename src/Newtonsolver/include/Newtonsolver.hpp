@@ -15,10 +15,12 @@
  *
  */
 #pragma once
+#include "Linearsolver.hpp"
+#include "Matrixhandler.hpp"
 #include <Eigen/Sparse>
-#include <Eigen/SparseLU>
-#include <Eigen/SparseQR>
+#include <memory>
 #include <stdexcept>
+#include <string>
 
 /// \brief This namespace holds tools for solving numerical problems, e.g.
 /// finding the root of a non-linear function.
@@ -34,12 +36,20 @@ namespace Solver {
   /** \brief This struct holds info on the solution of a solve-execution.
    */
   struct Solutionstruct {
-    bool success{false}; //! is true, if solve found a solution.
-    double residual{
-        1000000.0}; //! is the absolute value of f(new_state) after solve.
-    int used_iterations{0}; //! the number of needed Newton steps
+    /** \brief is true, if solve found a solution.
+     */
+    bool success{false};
+    /** \brief is the absolute value of f(new_state) after solve.
+     */
+    double residual{1000000.0};
     /** \brief the number of Newton steps needed.
      */
+    int used_iterations{0};
+    /** \brief the largest ratio of the simplified Newton correction to the
+     * Newton correction, that was observed in the Newton steps. Small values
+     * mean fast convergence.
+     */
+    double contraction{0.0};
   };
 
   /** \brief Manages solving non-linear systems and (to be implemented)
@@ -50,12 +60,44 @@ namespace Solver {
    */
   class Newtonsolver {
   public:
-    Newtonsolver(double _tolerance, int _maximal_iterations);
+    /** \brief Constructs a Newtonsolver.
+     *
+     * @param _tolerance Tolerance under which equality is accepted.
+     * @param _maximal_iterations Highest number of iterations after which to
+     * give up.
+     * @param linearsolver_name The name of the linear solver for the
+     * jacobians, see Solver::get_linearsolver_names().
+     * @param _reuse_pivots If true, jacobians are refactorized with the pivot
+     * sequence of the last factorization, see Linearsolver::refactorize().
+     * @param _jacobian_free If true, the Newton steps are computed with GMRES
+     * from directional derivatives of the residual, see
+     * #solve_jacobian_free(). The linear solver then only serves as
+     * preconditioner.
+     * @param _broyden_updates If true, the factorized jacobian is improved by
+     * Broyden updates between jacobian evaluations, see #solve().
+     */
+    Newtonsolver(
+        double _tolerance, int _maximal_iterations,
+        std::string const &linearsolver_name = "SparseLU",
+        bool _reuse_pivots = false, bool _jacobian_free = false,
+        bool _broyden_updates = false);
+
+    /** \brief Lets the linear solver use number_of_threads threads, if it
+     * can, see Linearsolver::set_number_of_threads().
+     */
+    void set_number_of_threads(int number_of_threads);
+
+    /** \brief Returns true, if the linear solver can reuse pivot sequences,
+     * see Linearsolver::can_reuse_pivots().
+     */
+    bool can_reuse_pivots() const;
 
     /** \brief Reanalyzes the sparsity pattern of the jacobian the objective
      * function and computes it.
      *
-     * The jacobian is saved into the data member named "jacobian".
+     * The jacobian is saved into the data member named "jacobian". The
+     * condensable ranges and, if the linear solver wants them, the subdomains
+     * of the problem are handed to the linear solver before the analysis.
      */
     void evaluate_state_derivative_triplets(
         Model::Controlcomponent const &problem, double last_time,
@@ -68,7 +110,8 @@ namespace Solver {
      *
      * The jacobian is saved into the data member named "jacobian".
      * Only call this version if you are sure that the sparsity pattern is
-     * unchanged.
+     * unchanged. Should coefficients outside the pattern show up nonetheless,
+     * they are inserted and the pattern is analyzed anew.
      */
 
     void evaluate_state_derivative_coeffref(
@@ -77,6 +120,19 @@ namespace Solver {
         Eigen::Ref<Eigen::VectorXd const> const &new_state,
         Eigen::Ref<Eigen::VectorXd const> const &control);
 
+    /** \brief Computes the jacobian and keeps the sparsity pattern and its
+     * analysis from earlier calls, if there are any.
+     *
+     * Falls back to #evaluate_state_derivative_triplets, if the jacobian has
+     * not been set up for a state of this size yet. So repeated simulations
+     * of the same problem need only numerical factorizations.
+     */
+    void evaluate_state_derivative_keep_pattern(
+        Model::Controlcomponent const &problem, double last_time,
+        double new_time, Eigen::Ref<Eigen::VectorXd const> const &last_state,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state,
+        Eigen::Ref<Eigen::VectorXd const> const &control);
+
     /** \brief Returns the number of structurally non-zero indices of the
      * jacobian.
      */
@@ -93,30 +149,95 @@ namespace Solver {
      * "Deuflhard and Hohmann: Numerical Analysis in Modern Scientific
      * Computing". Afterwards there should hold f(new_state) == 0 (up to
      * tolerance).
+     *
+     * If reuse_factorization is true and use_full_jacobian is false, the
+     * factorization of the jacobian from an earlier call is used, if there is
+     * one, instead of evaluating and factorizing a new jacobian.
+     *
+     * If the Newtonsolver was constructed with Broyden updates and
+     * use_full_jacobian is false, every accepted step applies a rank-one
+     * Broyden update to the inverse of the factorized jacobian by the
+     * Sherman-Morrison formula. So the iterations converge nearly as fast as
+     * with a full jacobian while only one jacobian per call is evaluated.
+     *
+     * A converged initial guess costs no jacobian. With use_full_jacobian
+     * the first candidate of each line search, which is usually accepted, is
+     * evaluated together with its jacobian in one pass through the problem.
+     * That jacobian is wasted, if the candidate is rejected or converged.
      */
     Solutionstruct solve(
         Eigen::Ref<Eigen::VectorXd> new_state,
         Model::Controlcomponent const &problem, bool newjac,
         bool use_full_jacobian, double last_time, double new_time,
         Eigen::Ref<Eigen::VectorXd const> const &last_state,
-        Eigen::Ref<Eigen::VectorXd const> const &control);
+        Eigen::Ref<Eigen::VectorXd const> const &control,
+        bool reuse_factorization = false);
 
   private:
-    /** Holds an instance of the actual solver, to save computation time it
-     * is kept from previous time steps because usually the sparsity
-     * pattern will not change.
+    /** \brief Factorizes #jacobian and throws SolverNumericalProblem on
+     * failure.
+     */
+    void factorize_jacobian(double new_time);
+
+    /** \brief Evaluates f(new_state) into rootvalues and f'(new_state) into
+     * matrix in one pass through the problem, see
+     * Model::Controlcomponent::evaluate_with_derivative().
+     *
+     * matrix must already hold the sparsity pattern. Returns true, if
+     * coefficients outside the pattern showed up and were inserted.
+     */
+    bool evaluate_with_state_derivative(
+        Eigen::Ref<Eigen::VectorXd> rootvalues,
+        Eigen::SparseMatrix<double> &matrix, Aux::Slotmap &slots,
+        Model::Controlcomponent const &problem, double last_time,
+        double new_time, Eigen::Ref<Eigen::VectorXd const> const &last_state,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state,
+        Eigen::Ref<Eigen::VectorXd const> const &control);
+
+    /** \brief Approximately solves f'(new_state) * x = rhs with restarted
+     * GMRES, without using #jacobian itself.
+     *
+     * Products of f'(new_state) with vectors are approximated by forward
+     * differences of f, where values holds f(new_state). #linearsolver with
+     * its current factorization is used as right preconditioner, so it may
+     * belong to an outdated jacobian or be as cheap as "BlockJacobi".
      */
-    Eigen::SparseLU<Eigen::SparseMatrix<double>> lusolver;
+    Eigen::VectorXd solve_jacobian_free(
+        Eigen::Ref<Eigen::VectorXd const> const &rhs,
+        Model::Controlcomponent const &problem, double last_time,
+        double new_time, Eigen::Ref<Eigen::VectorXd const> const &last_state,
+        Eigen::Ref<Eigen::VectorXd const> const &new_state,
+        Eigen::Ref<Eigen::VectorXd const> const &values,
+        Eigen::Ref<Eigen::VectorXd const> const &control);
 
-    // Later on we may include qr decomposition for badly conditioned
-    // jacobians. Eigen::SparseQR<Eigen::SparseMatrix<double>,
-    // Eigen::COLAMDOrdering<int>> qrsolver;
+    /** Holds an instance of the actual linear solver, to save computation
+     * time it is kept from previous time steps because usually the sparsity
+     * pattern will not change.
+     */
+    std::unique_ptr<Linearsolver> linearsolver;
 
     /** This will be the jacobian matrix.  We hold it here so its sparsity
      * pattern is preserved.
      */
     Eigen::SparseMatrix<double> jacobian;
 
+    /** Remembers where the coefficients of #jacobian are stored, so that
+     * #evaluate_state_derivative_coeffref needs no search.
+     */
+    Aux::Slotmap jacobian_slots;
+
+    /** With a full jacobian in every step, the jacobian at the first
+     * candidate of the line search is computed here together with its
+     * values. It replaces #jacobian, when the candidate is accepted.
+     * #jacobian itself must stay untouched until then, because iterative
+     * linear solvers keep referring to it.
+     */
+    Eigen::SparseMatrix<double> candidate_jacobian;
+
+    /** The positions of the coefficients of #candidate_jacobian.
+     */
+    Aux::Slotmap candidate_jacobian_slots;
+
     /** Tolerance under which equality is accepted.
      */
     double tolerance;
@@ -125,12 +246,43 @@ namespace Solver {
      */
     int maximal_iterations;
 
+    /** Whether to keep the pivot sequence between factorizations.
+     */
+    bool reuse_pivots;
+
+    /** Whether to solve for the Newton steps with #solve_jacobian_free.
+     */
+    bool jacobian_free;
+
+    /** Whether to apply Broyden updates in simplified Newton iterations.
+     */
+    bool broyden_updates;
+
+    /** Is true, if #linearsolver holds a factorization of #jacobian with its
+     * current sparsity pattern, though maybe with older values.
+     */
+    bool has_factorization{false};
+
     /** technical constant of the solve algorithm.
      */
     constexpr static double const decrease_value{1e-3};
     /** The minimal stepsize of a Newton step.
      */
     constexpr static double const minimal_stepsize{1e-12};
+    /** The dimension of the Krylov space after which GMRES restarts.
+     */
+    constexpr static int const krylov_dimension{30};
+    /** The number of GMRES restarts after which the current iterate is
+     * accepted as Newton step.
+     */
+    constexpr static int const maximal_krylov_restarts{10};
+    /** GMRES stops, when the residual has decreased by this factor.
+     */
+    constexpr static double const krylov_tolerance{1e-10};
+    /** The number of Broyden updates after which they are discarded, which
+     * bounds their memory and the cost of applying them.
+     */
+    constexpr static size_t const maximal_broyden_updates{20};
   };
 
 } // namespace Solver
@@ -28,7 +28,15 @@ namespace Optimization {
 
   ControlStateCache::ControlStateCache(
       std::unique_ptr<Model::Timeevolver> _evolver) :
-      evolver(std::move(_evolver)) {}
+      evolver(std::move(_evolver)) {
+    // The optimization needs the states on the time points of the controls,
+    // interpolated states would give wrong gradients.
+    if (evolver->uses_adaptive_timesteps()) {
+      gthrow(
+          {"Adaptive time steps can't be used for optimization, remove "
+           "\"use_adaptive_timesteps\" from the simulation settings."});
+    }
+  }
 
   bool ControlStateCache::refresh_cache(
       Model::Controlcomponent &problem,
@@ -6,6 +6,7 @@
 #include <gtest/gtest-death-test.h>
 #include <gtest/gtest.h>
 #include <nlohmann/json.hpp>
+#include <stdexcept>
 
 using namespace Aux;
 
@@ -182,3 +183,321 @@ TEST(Coeffrefhandler_transposed, add_to_coefficient) {
 
   EXPECT_EQ(compare_mat, compare_mat_transposed);
 }
+
+TEST(Slothandler, add_to_coefficient_repeatedly) {
+
+  Eigen::SparseMatrix<double> mat(5, 5);
+
+  // prepare layout:
+  Triplethandler triplethandler(mat);
+  for (Eigen::Index col = 0; col != mat.cols(); ++col) {
+    for (Eigen::Index row = 0; row != mat.rows(); ++row) {
+      triplethandler.add_to_coefficient(row, col, 0.0);
+    }
+  }
+  triplethandler.set_matrix();
+
+  Slotmap slotmap;
+  for (int pass = 0; pass != 3; ++pass) {
+    Eigen::MatrixXd expected_mat(5, 5);
+    Slothandler slothandler(mat, slotmap);
+    double value = 1.0 + pass;
+    // rows in reverse order, to make the order of calls differ from the
+    // storage order:
+    for (Eigen::Index col = 0; col != mat.cols(); ++col) {
+      for (Eigen::Index row = mat.rows() - 1; row != -1; --row) {
+        slothandler.add_to_coefficient(row, col, value);
+        expected_mat(row, col) = value;
+        ++value;
+      }
+    }
+    slothandler.set_matrix();
+    Eigen::MatrixXd dense = mat;
+    EXPECT_EQ(expected_mat, dense);
+  }
+}
+
+TEST(Slothandler, changed_order_and_pattern) {
+
+  Eigen::SparseMatrix<double> mat(3, 3);
+  {
+    Triplethandler triplethandler(mat);
+    triplethandler.add_to_coefficient(0, 0, 0.0);
+    triplethandler.add_to_coefficient(1, 1, 0.0);
+    triplethandler.add_to_coefficient(2, 2, 0.0);
+    triplethandler.set_matrix();
+  }
+
+  Slotmap slotmap;
+  {
+    Slothandler slothandler(mat, slotmap);
+    slothandler.add_to_coefficient(0, 0, 1.0);
+    slothandler.add_to_coefficient(1, 1, 2.0);
+    slothandler.add_to_coefficient(2, 2, 3.0);
+  }
+  {
+    // other order and an entry, that is not yet in the pattern:
+    Slothandler slothandler(mat, slotmap);
+    slothandler.add_to_coefficient(2, 2, 4.0);
+    slothandler.add_to_coefficient(0, 0, 5.0);
+    slothandler.add_to_coefficient(0, 2, 6.0);
+    slothandler.add_to_coefficient(1, 1, 7.0);
+    slothandler.add_to_coefficient(0, 0, 1.0);
+  }
+  Eigen::MatrixXd expected_mat{
+      {6.0, 0.0, 6.0}, {0.0, 7.0, 0.0}, {0.0, 0.0, 4.0}};
+  Eigen::MatrixXd dense = mat;
+  EXPECT_EQ(expected_mat, dense);
+  EXPECT_EQ(mat.nonZeros(), 4);
+
+  {
+    Slothandler slothandler(mat, slotmap);
+    slothandler.add_to_coefficient(0, 2, 1.0);
+    slothandler.add_to_coefficient(1, 1, 2.0);
+  }
+  Eigen::MatrixXd expected_mat2{
+      {0.0, 0.0, 1.0}, {0.0, 2.0, 0.0}, {0.0, 0.0, 0.0}};
+  Eigen::MatrixXd dense2 = mat;
+  EXPECT_EQ(expected_mat2, dense2);
+}
+
+TEST(Slothandler_transposed, add_to_coefficient) {
+
+  Eigen::SparseMatrix<double> mat(5, 5);
+  Eigen::SparseMatrix<double> mat_transposed(5, 5);
+
+  {
+    Triplethandler handler(mat);
+    Triplethandler<Transposed> transposedhandler(mat_transposed);
+    for (Eigen::Index col = 0; col != mat.cols(); ++col) {
+      for (Eigen::Index row = 0; row != mat.rows(); ++row) {
+        handler.add_to_coefficient(row, col, 0.0);
+        transposedhandler.add_to_coefficient(row, col, 0.0);
+      }
+    }
+    handler.set_matrix();
+    transposedhandler.set_matrix();
+  }
+
+  Slotmap slotmap;
+  Slotmap transposed_slotmap;
+  for (int pass = 0; pass != 2; ++pass) {
+    Slothandler slothandler(mat, slotmap);
+    Slothandler<Transposed> transposedslothandler(
+        mat_transposed, transposed_slotmap);
+    double value = 1.0 + pass;
+    for (Eigen::Index col = 0; col != mat.cols(); ++col) {
+      for (Eigen::Index row = 0; row != mat.rows(); ++row) {
+        slothandler.add_to_coefficient(row, col, value);
+        transposedslothandler.add_to_coefficient(row, col, value);
+        ++value;
+      }
+    }
+  }
+
+  Eigen::MatrixXd compare_mat = mat.transpose();
+  Eigen::MatrixXd compare_mat_transposed = mat_transposed;
+
+  EXPECT_EQ(compare_mat, compare_mat_transposed);
+}
+
+TEST(Slothandler, constant_coefficients_are_kept) {
+
+  Eigen::SparseMatrix<double> mat(3, 3);
+  {
+    Triplethandler triplethandler(mat);
+    triplethandler.add_to_coefficient(0, 0, 0.0);
+    triplethandler.add_to_coefficient(1, 1, 0.0);
+    triplethandler.add_to_coefficient(2, 1, 0.0);
+    triplethandler.set_matrix();
+  }
+
+  Slotmap slotmap;
+  for (int pass = 0; pass != 3; ++pass) {
+    double value = 1.0 + pass;
+    {
+      Slothandler slothandler(mat, slotmap);
+      // Only the first fill has to add the constant coefficients:
+      EXPECT_EQ(slothandler.constants_recorded(), pass != 0);
+      slothandler.add_constant_to_coefficient(1, 1, 10.0);
+      slothandler.add_to_coefficient(0, 0, value);
+      slothandler.add_to_coefficient(1, 1, value);
+      slothandler.add_constant_to_coefficient(2, 1, -5.0);
+      // constant coefficients are no calls:
+      EXPECT_EQ(slothandler.get_number_of_calls(), 2);
+    }
+    Eigen::MatrixXd expected_mat{
+        {value, 0.0, 0.0}, {0.0, 10.0 + value, 0.0}, {0.0, -5.0, 0.0}};
+    Eigen::MatrixXd dense = mat;
+    EXPECT_EQ(expected_mat, dense);
+  }
+
+  // Later fills skip the constant coefficients:
+  {
+    Slothandler slothandler(mat, slotmap);
+    slothandler.add_constant_to_coefficient(2, 1, 100.0);
+  }
+  Eigen::MatrixXd expected_mat{
+      {0.0, 0.0, 0.0}, {0.0, 10.0, 0.0}, {0.0, -5.0, 0.0}};
+  Eigen::MatrixXd dense = mat;
+  EXPECT_EQ(expected_mat, dense);
+
+  // After clearing they are recorded anew, also at new positions:
+  slotmap.clear();
+  {
+    Slothandler slothandler(mat, slotmap);
+    EXPECT_FALSE(slothandler.constants_recorded());
+    slothandler.add_constant_to_coefficient(0, 2, 3.0);
+  }
+  {
+    Slothandler slothandler(mat, slotmap);
+    slothandler.add_to_coefficient(0, 0, 1.0);
+  }
+  Eigen::MatrixXd expected_mat2{
+      {1.0, 0.0, 3.0}, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}};
+  Eigen::MatrixXd dense2 = mat;
+  EXPECT_EQ(expected_mat2, dense2);
+}
+
+TEST(Slothandler_transposed, constant_coefficients_are_kept) {
+
+  Eigen::SparseMatrix<double> mat(2, 2);
+  {
+    Triplethandler triplethandler(mat);
+    triplethandler.add_to_coefficient(0, 0, 0.0);
+    triplethandler.add_to_coefficient(0, 1, 0.0);
+    triplethandler.set_matrix();
+  }
+
+  Slotmap slotmap;
+  for (int pass = 0; pass != 2; ++pass) {
+    {
+      Slothandler<Transposed> slothandler(mat, slotmap);
+      slothandler.add_constant_to_coefficient(1, 0, 2.0);
+      slothandler.add_to_coefficient(0, 0, 1.0);
+    }
+    Eigen::MatrixXd expected_mat{{1.0, 2.0}, {0.0, 0.0}};
+    Eigen::MatrixXd dense = mat;
+    EXPECT_EQ(expected_mat, dense);
+  }
+}
+
+TEST(Slotrangehandler, add_to_coefficient) {
+
+  Eigen::SparseMatrix<double> mat(3, 3);
+  {
+    Triplethandler triplethandler(mat);
+    triplethandler.add_to_coefficient(0, 0, 0.0);
+    triplethandler.add_to_coefficient(1, 1, 0.0);
+    triplethandler.add_to_coefficient(2, 2, 0.0);
+    triplethandler.add_to_coefficient(2, 0, 0.0);
+    triplethandler.set_matrix();
+  }
+
+  Slotmap slotmap;
+  {
+    Slothandler slothandler(mat, slotmap);
+    slothandler.add_to_coefficient(0, 0, 1.0);
+    slothandler.add_to_coefficient(1, 1, 1.0);
+    slothandler.add_to_coefficient(2, 2, 1.0);
+    slothandler.add_to_coefficient(2, 0, 1.0);
+    EXPECT_EQ(slothandler.get_number_of_calls(), 4);
+    EXPECT_TRUE(slothandler.remembers_calls(0, 4));
+    EXPECT_FALSE(slothandler.remembers_calls(0, 5));
+    EXPECT_EQ(slothandler.remembered_row(3), 2);
+  }
+
+  Slothandler slothandler(mat, slotmap);
+  slothandler.add_to_coefficient(0, 0, 1.0);
+  auto first_range = slothandler.make_range_handler(1, 2);
+  auto second_range = slothandler.make_range_handler(2, 4);
+  first_range.add_to_coefficient(1, 1, 2.0);
+  second_range.add_to_coefficient(2, 2, 3.0);
+  // not the remembered coefficient:
+  second_range.add_to_coefficient(0, 2, 4.0);
+  slothandler.skip_calls(3);
+  EXPECT_EQ(slothandler.get_number_of_calls(), 4);
+  EXPECT_TRUE(first_range.get_missed_coefficients().empty());
+  ASSERT_EQ(second_range.get_missed_coefficients().size(), 1);
+
+  slothandler.add_missed_coefficients(second_range.get_missed_coefficients());
+  EXPECT_FALSE(slothandler.remembers_calls(0, 4));
+
+  Eigen::MatrixXd expected_mat{
+      {1.0, 0.0, 4.0}, {0.0, 2.0, 0.0}, {0.0, 0.0, 3.0}};
+  Eigen::MatrixXd dense = mat;
+  EXPECT_EQ(expected_mat, dense);
+}
+
+TEST(Slotrangehandler, constant_coefficients) {
+
+  Eigen::SparseMatrix<double> mat(2, 2);
+  {
+    Triplethandler triplethandler(mat);
+    triplethandler.add_to_coefficient(0, 0, 0.0);
+    triplethandler.add_to_coefficient(1, 1, 0.0);
+    triplethandler.set_matrix();
+  }
+
+  Slotmap slotmap;
+  // An aborted fill remembers the calls, but not the constant coefficients:
+  try {
+    Slothandler slothandler(mat, slotmap);
+    slothandler.add_to_coefficient(0, 0, 0.0);
+    throw std::runtime_error("aborted fill");
+  } catch (std::runtime_error &) {
+  }
+  for (int pass = 0; pass != 2; ++pass) {
+    Slothandler slothandler(mat, slotmap);
+    auto range = slothandler.make_range_handler(0, 1);
+    EXPECT_EQ(range.constants_recorded(), pass != 0);
+    range.add_to_coefficient(0, 0, 1.0);
+    range.add_constant_to_coefficient(1, 1, 2.0);
+    slothandler.skip_calls(1);
+    if (pass == 0) {
+      // The first fill with range handlers hands the constants over:
+      ASSERT_EQ(range.get_missed_constant_coefficients().size(), 1);
+      for (auto const &coefficient : range.get_missed_constant_coefficients()) {
+        slothandler.add_constant_to_coefficient(
+            coefficient.row(), coefficient.col(), coefficient.value());
+      }
+    } else {
+      EXPECT_TRUE(range.get_missed_constant_coefficients().empty());
+    }
+    EXPECT_TRUE(range.get_missed_coefficients().empty());
+    Eigen::MatrixXd expected_mat{{1.0, 0.0}, {0.0, 2.0}};
+    Eigen::MatrixXd dense = mat;
+    EXPECT_EQ(expected_mat, dense);
+  }
+}
+
+TEST(Slotrangehandler_transposed, add_to_coefficient) {
+
+  Eigen::SparseMatrix<double> mat(2, 2);
+  {
+    Triplethandler triplethandler(mat);
+    triplethandler.add_to_coefficient(0, 1, 0.0);
+    triplethandler.add_to_coefficient(1, 1, 0.0);
+    triplethandler.set_matrix();
+  }
+
+  Slotmap slotmap;
+  {
+    Slothandler<Transposed> slothandler(mat, slotmap);
+    slothandler.add_to_coefficient(1, 0, 0.0);
+    slothandler.add_to_coefficient(1, 1, 0.0);
+    // rows of the matrix, not of the transposed calls:
+    EXPECT_EQ(slothandler.remembered_row(0), 0);
+    EXPECT_EQ(slothandler.remembered_row(1), 1);
+  }
+
+  Slothandler<Transposed> slothandler(mat, slotmap);
+  auto rangehandler = slothandler.make_range_handler(0, 2);
+  rangehandler.add_to_coefficient(1, 0, 5.0);
+  rangehandler.add_to_coefficient(1, 1, 6.0);
+  EXPECT_TRUE(rangehandler.get_missed_coefficients().empty());
+
+  Eigen::MatrixXd expected_mat{{0.0, 5.0}, {0.0, 6.0}};
+  Eigen::MatrixXd dense = mat;
+  EXPECT_EQ(expected_mat, dense);
+}
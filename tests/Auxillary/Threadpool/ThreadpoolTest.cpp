@@ -0,0 +1,53 @@
+#include "Threadpool.hpp"
+
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+TEST(Threadpool, runs_every_index_once) {
+  for (int number_of_threads : {1, 2, 5}) {
+    Aux::Threadpool pool(number_of_threads);
+    EXPECT_EQ(pool.get_number_of_threads(), number_of_threads);
+    std::vector<int> calls(static_cast<size_t>(number_of_threads), 0);
+    for (int repetition = 0; repetition != 100; ++repetition) {
+      pool.run([&](int index) { ++calls[static_cast<size_t>(index)]; });
+    }
+    for (auto number_of_calls : calls) {
+      EXPECT_EQ(number_of_calls, 100);
+    }
+  }
+}
+
+TEST(Threadpool, rethrows_exceptions) {
+  Aux::Threadpool pool(3);
+  try {
+    pool.run([](int index) {
+      if (index == 2) {
+        throw std::runtime_error("failure in thread 2");
+      }
+    });
+    FAIL() << "Test FAILED: The statement ABOVE\n"
+           << __FILE__ << ":" << __LINE__ << "\nshould have thrown!";
+  } catch (std::exception &e) {
+    EXPECT_THAT(e.what(), testing::HasSubstr("failure in thread 2"));
+  }
+  // The pool is still usable afterwards:
+  int calls = 0;
+  pool.run([&](int index) {
+    if (index == 0) {
+      ++calls;
+    }
+  });
+  EXPECT_EQ(calls, 1);
+}
+
+TEST(Threadpool, needs_a_thread) {
+  try {
+    Aux::Threadpool pool(0);
+    FAIL() << "Test FAILED: The statement ABOVE\n"
+           << __FILE__ << ":" << __LINE__ << "\nshould have thrown!";
+  } catch (std::exception &e) {
+    EXPECT_THAT(e.what(), testing::HasSubstr("at least one thread"));
+  }
+}
@@ -0,0 +1,59 @@
+#include "Balancelaw.hpp"
+#include <gtest/gtest.h>
+
+/// The shallow water equations, whose derivatives are only given by the
+/// templates of Dualbalancelaw.
+class Shallowwater :
+    public Model::Balancelaw::Dualbalancelaw<Shallowwater, 2> {
+public:
+  static constexpr double g{9.81};
+  static constexpr double slope{0.1};
+
+  template <typename Scalar>
+  Eigen::Vector<Scalar, 2>
+  evaluate_flux(Eigen::Vector<Scalar, 2> const &state) const {
+    Eigen::Vector<Scalar, 2> flux;
+    flux[0] = state[1];
+    flux[1] = state[1] * state[1] / state[0] + 0.5 * g * state[0] * state[0];
+    return flux;
+  }
+
+  template <typename Scalar>
+  Eigen::Vector<Scalar, 2>
+  evaluate_source(Eigen::Vector<Scalar, 2> const &state) const {
+    Eigen::Vector<Scalar, 2> source;
+    source[0] = Scalar(0.0);
+    source[1] = -g * slope * state[0];
+    return source;
+  }
+};
+
+TEST(Dualbalancelaw, derivatives_of_the_templates) {
+  Shallowwater law;
+  Eigen::Vector2d state(2.0, 3.0);
+  double h = state[0];
+  double q = state[1];
+
+  Eigen::Vector2d expected_flux(q, q * q / h + 0.5 * Shallowwater::g * h * h);
+  Eigen::Matrix2d expected_dflux;
+  expected_dflux << 0, 1, -q * q / (h * h) + Shallowwater::g * h, 2 * q / h;
+  Eigen::Vector2d expected_source(
+      0, -Shallowwater::g * Shallowwater::slope * h);
+  Eigen::Matrix2d expected_dsource;
+  expected_dsource << 0, 0, -Shallowwater::g * Shallowwater::slope, 0;
+
+  EXPECT_EQ(law.flux(state), expected_flux);
+  EXPECT_EQ(law.dflux_dstate(state), expected_dflux);
+  EXPECT_EQ(law.source(state), expected_source);
+  EXPECT_EQ(law.dsource_dstate(state), expected_dsource);
+
+  Eigen::Vector2d flux;
+  Eigen::Matrix2d dflux;
+  Eigen::Vector2d source;
+  Eigen::Matrix2d dsource;
+  law.flux_and_source_with_derivatives(state, flux, dflux, source, dsource);
+  EXPECT_EQ(flux, expected_flux);
+  EXPECT_EQ(dflux, expected_dflux);
+  EXPECT_EQ(source, expected_source);
+  EXPECT_EQ(dsource, expected_dsource);
+}
@@ -1,7 +1,9 @@
+#include "Frictionapproximation.hpp"
 #include "Mathfunctions.hpp"
 #include <Isothermaleulerequation.hpp>
 #include <cfloat>
 #include <gtest/gtest.h>
+#include <utility>
 
 TEST(testIsothermaleulerequation, flux) {
   double diameter = 3.5;
@@ -115,6 +117,42 @@ TEST(testIsothermaleulerequation, source) {
   // not sure, what else to test here.
 }
 
+TEST(testIsothermaleulerequation, source_with_precomputed_constants) {
+  double diameter = 0.5;
+  double roughness = 1e-3;
+  nlohmann::json j;
+  j["diameter"] = nlohmann::json::object();
+  j["diameter"]["unit"] = "m";
+  j["diameter"]["value"] = diameter;
+  j["roughness"] = nlohmann::json::object();
+  j["roughness"]["unit"] = "m";
+  j["roughness"]["value"] = roughness;
+
+  using Model::Balancelaw::Isothermaleulerequation;
+  Isothermaleulerequation Iso(j);
+  double rho = 50;
+  double Area = Aux::circle_area(0.5 * diameter);
+  double coefficient = Isothermaleulerequation::coeff_of_Reynolds(diameter);
+  // Laminar, transitional and turbulent Reynolds numbers:
+  for (double Re : {500.0, 2500.0, 3900.0, 1e5, 1e7}) {
+    for (double q : {-Re / coefficient, Re / coefficient}) {
+      double expected;
+      if (Re < 2000) {
+        expected = -Isothermaleulerequation::rho_0 / (2 * Area * diameter) * 64
+                   / coefficient * q / rho;
+      } else {
+        expected = -Isothermaleulerequation::rho_0 / (2 * Area * diameter)
+                   * Isothermaleulerequation::lambda_non_laminar(
+                       Re, diameter, roughness)
+                   * std::abs(q) * q / rho;
+      }
+      EXPECT_NEAR(
+          Iso.source(Eigen::Vector2d(rho, q))[1], expected,
+          1e-12 * std::abs(expected));
+    }
+  }
+}
+
 TEST(testIsothermaleulerequation, dsource_dstate) {
 
   double diameter = 3.5;
@@ -165,6 +203,56 @@ TEST(testIsothermaleulerequation, dsource_dstate) {
   }
 }
 
+TEST(testIsothermaleulerequation, flux_and_source_at_points) {
+
+  double diameter = 3.5;
+  double roughness = 1.0;
+  nlohmann::json j;
+  j["diameter"] = nlohmann::json::object();
+  j["diameter"]["unit"] = "m";
+  j["diameter"]["value"] = diameter;
+  j["roughness"] = nlohmann::json::object();
+  j["roughness"]["unit"] = "m";
+  j["roughness"]["value"] = roughness;
+
+  Model::Balancelaw::Isothermaleulerequation Iso(j);
+
+  // Laminar, transitional and turbulent flows in both directions:
+  Eigen::ArrayXd q(11);
+  q << -30.0, -0.2, -0.1, -0.05, -0.01, 0.0, 0.01, 0.05, 0.1, 0.2, 30.0;
+  Eigen::ArrayXd rho = Eigen::ArrayXd::LinSpaced(q.size(), 50.0, 70.0);
+
+  Model::Balancelaw::Isothermaleulerequation::Pointvalues values;
+  Model::Balancelaw::Isothermaleulerequation::Pointvalues values_only;
+  Iso.flux_and_source_with_derivatives_at_points(rho, q, values);
+  Iso.flux_and_source_at_points(rho, q, values_only);
+
+  auto expect_close = [](double expected, double actual) {
+    EXPECT_NEAR(expected, actual, 1e-12 * std::abs(expected) + 1e-300);
+  };
+  for (Eigen::Index k = 0; k != q.size(); ++k) {
+    Eigen::Vector2d state(rho[k], q[k]);
+    Eigen::Vector2d flux = Iso.flux(state);
+    Eigen::Vector2d source = Iso.source(state);
+    expect_close(flux[0], values.flux0[k]);
+    expect_close(flux[1], values.flux1[k]);
+    expect_close(source[1], values.source1[k]);
+    expect_close(flux[0], values_only.flux0[k]);
+    expect_close(flux[1], values_only.flux1[k]);
+    expect_close(source[1], values_only.source1[k]);
+    if (q[k] == 0.0) {
+      continue;
+    }
+    Eigen::Matrix2d dflux = Iso.dflux_dstate(state);
+    Eigen::Matrix2d dsource = Iso.dsource_dstate(state);
+    expect_close(dflux(0, 1), values.dflux01);
+    expect_close(dflux(1, 0), values.dflux10[k]);
+    expect_close(dflux(1, 1), values.dflux11[k]);
+    expect_close(dsource(1, 0), values.dsource10[k]);
+    expect_close(dsource(1, 1), values.dsource11[k]);
+  }
+}
+
 TEST(testIsothermaleulerequation, p_qvol_and_state) {
   double diameter = 3.5;
   double roughness = 1.0;
@@ -463,5 +551,86 @@ TEST(testIsothermaleulerequation, dSwamee_Jain_dRe) {
     EXPECT_NEAR(
         exact_dSwamee_Jain_dRe, difference_dSwamee_Jain_dRe,
         finite_difference_threshold);
+    // The derivative itself is tiny, so also compare relatively:
+    EXPECT_NEAR(
+        exact_dSwamee_Jain_dRe, difference_dSwamee_Jain_dRe,
+        1e-4 * std::abs(exact_dSwamee_Jain_dRe));
+  }
+}
+
+TEST(testIsothermaleulerequation, dSwamee_Jain_dRe_values) {
+  using Model::Balancelaw::Isothermaleulerequation;
+  // Reference values of the closed-form derivative of Swamee-Jain:
+  EXPECT_NEAR(
+      Isothermaleulerequation::dSwamee_Jain_dRe(1e5, 0.5, 1e-3),
+      -1.5847337067321174e-08, 1e-12 * 1.5847337067321174e-08);
+  EXPECT_NEAR(
+      Isothermaleulerequation::dSwamee_Jain_dRe(4000, 3.5, 1.0),
+      -1.5237478668717027e-06, 1e-12 * 1.5237478668717027e-06);
+  EXPECT_NEAR(
+      Isothermaleulerequation::dSwamee_Jain_dRe(1e6, 1.0, 0.0),
+      -1.9549577919960905e-09, 1e-12 * 1.9549577919960905e-09);
+
+  // The transitional spline joins Swamee-Jain continuously differentiable:
+  double diameter = 0.5;
+  double roughness = 1e-3;
+  double below = Isothermaleulerequation::dlambda_non_laminar_dRe(
+      4000 - 1e-6, diameter, roughness);
+  double above = Isothermaleulerequation::dlambda_non_laminar_dRe(
+      4000 + 1e-6, diameter, roughness);
+  EXPECT_NEAR(below, above, 1e-6 * std::abs(above));
+}
+
+TEST(testIsothermaleulerequation, Frictionapproximation) {
+  using Model::Balancelaw::Frictionapproximation;
+  using Model::Balancelaw::Isothermaleulerequation;
+  for (auto [diameter, roughness] :
+       {std::pair{0.5, 1e-3}, {0.9144, 8.0}, {3.5, 1.0}, {1.0, 0.0}}) {
+    Frictionapproximation approximation(diameter, roughness, 4000);
+    EXPECT_FALSE(approximation.covers(3999));
+    EXPECT_FALSE(approximation.covers(2 * Frictionapproximation::max_Reynolds));
+    Eigen::ArrayXd Re = Eigen::ArrayXd::LinSpaced(200, std::log(4001), 20)
+                            .exp();
+    Eigen::ArrayXd lambda;
+    Eigen::ArrayXd dlambda_dRe;
+    approximation.lambda_at_points(Re, lambda, &dlambda_dRe);
+    for (Eigen::Index i = 0; i != Re.size(); ++i) {
+      ASSERT_TRUE(approximation.covers(Re[i]));
+      double exact
+          = Isothermaleulerequation::Swamee_Jain(Re[i], diameter, roughness);
+      double dexact = Isothermaleulerequation::dSwamee_Jain_dRe(
+          Re[i], diameter, roughness);
+      EXPECT_NEAR(
+          approximation.lambda(Re[i]), exact,
+          Frictionapproximation::max_relative_error * exact);
+      // Relative to lambda, as the derivative vanishes for large Re:
+      EXPECT_NEAR(
+          approximation.dlambda_dRe(Re[i]), dexact, 1e-6 * exact / Re[i]);
+      EXPECT_DOUBLE_EQ(lambda[i], approximation.lambda(Re[i]));
+      EXPECT_DOUBLE_EQ(dlambda_dRe[i], approximation.dlambda_dRe(Re[i]));
+    }
+  }
+}
+
+TEST(testIsothermaleulerequation, approximated_friction) {
+  nlohmann::json j;
+  j["diameter"] = {{"unit", "m"}, {"value", 0.5}};
+  j["roughness"] = {{"unit", "m"}, {"value", 1e-3}};
+  Model::Balancelaw::Isothermaleulerequation exact(j);
+  j["balancelaw"]
+      = Model::Balancelaw::Isothermaleulerequation::approximated_friction;
+  Model::Balancelaw::Isothermaleulerequation approximated(j);
+
+  double rho = 50;
+  // Laminar, transitional, turbulent and beyond the approximated range:
+  for (double q : {1e-3, 0.015, 10.0, 300.0, -300.0, 1e7}) {
+    Eigen::Vector2d state(rho, q);
+    Eigen::Vector2d source = exact.source(state);
+    EXPECT_NEAR(
+        approximated.source(state)[1], source[1], 1e-9 * std::abs(source[1]));
+    Eigen::Matrix2d dsource = exact.dsource_dstate(state);
+    EXPECT_NEAR(
+        approximated.dsource_dstate(state)(1, 1), dsource(1, 1),
+        1e-6 * std::abs(dsource(1, 1)));
   }
 }
@@ -6,17 +6,21 @@
 #include "Innode.hpp"
 #include "InterpolatingVector.hpp"
 #include "Isothermaleulerequation.hpp"
+#include "Linearsolver.hpp"
 #include "Matrixhandler.hpp"
 #include "Netfactory.hpp"
 #include "Networkproblem.hpp"
 #include "Pipe.hpp"
+#include "PipeT.hpp"
 #include "Shortpipe.hpp"
 
 #include <gtest/gtest.h>
+#include <map>
 #include <memory>
 #include <sstream>
 
 #include <string>
+#include <utility>
 #include <vector>
 
 nlohmann::json source_json(std::string id, double flowstart, double flowend);
@@ -43,6 +47,55 @@ public:
   make_Networkproblem(nlohmann::json &netproblem) {
     return EqcomponentTEST::make_Networkproblem(netproblem, factory);
   }
+
+  struct Gasline {
+    nlohmann::json netproblem;
+    nlohmann::json initial;
+  };
+
+  /** \brief Returns the json of a network problem, in which the given edges
+   * connect Innodes node0, node1, ... in a line, and the json of its initial
+   * values.
+   *
+   * edges holds the componenttype, "Pipe" or "Shortpipe", and the id of each
+   * edge. All pipes have the same dimensions and initial values.
+   */
+  Gasline make_gasline(
+      std::vector<std::pair<std::string, std::string>> const &edges,
+      double desired_delta_x = 5000) {
+    double const length = 15250;
+    double const diameter = 0.9144;
+    double const roughness = 8;
+
+    using E2d = Eigen::Matrix<double, 2, 1>;
+    std::vector<std::pair<double, E2d>> const initialvalues
+        = {{0.0, E2d(75.046978, 58.290215)},
+           {length, E2d(74.989795, 57.553105)}};
+
+    std::vector<nlohmann::json> nodes(edges.size() + 1);
+    for (size_t i = 0; i != nodes.size(); ++i) {
+      nodes[i]["id"] = "node" + std::to_string(i);
+    }
+    std::map<std::string, std::vector<nlohmann::json>> topologies;
+    std::map<std::string, std::vector<nlohmann::json>> initials;
+    for (size_t i = 0; i != edges.size(); ++i) {
+      auto const &[type, id] = edges[i];
+      if (type == "Shortpipe") {
+        topologies[type].push_back(shortpipe_json(id, nodes[i], nodes[i + 1]));
+        initials[type].push_back(make_value_json(
+            id, "x", E2d(74.989795, 57.553105), E2d(74.9, 57.4)));
+      } else {
+        topologies[type].push_back(pipe_json(
+            id, nodes[i], nodes[i + 1], length, "m", diameter, "m", roughness,
+            "m", desired_delta_x, "Isothermaleulerequation",
+            "Implicitboxscheme"));
+        initials[type].push_back(make_value_json(id, "x", initialvalues));
+      }
+    }
+    return {
+        make_full_json({{"Innode", nodes}}, topologies),
+        make_initial_json({}, initials)};
+  }
 };
 
 TEST_F(GasTEST, Shortpipe_evaluate) {
@@ -164,6 +217,16 @@ TEST_F(GasTEST, Shortpipe_d_evaluate_d_new_state) {
   EXPECT_DOUBLE_EQ(DenseJ(2, 1), 1.0);
   EXPECT_DOUBLE_EQ(DenseJ(2, 2), 0.0);
   EXPECT_DOUBLE_EQ(DenseJ(2, 3), -1.0);
+
+  // Later fills keep the recorded constant coefficients:
+  Aux::Slotmap slotmap;
+  for (int fill = 0; fill != 2; ++fill) {
+    Aux::Slothandler slothandler(J, slotmap);
+    netprob->d_evaluate_d_new_state(
+        slothandler, last_time, new_time, last_state, new_state, control);
+    Eigen::Matrix4d DenseJ_refilled = J;
+    EXPECT_EQ(DenseJ_refilled, DenseJ);
+  }
 }
 
 TEST_F(GasTEST, Source_evaluate) {
@@ -993,6 +1056,396 @@ TEST_F(GasTEST, Pipe_evaluate) {
   EXPECT_DOUBLE_EQ(expected_result[1], rootvalues.segment<2>(1)[1]);
 }
 
+TEST_F(GasTEST, Networkproblem_threaded_evaluate) {
+
+  auto [netprop_json, net_initial]
+      = make_gasline({{"Pipe", "pipe0"}, {"Pipe", "pipe1"}});
+  auto netprob = make_Networkproblem(netprop_json);
+  netprob->init();
+  auto number_of_variables = netprob->get_number_of_states();
+
+  Eigen::VectorXd last_state(number_of_variables);
+  netprob->set_initial_values(last_state, net_initial);
+  Eigen::VectorXd new_state = 1.01 * last_state;
+  Eigen::VectorXd control;
+
+  Eigen::VectorXd serial_rootvalues(number_of_variables);
+  netprob->evaluate(
+      serial_rootvalues, 0.0, 10.0, last_state, new_state, control);
+
+  for (int number_of_threads : {2, 3, 8}) {
+    netprob->set_number_of_threads(number_of_threads);
+    Eigen::VectorXd threaded_rootvalues(number_of_variables);
+    threaded_rootvalues.setConstant(1e300);
+    netprob->evaluate(
+        threaded_rootvalues, 0.0, 10.0, last_state, new_state, control);
+    EXPECT_EQ(threaded_rootvalues, serial_rootvalues) << number_of_threads;
+  }
+}
+
+TEST_F(GasTEST, Networkproblem_threaded_derivative) {
+
+  auto [netprop_json, net_initial]
+      = make_gasline({{"Pipe", "pipe0"}, {"Pipe", "pipe1"}});
+  auto netprob = make_Networkproblem(netprop_json);
+  netprob->init();
+  auto number_of_variables = netprob->get_number_of_states();
+
+  Eigen::VectorXd last_state(number_of_variables);
+  netprob->set_initial_values(last_state, net_initial);
+  Eigen::VectorXd new_state = 1.01 * last_state;
+  Eigen::VectorXd control;
+
+  Eigen::SparseMatrix<double> serial_jacobian(
+      number_of_variables, number_of_variables);
+  {
+    Aux::Triplethandler handler(serial_jacobian);
+    netprob->d_evaluate_d_new_state(
+        handler, 0.0, 10.0, last_state, new_state, control);
+    handler.set_matrix();
+  }
+  {
+    Aux::Slotmap slotmap;
+    Aux::Slothandler handler(serial_jacobian, slotmap);
+    netprob->d_evaluate_d_new_state(
+        handler, 0.0, 10.0, last_state, new_state, control);
+  }
+  Eigen::MatrixXd serial_dense = serial_jacobian;
+
+  for (int number_of_threads : {2, 3, 8}) {
+    netprob->set_number_of_threads(number_of_threads);
+    Eigen::SparseMatrix<double> jacobian = serial_jacobian;
+    Aux::Slotmap slotmap;
+    // The first pass records the assembly plan, the others use it:
+    for (int pass = 0; pass != 3; ++pass) {
+      Aux::Slothandler handler(jacobian, slotmap);
+      netprob->d_evaluate_d_new_state(
+          handler, 0.0, 10.0, last_state, new_state, control);
+      Eigen::MatrixXd dense = jacobian;
+      EXPECT_EQ(dense, serial_dense) << number_of_threads << " " << pass;
+      EXPECT_EQ(jacobian.nonZeros(), serial_jacobian.nonZeros());
+    }
+  }
+}
+
+TEST_F(GasTEST, Networkproblem_evaluate_with_derivative) {
+
+  auto [netprop_json, net_initial]
+      = make_gasline({{"Pipe", "pipe0"}, {"Pipe", "pipe1"}});
+  auto netprob = make_Networkproblem(netprop_json);
+  netprob->init();
+  auto number_of_variables = netprob->get_number_of_states();
+
+  Eigen::VectorXd last_state(number_of_variables);
+  netprob->set_initial_values(last_state, net_initial);
+  Eigen::VectorXd new_state = 1.01 * last_state;
+  Eigen::VectorXd control;
+
+  Eigen::VectorXd expected_rootvalues(number_of_variables);
+  netprob->evaluate(
+      expected_rootvalues, 0.0, 10.0, last_state, new_state, control);
+  Eigen::SparseMatrix<double> expected_jacobian(
+      number_of_variables, number_of_variables);
+  {
+    Aux::Triplethandler handler(expected_jacobian);
+    netprob->d_evaluate_d_new_state(
+        handler, 0.0, 10.0, last_state, new_state, control);
+    handler.set_matrix();
+  }
+  Eigen::MatrixXd expected_dense = expected_jacobian;
+
+  for (int number_of_threads : {1, 3}) {
+    netprob->set_number_of_threads(number_of_threads);
+    Eigen::SparseMatrix<double> jacobian = expected_jacobian;
+    Aux::Slotmap slotmap;
+    for (int pass = 0; pass != 2; ++pass) {
+      Eigen::VectorXd rootvalues(number_of_variables);
+      Aux::Slothandler handler(jacobian, slotmap);
+      netprob->evaluate_with_derivative(
+          rootvalues, handler, 0.0, 10.0, last_state, new_state, control);
+      Eigen::MatrixXd dense = jacobian;
+      for (Eigen::Index row = 0; row != number_of_variables; ++row) {
+        EXPECT_DOUBLE_EQ(rootvalues[row], expected_rootvalues[row]);
+        for (Eigen::Index col = 0; col != number_of_variables; ++col) {
+          EXPECT_DOUBLE_EQ(dense(row, col), expected_dense(row, col));
+        }
+      }
+    }
+  }
+}
+
+TEST_F(GasTEST, Networkproblem_condensation) {
+
+  auto [netprop_json, net_initial]
+      = make_gasline({{"Pipe", "pipe0"}, {"Pipe", "pipe1"}}, 2000);
+  auto netprob = make_Networkproblem(netprop_json);
+  netprob->init();
+  auto number_of_variables = netprob->get_number_of_states();
+
+  Eigen::VectorXd last_state(number_of_variables);
+  netprob->set_initial_values(last_state, net_initial);
+  Eigen::VectorXd new_state = 1.01 * last_state;
+  Eigen::VectorXd control;
+
+  Eigen::SparseMatrix<double> jacobian(
+      number_of_variables, number_of_variables);
+  {
+    Aux::Triplethandler handler(jacobian);
+    netprob->d_evaluate_d_new_state(
+        handler, 0.0, 10.0, last_state, new_state, control);
+    handler.set_matrix();
+  }
+
+  auto ranges = netprob->get_condensable_ranges();
+  ASSERT_EQ(ranges.size(), 2);
+  for (auto const &[first, after] : ranges) {
+    // Only the boundary rows and states of each pipe stay uncondensed:
+    EXPECT_EQ((after - first) % 2, 0);
+    EXPECT_EQ(after - first, number_of_variables / 2 - 2);
+  }
+
+  Eigen::VectorXd rhs = Eigen::VectorXd::LinSpaced(
+      number_of_variables, -1.0, 1.0);
+  auto reference_solver = Solver::make_linearsolver("SparseLU");
+  reference_solver->analyze_pattern(jacobian);
+  reference_solver->factorize(jacobian);
+  Eigen::VectorXd reference = reference_solver->solve(rhs);
+
+  for (int number_of_threads : {1, 2}) {
+    auto solver = Solver::make_linearsolver("Condensation");
+    solver->set_number_of_threads(number_of_threads);
+    solver->set_condensable_ranges(ranges);
+    solver->analyze_pattern(jacobian);
+    solver->factorize(jacobian);
+    ASSERT_EQ(solver->info(), Eigen::Success);
+    Eigen::VectorXd solution = solver->solve(rhs);
+    EXPECT_LT((solution - reference).norm(), 1e-10 * reference.norm());
+  }
+}
+
+TEST_F(GasTEST, Networkproblem_block_jacobi) {
+
+  auto [netprop_json, net_initial]
+      = make_gasline({{"Pipe", "pipe0"}, {"Pipe", "pipe1"}}, 2000);
+  auto netprob = make_Networkproblem(netprop_json);
+  netprob->init();
+  auto number_of_variables = netprob->get_number_of_states();
+
+  Eigen::VectorXd last_state(number_of_variables);
+  netprob->set_initial_values(last_state, net_initial);
+  Eigen::VectorXd new_state = 1.01 * last_state;
+  Eigen::VectorXd control;
+
+  Eigen::SparseMatrix<double> jacobian(
+      number_of_variables, number_of_variables);
+  {
+    Aux::Triplethandler handler(jacobian);
+    netprob->d_evaluate_d_new_state(
+        handler, 0.0, 10.0, last_state, new_state, control);
+    handler.set_matrix();
+  }
+
+  auto ranges = netprob->get_condensable_ranges();
+  auto solver = Solver::make_linearsolver("BlockJacobi");
+  solver->set_condensable_ranges(ranges);
+  solver->analyze_pattern(jacobian);
+  solver->factorize(jacobian);
+  Eigen::VectorXd rhs
+      = Eigen::VectorXd::LinSpaced(number_of_variables, -1.0, 1.0);
+  Eigen::VectorXd solution = solver->solve(rhs);
+
+  // The block of every pipe is inverted exactly:
+  Eigen::MatrixXd dense = jacobian;
+  for (auto const &[first, after] : ranges) {
+    auto const size = after - first;
+    Eigen::VectorXd block_residual
+        = dense.block(first, first, size, size) * solution.segment(first, size)
+          - rhs.segment(first, size);
+    EXPECT_LT(block_residual.norm(), 1e-10 * rhs.norm());
+  }
+}
+
+TEST_F(GasTEST, Networkproblem_domain_decomposition) {
+
+  auto [netprop_json, net_initial] = make_gasline(
+      {{"Pipe", "pipe0"}, {"Pipe", "pipe1"}, {"Pipe", "pipe2"},
+       {"Pipe", "pipe3"}});
+
+  auto netprob = make_Networkproblem(netprop_json);
+  netprob->init();
+  auto number_of_variables = netprob->get_number_of_states();
+
+  Eigen::VectorXd last_state(number_of_variables);
+  netprob->set_initial_values(last_state, net_initial);
+  Eigen::VectorXd new_state = 1.01 * last_state;
+  Eigen::VectorXd control;
+
+  Eigen::SparseMatrix<double> jacobian(
+      number_of_variables, number_of_variables);
+  {
+    Aux::Triplethandler handler(jacobian);
+    netprob->d_evaluate_d_new_state(
+        handler, 0.0, 10.0, last_state, new_state, control);
+    handler.set_matrix();
+  }
+
+  Eigen::VectorXd rhs
+      = Eigen::VectorXd::LinSpaced(number_of_variables, -1.0, 1.0);
+  auto reference_solver = Solver::make_linearsolver("SparseLU");
+  reference_solver->analyze_pattern(jacobian);
+  reference_solver->factorize(jacobian);
+  Eigen::VectorXd reference = reference_solver->solve(rhs);
+
+  for (int number_of_threads : {1, 2, 3}) {
+    auto subdomains = netprob->get_subdomains(number_of_threads);
+    ASSERT_EQ(subdomains.size(), static_cast<size_t>(number_of_threads));
+    // Every state lies in exactly one subdomain:
+    std::vector<int> counts(static_cast<size_t>(number_of_variables), 0);
+    for (auto const &subdomain : subdomains) {
+      EXPECT_FALSE(subdomain.empty());
+      for (auto const &[first, after] : subdomain) {
+        for (auto index = first; index != after; ++index) {
+          ++counts[static_cast<size_t>(index)];
+        }
+      }
+    }
+    for (auto count : counts) {
+      EXPECT_EQ(count, 1);
+    }
+
+    auto solver = Solver::make_linearsolver("DomainDecomposition");
+    solver->set_number_of_threads(number_of_threads);
+    ASSERT_EQ(solver->get_number_of_subdomains(), number_of_threads);
+    solver->set_subdomains(subdomains);
+    solver->analyze_pattern(jacobian);
+    solver->factorize(jacobian);
+    ASSERT_EQ(solver->info(), Eigen::Success);
+    Eigen::VectorXd solution = solver->solve(rhs);
+    EXPECT_LT((solution - reference).norm(), 1e-10 * reference.norm())
+        << number_of_threads;
+  }
+}
+
+TEST_F(GasTEST, Networkproblem_order_states_by_topology) {
+
+  // Along the network the pipes follow each other as a, c, b, d, so the
+  // order of the ids is not the order of the network:
+  std::vector<std::string> const chain_ids
+      = {"pipe_a", "pipe_c", "pipe_b", "pipe_d"};
+  std::vector<std::pair<std::string, std::string>> edges;
+  for (auto const &id : chain_ids) {
+    edges.emplace_back("Pipe", id);
+  }
+  auto [netprop_json, net_initial] = make_gasline(edges);
+
+  auto component_ordered = make_Networkproblem(netprop_json);
+  component_ordered->init();
+  auto topology_ordered = make_Networkproblem(netprop_json);
+  topology_ordered->order_states_by_topology();
+  topology_ordered->init();
+
+  auto pipe_of = [](Model::Networkproblem &netprob, std::string const &id) {
+    auto pipe = dynamic_cast<Model::Gas::Pipe *>(
+        netprob.get_network().get_edge_by_id(id));
+    EXPECT_NE(pipe, nullptr);
+    return pipe;
+  };
+
+  // Neighbouring pipes get neighbouring states:
+  std::vector<Model::Gas::Pipe *> chain;
+  for (auto const &id : chain_ids) {
+    chain.push_back(pipe_of(*topology_ordered, id));
+  }
+  bool const forward = chain.front()->get_state_startindex()
+                       < chain.back()->get_state_startindex();
+  for (size_t i = 0; i + 1 != chain.size(); ++i) {
+    auto *first = forward ? chain[i] : chain[i + 1];
+    auto *second = forward ? chain[i + 1] : chain[i];
+    EXPECT_EQ(first->get_state_afterindex(), second->get_state_startindex());
+  }
+
+  // Both orders describe the same equations:
+  auto number_of_variables = component_ordered->get_number_of_states();
+  ASSERT_EQ(topology_ordered->get_number_of_states(), number_of_variables);
+  Eigen::VectorXd control;
+  std::vector<Eigen::VectorXd> residuals;
+  for (auto *netprob : {component_ordered.get(), topology_ordered.get()}) {
+    Eigen::VectorXd last_state(number_of_variables);
+    netprob->set_initial_values(last_state, net_initial);
+    Eigen::VectorXd new_state = 1.01 * last_state;
+    Eigen::VectorXd rootvalues(number_of_variables);
+    netprob->evaluate(rootvalues, 0.0, 10.0, last_state, new_state, control);
+    residuals.push_back(rootvalues);
+  }
+  for (auto const &id : chain_ids) {
+    auto *component_pipe = pipe_of(*component_ordered, id);
+    auto *topology_pipe = pipe_of(*topology_ordered, id);
+    auto const size = component_pipe->get_number_of_states();
+    for (Eigen::Index i = 0; i != size; ++i) {
+      EXPECT_DOUBLE_EQ(
+          residuals[0][component_pipe->get_state_startindex() + i],
+          residuals[1][topology_pipe->get_state_startindex() + i]);
+    }
+  }
+}
+
+TEST_F(GasTEST, Networkproblem_grouped_by_type) {
+
+  auto [netprop_json, net_initial] = make_gasline(
+      {{"Pipe", "pipe0"}, {"Shortpipe", "shortpipe"}, {"Pipe", "pipe1"}});
+
+  auto netprob = make_Networkproblem(netprop_json);
+  netprob->init();
+  auto number_of_variables = netprob->get_number_of_states();
+
+  Eigen::VectorXd last_state(number_of_variables);
+  netprob->set_initial_values(last_state, net_initial);
+  Eigen::VectorXd new_state = 1.01 * last_state;
+  Eigen::VectorXd control;
+
+  // Evaluate the components of all three types one by one:
+  std::vector<Model::Equationcomponent *> components;
+  auto const &network = netprob->get_network();
+  for (auto const *edge : network.get_edges()) {
+    components.push_back(dynamic_cast<Model::Equationcomponent *>(
+        const_cast<Network::Edge *>(edge)));
+  }
+  for (auto const *node : network.get_nodes()) {
+    components.push_back(dynamic_cast<Model::Equationcomponent *>(
+        const_cast<Network::Node *>(node)));
+  }
+  Eigen::VectorXd expected_rootvalues(number_of_variables);
+  Eigen::SparseMatrix<double> expected_jacobian(
+      number_of_variables, number_of_variables);
+  {
+    Aux::Triplethandler handler(expected_jacobian);
+    for (auto *component : components) {
+      ASSERT_NE(component, nullptr);
+      component->evaluate(
+          expected_rootvalues, 0.0, 10.0, last_state, new_state);
+      component->d_evaluate_d_new_state(
+          handler, 0.0, 10.0, last_state, new_state);
+    }
+    handler.set_matrix();
+  }
+
+  Eigen::VectorXd rootvalues(number_of_variables);
+  netprob->evaluate(rootvalues, 0.0, 10.0, last_state, new_state, control);
+  EXPECT_EQ(rootvalues, expected_rootvalues);
+
+  Eigen::SparseMatrix<double> jacobian(
+      number_of_variables, number_of_variables);
+  {
+    Aux::Triplethandler handler(jacobian);
+    netprob->d_evaluate_d_new_state(
+        handler, 0.0, 10.0, last_state, new_state, control);
+    handler.set_matrix();
+  }
+  Eigen::MatrixXd dense = jacobian;
+  Eigen::MatrixXd expected_dense = expected_jacobian;
+  EXPECT_EQ(dense, expected_dense);
+}
+
 TEST_F(GasTEST, Pipe_set_initial_conditions) {
 
   nlohmann::json node0;
@@ -1055,6 +1508,31 @@ TEST_F(GasTEST, Pipe_set_initial_conditions) {
   }
 }
 
+TEST_F(GasTEST, Pipe_make_instance) {
+  nlohmann::json node0;
+  nlohmann::json node1;
+  node0["id"] = "node0";
+  node1["id"] = "node1";
+
+  nlohmann::json pipe_topology = pipe_json(
+      "pipe", node0, node1, 15250, "m", 0.9144, "m", 8, "m", 20000,
+      "Isothermaleulerequation", "Implicitboxscheme");
+
+  auto netprop_json = make_full_json(
+      {{"Innode", {node0, node1}}}, {{"Pipe", {pipe_topology}}});
+  auto netprob = make_Networkproblem(netprop_json);
+  auto edges = netprob->get_network().get_edges();
+  using Boxpipe = Model::Gas::PipeT<
+      Model::Scheme::Implicitboxscheme<2>,
+      Model::Balancelaw::Isothermaleulerequation>;
+  EXPECT_NE(dynamic_cast<Boxpipe const *>(edges.front()), nullptr);
+
+  pipe_topology["scheme"] = "Unknownscheme";
+  auto unknown_json = make_full_json(
+      {{"Innode", {node0, node1}}}, {{"Pipe", {pipe_topology}}});
+  EXPECT_ANY_THROW(make_Networkproblem(unknown_json));
+}
+
 TEST_F(GasTEST, Pipe_d_evaluate_d_new_state) {
   nlohmann::json node0;
   nlohmann::json node1;
@@ -1227,6 +1705,18 @@ TEST_F(GasTEST, Pipe_d_evaluate_d_last_state) {
   EXPECT_DOUBLE_EQ(DenseJ(2, 1), dleft(1, 1));
   EXPECT_DOUBLE_EQ(DenseJ(2, 2), dright(1, 0));
   EXPECT_DOUBLE_EQ(DenseJ(2, 3), dright(1, 1));
+
+  // The derivatives are constant, so later fills keep the recorded ones:
+  Aux::Slotmap slotmap;
+  for (int fill = 0; fill != 2; ++fill) {
+    Aux::Slothandler slothandler(J, slotmap);
+    EXPECT_EQ(slothandler.constants_recorded(), fill != 0);
+    netprob->d_evaluate_d_last_state(
+        slothandler, last_time, new_time, last_state, new_state, control);
+    last_state.setRandom();
+    Eigen::Matrix4d DenseJ_refilled = J;
+    EXPECT_EQ(DenseJ_refilled, DenseJ);
+  }
 }
 
 nlohmann::json source_json(std::string id, double flowstart, double flowend) {
@@ -1,6 +1,7 @@
 #include "Equationcomponent_test_helpers.hpp"
 #include "powertest_helpers.hpp"
 
+#include "Admittancematrix.hpp"
 #include "Matrixhandler.hpp"
 #include "Netfactory.hpp"
 #include "Networkproblem.hpp"
@@ -364,6 +365,96 @@ TEST_F(PowerTEST, d_evaluate_d_new_state_PV) {
   }
 }
 
+TEST_F(PowerTEST, evaluate_with_derivative) {
+
+  auto [netprob, last_time, new_time, last_state, new_state, rootvalues]
+      = default_setup();
+
+  // The following are not needed, as the power nodes are not controlled.  But
+  // to satisfy the interface, we must provide them.
+  Eigen::VectorXd control;
+
+  Eigen::VectorXd expected_rootvalues = rootvalues;
+  netprob->evaluate(
+      expected_rootvalues, last_time, new_time, last_state, new_state,
+      control);
+  Eigen::SparseMatrix<double> expected_J(new_state.size(), new_state.size());
+  {
+    Aux::Triplethandler handler(expected_J);
+    netprob->d_evaluate_d_new_state(
+        handler, last_time, new_time, last_state, new_state, control);
+    handler.set_matrix();
+  }
+  Eigen::Matrix<double, 6, 6> expected_DenseJ = expected_J;
+
+  for (int number_of_threads : {1, 3}) {
+    netprob->set_number_of_threads(number_of_threads);
+    Eigen::SparseMatrix<double> J = expected_J;
+    Aux::Slotmap slotmap;
+    for (int pass = 0; pass != 2; ++pass) {
+      Aux::Slothandler handler(J, slotmap);
+      netprob->evaluate_with_derivative(
+          rootvalues, handler, last_time, new_time, last_state, new_state,
+          control);
+      Eigen::Matrix<double, 6, 6> DenseJ = J;
+      for (int row = 0; row != 6; ++row) {
+        EXPECT_DOUBLE_EQ(rootvalues[row], expected_rootvalues[row]);
+        for (int col = 0; col != 6; ++col) {
+          EXPECT_DOUBLE_EQ(DenseJ(row, col), expected_DenseJ(row, col));
+        }
+      }
+    }
+  }
+}
+
+TEST_F(PowerTEST, Admittancematrix_all_buses) {
+
+  auto [netprob, last_time, new_time, last_state, new_state, rootvalues]
+      = default_setup();
+
+  std::vector<Model::Power::Powernode const *> buses;
+  for (auto const &id : {"pv", "vphi", "pq"}) {
+    auto *node = dynamic_cast<Model::Power::Powernode *>(
+        netprob->get_network().get_node_by_id(id));
+    if (not node) {
+      FAIL();
+    }
+    buses.push_back(node);
+  }
+  Model::Power::Admittancematrix matrix(buses);
+  EXPECT_EQ(matrix.get_number_of_buses(), 3);
+
+  Model::Power::Admittancematrix::Linecache lines;
+  matrix.fill_line_cache(new_state, 0, matrix.get_number_of_buses(), lines);
+  EXPECT_EQ(lines.first_line, 0);
+  // Every transmission line appears in the rows of both of its ends.
+  EXPECT_EQ(lines.V_k.size(), 4);
+
+  Eigen::SparseMatrix<double> J(new_state.size(), new_state.size());
+  Eigen::SparseMatrix<double> expected_J(new_state.size(), new_state.size());
+  Aux::Triplethandler handler(J);
+  Aux::Triplethandler expected_handler(expected_J);
+  for (Eigen::Index bus = 0; bus != 3; ++bus) {
+    auto const *node = buses[static_cast<size_t>(bus)];
+    auto index = node->get_state_startindex();
+    EXPECT_DOUBLE_EQ(matrix.P(bus, new_state, lines), node->P(new_state));
+    EXPECT_DOUBLE_EQ(matrix.Q(bus, new_state, lines), node->Q(new_state));
+    matrix.add_P_derivative(index, handler, bus, new_state, lines);
+    matrix.add_Q_derivative(index + 1, handler, bus, new_state, lines);
+    node->evaluate_P_derivative(index, expected_handler, new_state);
+    node->evaluate_Q_derivative(index + 1, expected_handler, new_state);
+  }
+  handler.set_matrix();
+  expected_handler.set_matrix();
+  Eigen::Matrix<double, 6, 6> DenseJ = J;
+  Eigen::Matrix<double, 6, 6> expected_DenseJ = expected_J;
+  for (int row = 0; row != 6; ++row) {
+    for (int col = 0; col != 6; ++col) {
+      EXPECT_DOUBLE_EQ(DenseJ(row, col), expected_DenseJ(row, col));
+    }
+  }
+}
+
 //////////////////////////////////////////////////////
 // Here come the definitions of the fixture methods:
 /////////////////////////////////////////////////////
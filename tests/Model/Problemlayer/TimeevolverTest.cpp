@@ -0,0 +1,416 @@
+#include "Controlcomponent.hpp"
+#include "InterpolatingVector.hpp"
+#include "Matrixhandler.hpp"
+#include "Timeevolver.hpp"
+#include <cmath>
+#include <functional>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace testing;
+
+// The residual of one scalar equation and its derivative with respect to the
+// new state, both with the arguments (last_time, new_time, last_state,
+// new_state).
+using Scalarfunction = std::function<double(double, double, double, double)>;
+
+/// \brief A problem with one state, that records the time steps and the
+/// initial guesses of the Newton method.
+class Scalarproblem final : public Model::Controlcomponent {
+public:
+  Scalarproblem(Scalarfunction _residual, Scalarfunction _dresidual) :
+      residual(std::move(_residual)), dresidual(std::move(_dresidual)) {}
+
+  void evaluate(
+      Eigen::Ref<Eigen::VectorXd> rootvalues, double last_time,
+      double new_time, Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Eigen::Ref<Eigen::VectorXd const> const &) const final {
+    if (record_next_evaluation) {
+      initial_guesses.push_back(new_state[0]);
+      record_next_evaluation = false;
+    }
+    last_evaluated_state = new_state[0];
+    rootvalues[0]
+        = residual(last_time, new_time, last_state[0], new_state[0]);
+  }
+
+  void d_evaluate_d_new_state(
+      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Eigen::Ref<Eigen::VectorXd const> const &) const final {
+    jacobianhandler.add_to_coefficient(
+        0, 0, dresidual(last_time, new_time, last_state[0], new_state[0]));
+  }
+
+  void evaluate_with_derivative(
+      Eigen::Ref<Eigen::VectorXd> rootvalues,
+      Aux::Matrixhandler &jacobianhandler, double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &last_state,
+      Eigen::Ref<Eigen::VectorXd const> const &new_state,
+      Eigen::Ref<Eigen::VectorXd const> const &control) const final {
+    ++fused_evaluations;
+    evaluate(rootvalues, last_time, new_time, last_state, new_state, control);
+    d_evaluate_d_new_state(
+        jacobianhandler, last_time, new_time, last_state, new_state, control);
+  }
+
+  void prepare_timestep(
+      double last_time, double new_time,
+      Eigen::Ref<Eigen::VectorXd const> const &,
+      Eigen::Ref<Eigen::VectorXd const> const &) final {
+    steps.emplace_back(last_time, new_time);
+    record_next_evaluation = true;
+  }
+
+  /// Every attempted time step as (last_time, new_time).
+  std::vector<std::pair<double, double>> steps;
+  /// The first evaluated new_state of every attempted time step.
+  mutable std::vector<double> initial_guesses;
+  /// The last evaluated new_state, after a converged Newton method its
+  /// solution.
+  mutable double last_evaluated_state{0.0};
+  /// The number of evaluations of values and jacobian in one pass.
+  mutable int fused_evaluations{0};
+
+  MOCK_METHOD(void, setup, (), (final));
+
+  MOCK_METHOD(
+      void, d_evaluate_d_last_state,
+      ((Aux::Matrixhandler &), (double), (double),
+       (Eigen::Ref<Eigen::VectorXd const> const &),
+       (Eigen::Ref<Eigen::VectorXd const> const &),
+       (Eigen::Ref<Eigen::VectorXd const> const &)),
+      (const, final));
+
+  MOCK_METHOD(
+      void, d_evaluate_d_control,
+      ((Aux::Matrixhandler &), (double), (double),
+       (Eigen::Ref<Eigen::VectorXd const> const &),
+       (Eigen::Ref<Eigen::VectorXd const> const &),
+       (Eigen::Ref<Eigen::VectorXd const> const &)),
+      (const, final));
+
+  MOCK_METHOD(Eigen::Index, set_control_indices, (Eigen::Index), (final));
+
+  MOCK_METHOD(
+      void, set_initial_controls,
+      ((Aux::InterpolatingVector_Base &), (nlohmann::json const &)),
+      (const, final));
+
+  MOCK_METHOD(
+      void, set_lower_bounds,
+      ((Aux::InterpolatingVector_Base &), (nlohmann::json const &)),
+      (const, final));
+
+  MOCK_METHOD(
+      void, set_upper_bounds,
+      ((Aux::InterpolatingVector_Base &), (nlohmann::json const &)),
+      (const, final));
+
+  MOCK_METHOD(
+      void, save_controls_to_json,
+      ((Aux::InterpolatingVector_Base const &), (nlohmann::json &)),
+      (const, final));
+
+  std::string componentclass() const final { return "Scalarproblem"; }
+  std::string componenttype() const final { return "Scalarproblem"; }
+  std::string id() const final { return "scalar"; }
+
+private:
+  Scalarfunction residual;
+  Scalarfunction dresidual;
+  mutable bool record_next_evaluation{false};
+};
+
+/// \brief The implicit Euler discretization of x' = rate * (target(t) - x).
+Scalarproblem
+make_relaxation(double rate, std::function<double(double)> target) {
+  return Scalarproblem(
+      [rate,
+       target](double last_time, double new_time, double last, double x) {
+        return x - last
+               - (new_time - last_time) * rate * (target(new_time) - x);
+      },
+      [rate](double last_time, double new_time, double, double) {
+        return 1 + (new_time - last_time) * rate;
+      });
+}
+
+nlohmann::json adaptive_json() {
+  return R"({
+    "use_simplified_newton": false,
+    "maximal_number_of_newton_iterations": 10,
+    "tolerance": 1e-12,
+    "retries": 0,
+    "use_adaptive_timesteps": true,
+    "adaptive_tolerance": 1e-3,
+    "minimal_delta_t": 1e-6
+  })"_json;
+}
+
+Aux::InterpolatingVector simulate(
+    Model::Timeevolver &evolver, Scalarproblem &problem, double initial,
+    Eigen::VectorXd const &times) {
+  Aux::InterpolatingVector states(times, 1);
+  Aux::InterpolatingVector controls;
+  Eigen::VectorXd initial_state(1);
+  initial_state << initial;
+  evolver.simulate(initial_state, controls, problem, states);
+  return states;
+}
+
+/// Returns true, if every attempted step starts, where the last one ended.
+bool all_steps_accepted(
+    std::vector<std::pair<double, double>> const &steps) {
+  for (size_t i = 1; i != steps.size(); ++i) {
+    if (steps[i].first != steps[i - 1].second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TEST(Timeevolver, adaptive_smooth_steps_are_accepted) {
+  auto evolver = Model::Timeevolver::make_pointer_instance(adaptive_json());
+  auto problem = make_relaxation(1.0, [](double) { return 0.0; });
+  Eigen::VectorXd times{{0.0, 1.0, 2.0}};
+  auto states = simulate(*evolver, problem, 1.0, times);
+
+  EXPECT_TRUE(all_steps_accepted(problem.steps));
+  // Far fewer steps than a fixed step of the first length would need:
+  EXPECT_LT(problem.steps.size(), 100);
+  // The local errors add up, so the global error is larger than the
+  // tolerance:
+  EXPECT_NEAR(states(1.0)[0], std::exp(-1.0), 2e-2);
+  EXPECT_NEAR(states(2.0)[0], std::exp(-2.0), 2e-2);
+}
+
+TEST(Timeevolver, adaptive_rejected_steps_are_shortened) {
+  auto evolver = Model::Timeevolver::make_pointer_instance(adaptive_json());
+  // The target jumps at t = 1, which the error estimate must notice:
+  auto problem = make_relaxation(
+      10.0, [](double time) { return time < 1.0 ? 0.0 : 1.0; });
+  Eigen::VectorXd times{{0.0, 0.5, 2.0}};
+  auto states = simulate(*evolver, problem, 0.0, times);
+
+  EXPECT_FALSE(all_steps_accepted(problem.steps));
+  int rejections = 0;
+  for (size_t i = 1; i != problem.steps.size(); ++i) {
+    if (problem.steps[i].first == problem.steps[i - 1].first) {
+      ++rejections;
+      // The step is repeated from the same state with a shorter length:
+      EXPECT_LT(problem.steps[i].second, problem.steps[i - 1].second);
+    }
+  }
+  EXPECT_GT(rejections, 0);
+  EXPECT_NEAR(states(2.0)[0], 1.0, 1e-2);
+}
+
+TEST(Timeevolver, adaptive_step_growth_is_limited) {
+  auto json = adaptive_json();
+  json["maximal_delta_t"] = 0.3;
+  auto evolver = Model::Timeevolver::make_pointer_instance(json);
+  // The solution is constant, so the error estimate vanishes and the steps
+  // grow as fast as allowed:
+  auto problem = make_relaxation(1.0, [](double) { return 1.0; });
+  Eigen::VectorXd times{{0.0, 1.0, 3.0}};
+  simulate(*evolver, problem, 1.0, times);
+
+  ASSERT_TRUE(all_steps_accepted(problem.steps));
+  double last_length = 0.0;
+  for (auto const &[last_time, new_time] : problem.steps) {
+    double const length = new_time - last_time;
+    EXPECT_LE(length, 0.3 + 1e-14);
+    if (last_length > 0.0 and new_time != 3.0) {
+      EXPECT_LE(length, 5.0 * last_length * (1 + 1e-14));
+    }
+    last_length = length;
+  }
+  // The first step is 1% of the first output interval:
+  EXPECT_DOUBLE_EQ(problem.steps.front().second, 0.01);
+  EXPECT_DOUBLE_EQ(problem.steps[1].second - problem.steps[1].first, 0.05);
+}
+
+TEST(Timeevolver, adaptive_steps_end_exactly_at_end_time) {
+  auto evolver = Model::Timeevolver::make_pointer_instance(adaptive_json());
+  auto problem = make_relaxation(1.0, [](double) { return 0.0; });
+  Eigen::VectorXd times{{0.0, 0.7, 1.3}};
+  auto states = simulate(*evolver, problem, 1.0, times);
+
+  EXPECT_EQ(problem.steps.back().second, 1.3);
+  for (auto const &[last_time, new_time] : problem.steps) {
+    EXPECT_LE(new_time, 1.3);
+    // No step is shorter than minimal_delta_t, the last one included:
+    EXPECT_GE(new_time - last_time, 1e-6);
+  }
+  // The last output is the last computed state, not an interpolation:
+  EXPECT_DOUBLE_EQ(states(1.3)[0], problem.last_evaluated_state);
+}
+
+TEST(Timeevolver, adaptive_error_above_tolerance_at_minimal_step_throws) {
+  auto json = adaptive_json();
+  json["adaptive_tolerance"] = 1e-8;
+  json["minimal_delta_t"] = 0.1;
+  auto evolver = Model::Timeevolver::make_pointer_instance(json);
+  auto problem = make_relaxation(
+      10.0, [](double time) { return time < 1.0 ? 0.0 : 1.0; });
+  Eigen::VectorXd times{{0.0, 1.0, 2.0}};
+
+  try {
+    simulate(*evolver, problem, 0.0, times);
+    FAIL() << "Test FAILED: The statement ABOVE\n"
+           << __FILE__ << ":" << __LINE__ << "\nshould have thrown!";
+  } catch (std::exception &e) {
+    EXPECT_THAT(e.what(), HasSubstr("exceeds adaptive_tolerance"));
+  }
+}
+
+/// \brief The algebraic equation x = solution(new_time), whose exact solution
+/// makes the quality of the initial guess observable.
+Scalarproblem make_algebraic(std::function<double(double)> solution) {
+  return Scalarproblem(
+      [solution](double, double new_time, double, double x) {
+        return x - solution(new_time);
+      },
+      [](double, double, double, double) { return 1.0; });
+}
+
+double quadratic(double time) { return 1.0 - 2.0 * time + 3.0 * time * time; }
+
+nlohmann::json predictor_json(int predictor_order) {
+  auto json = R"({
+    "use_simplified_newton": false,
+    "maximal_number_of_newton_iterations": 10,
+    "tolerance": 1e-12,
+    "retries": 0
+  })"_json;
+  json["predictor_order"] = predictor_order;
+  return json;
+}
+
+TEST(Timeevolver, predictor_reproduces_polynomial_history) {
+  auto evolver = Model::Timeevolver::make_pointer_instance(predictor_json(2));
+  auto problem = make_algebraic(quadratic);
+  // Unequal steps, so that the Lagrange weights are not trivial:
+  Eigen::VectorXd times{{0.0, 0.5, 1.5, 2.0, 3.5}};
+  simulate(*evolver, problem, quadratic(0.0), times);
+
+  ASSERT_EQ(problem.initial_guesses.size(), 4);
+  // Once three states are known, the quadratic is extrapolated exactly:
+  for (size_t i = 2; i != problem.initial_guesses.size(); ++i) {
+    EXPECT_NEAR(
+        problem.initial_guesses[i], quadratic(problem.steps[i].second),
+        1e-10);
+  }
+}
+
+TEST(Timeevolver, predictor_falls_back_to_last_state) {
+  auto evolver = Model::Timeevolver::make_pointer_instance(predictor_json(2));
+  auto problem = make_algebraic(quadratic);
+  Eigen::VectorXd times{{0.0, 0.5, 1.5}};
+  simulate(*evolver, problem, quadratic(0.0), times);
+
+  ASSERT_EQ(problem.initial_guesses.size(), 2);
+  // Without history the initial state is the guess:
+  EXPECT_DOUBLE_EQ(problem.initial_guesses[0], quadratic(0.0));
+  // With two states the extrapolation is only linear:
+  double const linear
+      = quadratic(0.5) + 2.0 * (quadratic(0.5) - quadratic(0.0));
+  EXPECT_NEAR(problem.initial_guesses[1], linear, 1e-10);
+}
+
+TEST(Timeevolver, predictor_order_zero_uses_last_state) {
+  auto evolver = Model::Timeevolver::make_pointer_instance(predictor_json(0));
+  auto problem = make_algebraic(quadratic);
+  Eigen::VectorXd times{{0.0, 0.5, 1.5, 2.0}};
+  simulate(*evolver, problem, quadratic(0.0), times);
+
+  ASSERT_EQ(problem.initial_guesses.size(), 3);
+  for (size_t i = 0; i != problem.initial_guesses.size(); ++i) {
+    EXPECT_NEAR(
+        problem.initial_guesses[i], quadratic(problem.steps[i].first), 1e-10);
+  }
+}
+
+TEST(Timeevolver, steady_state_pseudo_transient_converges) {
+  auto json = predictor_json(0);
+  json["maximal_delta_t"] = 100.0;
+  auto evolver = Model::Timeevolver::make_pointer_instance(json);
+  // The stationary state of x' = 2 - x is 2:
+  auto problem = make_relaxation(1.0, [](double) { return 2.0; });
+  Eigen::VectorXd state(1);
+  state << 0.0;
+  Eigen::VectorXd control;
+  evolver->solve_steady_state(3.0, 0.1, state, control, problem);
+
+  EXPECT_NEAR(state[0], 2.0, 1e-12);
+  // Every pseudo time step is followed by a check of the stationary residual
+  // with a step of length 1:
+  std::vector<double> pseudo_delta_ts;
+  for (auto const &[last_time, new_time] : problem.steps) {
+    EXPECT_EQ(new_time, 3.0);
+    if (last_time != 2.0) {
+      pseudo_delta_ts.push_back(new_time - last_time);
+    }
+  }
+  // The residual decreases by 1 / (1 + delta_t) per step, by which the
+  // pseudo time steps grow up to maximal_delta_t, so they soon get long:
+  EXPECT_LT(pseudo_delta_ts.size(), 25);
+  EXPECT_EQ(pseudo_delta_ts.back(), 100.0);
+  for (size_t i = 1; i != pseudo_delta_ts.size(); ++i) {
+    EXPECT_GE(pseudo_delta_ts[i], pseudo_delta_ts[i - 1]);
+    EXPECT_LE(pseudo_delta_ts[i], 100.0);
+  }
+  // The final stationary residual is checked with a prepared time step:
+  EXPECT_EQ(problem.steps.back().first, 2.0);
+}
+
+TEST(Timeevolver, steady_state_is_recognized_immediately) {
+  auto evolver = Model::Timeevolver::make_pointer_instance(predictor_json(0));
+  auto problem = make_relaxation(1.0, [](double) { return 2.0; });
+  Eigen::VectorXd state(1);
+  state << 2.0;
+  Eigen::VectorXd control;
+  evolver->solve_steady_state(3.0, 0.01, state, control, problem);
+
+  EXPECT_EQ(state[0], 2.0);
+  // Only the stationary residual has been evaluated:
+  ASSERT_EQ(problem.steps.size(), 1);
+  EXPECT_EQ(problem.steps.front().first, 2.0);
+}
+
+TEST(Timeevolver, full_newton_evaluates_candidates_in_one_pass) {
+  auto evolver = Model::Timeevolver::make_pointer_instance(predictor_json(0));
+  // Nonlinear, so that every time step needs several Newton iterations:
+  auto problem = Scalarproblem(
+      [](double, double new_time, double, double x) {
+        return x * x * x + x - new_time;
+      },
+      [](double, double, double, double x) { return 3 * x * x + 1; });
+  Eigen::VectorXd times{{0.0, 1.0, 2.0}};
+  simulate(*evolver, problem, 0.0, times);
+
+  // The first candidate of every line search brings its jacobian along:
+  EXPECT_GE(problem.fused_evaluations, 2);
+  double const x = problem.last_evaluated_state;
+  EXPECT_NEAR(x * x * x + x, 2.0, 1e-10);
+}
+
+TEST(Timeevolver, reuse_pivots_without_capable_solver_throws) {
+  auto json = predictor_json(0);
+  json["linear_solver"] = "SparseLU";
+  json["reuse_pivots"] = true;
+
+  try {
+    Model::Timeevolver::make_pointer_instance(json);
+    FAIL() << "Test FAILED: The statement ABOVE\n"
+           << __FILE__ << ":" << __LINE__ << "\nshould have thrown!";
+  } catch (std::exception &e) {
+    EXPECT_THAT(e.what(), HasSubstr("can't reuse pivots"));
+  }
+}
@@ -390,3 +390,55 @@ TEST(testImplicitboxscheme, devaluate_point_d_last_right) {
       analytical_derivative1[1], difference_derivative1[1],
       finite_difference_threshold);
 }
+
+TEST(testImplicitboxscheme, evaluate_point_with_derivatives) {
+  nlohmann::json j;
+  j["diameter"] = nlohmann::json::object();
+  j["diameter"]["unit"] = "m";
+  j["diameter"]["value"] = 0.9144;
+  j["roughness"] = nlohmann::json::object();
+  j["roughness"]["unit"] = "m";
+  j["roughness"]["value"] = 8e-6;
+  Model::Balancelaw::Isothermaleulerequation bl(j);
+
+  double last_time = 0;
+  double new_time = 10;
+  double Delta_x = 15;
+
+  Model::Scheme::Implicitboxscheme<2> scheme;
+
+  // laminar, transitional and turbulent flow:
+  for (double q : {1e-3, 0.1, 50.0, -90.0}) {
+    Eigen::Vector2d last_left(73, 68);
+    Eigen::Vector2d last_right(73, 55);
+    Eigen::Vector2d new_left(63, q);
+    Eigen::Vector2d new_right(60, 0.8 * q);
+
+    Eigen::Vector2d expected_result;
+    scheme.evaluate_point(
+        expected_result, last_time, new_time, Delta_x, last_left, last_right,
+        new_left, new_right, bl);
+    Eigen::Matrix2d expected_left = scheme.devaluate_point_d_new_left(
+        last_time, new_time, Delta_x, last_left, last_right, new_left,
+        new_right, bl);
+    Eigen::Matrix2d expected_right = scheme.devaluate_point_d_new_right(
+        last_time, new_time, Delta_x, last_left, last_right, new_left,
+        new_right, bl);
+
+    Eigen::Vector2d result;
+    Eigen::Matrix2d d_new_left;
+    Eigen::Matrix2d d_new_right;
+    scheme.evaluate_point_with_derivatives(
+        result, d_new_left, d_new_right, last_time, new_time, Delta_x,
+        last_left, last_right, new_left, new_right, bl);
+
+    for (int row = 0; row != 2; ++row) {
+      EXPECT_DOUBLE_EQ(result[row], expected_result[row]) << q;
+      for (int col = 0; col != 2; ++col) {
+        EXPECT_DOUBLE_EQ(d_new_left(row, col), expected_left(row, col)) << q;
+        EXPECT_DOUBLE_EQ(d_new_right(row, col), expected_right(row, col))
+            << q;
+      }
+    }
+  }
+}
@@ -1,14 +1,21 @@
 #include "TestProblem.hpp"
+#include "test_io_helper.hpp"
 
+#include <Linearsolver.hpp>
 #include <Newtonsolver.hpp>
 #include <gmock/gmock-matchers.h>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <sstream>
 
 Eigen::VectorXd f(Eigen::VectorXd x);
 Eigen::VectorXd f2(Eigen::VectorXd x);
 Eigen::SparseMatrix<double> df(Eigen::VectorXd);
 Eigen::SparseMatrix<double> df2(Eigen::VectorXd);
+Eigen::VectorXd f3(Eigen::VectorXd x);
+Eigen::SparseMatrix<double> df3(Eigen::VectorXd);
+Eigen::VectorXd f4(Eigen::VectorXd x);
+Eigen::SparseMatrix<double> df4(Eigen::VectorXd);
 
 TEST(Newtonsolver, LinearSolveWithRoot_InitialValue1) {
   double tol = 1e-12;
@@ -187,6 +194,426 @@ TEST(Newtonsolver, SingularJacobian) {
   }
 }
 
+TEST(Newtonsolver, IterativeSolverDoesNotConverge) {
+  double tol = 1e-12;
+  int max_it = 100;
+
+  Eigen::VectorXd last_state(2);
+  last_state << 0, 0;
+
+  double last_time = 0;
+  double new_time = 1;
+
+  // The jacobian is singular, but has a full sparsity pattern, so the
+  // incomplete LU preconditioner is computed without complaint:
+  TestProblem problem(f4, df4);
+  Eigen::VectorXd control;
+
+  for (std::string name : {"BiCGSTAB", "GMRES"}) {
+    Solver::Newtonsolver Solver(tol, max_it, name);
+    Eigen::VectorXd new_state(2);
+    new_state << 5, 3;
+    try {
+      Solver.solve(
+          new_state, problem, true, false, last_time, new_time, last_state,
+          control);
+      FAIL() << "Test FAILED: The statement ABOVE\n"
+             << __FILE__ << ":" << __LINE__ << "\nshould have thrown! "
+             << name;
+    } catch (Solver::SolverNumericalProblem &e) {
+      EXPECT_THAT(
+          e.what(), testing::HasSubstr("the linear solver did not converge"))
+          << name;
+    }
+  }
+}
+
+TEST(Newtonsolver, KeepPatternOnRepeatedSolves) {
+  double tol = 1e-12;
+  int max_it = 10000;
+
+  Solver::Newtonsolver Solver(tol, max_it);
+  Eigen::VectorXd new_state(2), last_state(2), solution(2);
+  last_state(0) = 0;
+  last_state(1) = 0;
+
+  solution(0) = -0.5;
+  solution(1) = 0.;
+
+  double last_time = 0;
+  double new_time = 1;
+
+  TestProblem problem(f, df);
+  Eigen::VectorXd control;
+
+  for (int run = 0; run != 3; ++run) {
+    new_state(0) = 5 + run;
+    new_state(1) = 3;
+    Solver.evaluate_state_derivative_keep_pattern(
+        problem, last_time, new_time, last_state, new_state, control);
+    EXPECT_EQ(Solver.get_number_non_zeros_jacobian(), 3);
+
+    auto a = Solver.solve(
+        new_state, problem, false, true, last_time, new_time, last_state,
+        control);
+
+    EXPECT_EQ(a.success, true);
+    EXPECT_DOUBLE_EQ(new_state(0), solution(0));
+    EXPECT_DOUBLE_EQ(new_state(1), solution(1));
+  }
+}
+
+TEST(Newtonsolver, AllLinearSolvers) {
+  double tol = 1e-12;
+  int max_it = 100;
+
+  Eigen::VectorXd last_state(2), solution(2);
+  last_state(0) = 0;
+  last_state(1) = 0;
+
+  solution(0) = -0.5;
+  solution(1) = 0.;
+
+  double last_time = 0;
+  double new_time = 1;
+
+  TestProblem problem(f, df);
+  Eigen::VectorXd control;
+
+  for (auto const &name : Solver::get_linearsolver_names()) {
+    for (bool reuse_pivots : {false, true}) {
+      Solver::Newtonsolver Solver(tol, max_it, name, reuse_pivots);
+      Eigen::VectorXd new_state(2);
+      new_state(0) = 5;
+      new_state(1) = 3;
+      auto a = Solver.solve(
+          new_state, problem, true, true, last_time, new_time, last_state,
+          control);
+
+      EXPECT_EQ(a.success, true) << name;
+      EXPECT_NEAR(new_state(0), solution(0), tol) << name;
+      EXPECT_NEAR(new_state(1), solution(1), tol) << name;
+    }
+  }
+}
+
+TEST(Linearsolver, OnlyKLUCanReusePivots) {
+  for (auto const &name : Solver::get_linearsolver_names()) {
+    auto linearsolver = Solver::make_linearsolver(name);
+    EXPECT_EQ(linearsolver->can_reuse_pivots(), name == "KLU") << name;
+  }
+}
+
+#ifdef GRAZER_HAVE_KLU
+TEST(Linearsolver, KLURefactorizeKeepsPivotsUntilTheyDegrade) {
+  auto klu = Solver::make_linearsolver("KLU");
+  Eigen::SparseMatrix<double> matrix(2, 2);
+  matrix.insert(0, 0) = 4.0;
+  matrix.insert(0, 1) = 1.0;
+  matrix.insert(1, 0) = 1.0;
+  matrix.insert(1, 1) = 3.0;
+  matrix.makeCompressed();
+  Eigen::VectorXd rhs{{1.0, 2.0}};
+
+  klu->analyze_pattern(matrix);
+  klu->factorize(matrix);
+  ASSERT_EQ(klu->info(), Eigen::Success);
+  EXPECT_FALSE(klu->reused_pivots());
+
+  // A small change leaves the old pivots good enough:
+  matrix.coeffRef(0, 0) = 4.4;
+  klu->refactorize(matrix);
+  ASSERT_EQ(klu->info(), Eigen::Success);
+  EXPECT_TRUE(klu->reused_pivots());
+  Eigen::VectorXd solution = klu->solve(rhs);
+  EXPECT_LT((matrix * solution - rhs).norm(), 1e-12);
+
+  // A vanishing pivot drops the condition estimate, so KLU factorizes anew:
+  matrix.coeffRef(0, 0) = 1e-14;
+  matrix.coeffRef(1, 1) = 1.0;
+  klu->refactorize(matrix);
+  ASSERT_EQ(klu->info(), Eigen::Success);
+  EXPECT_FALSE(klu->reused_pivots());
+  solution = klu->solve(rhs);
+  EXPECT_LT((matrix * solution - rhs).norm(), 1e-12);
+}
+#endif
+
+TEST(Newtonsolver, JacobianFree) {
+  double tol = 1e-10;
+  int max_it = 100;
+
+  Eigen::VectorXd last_state(2), solution(2);
+  last_state(0) = 0;
+  last_state(1) = 0;
+
+  solution(0) = -0.5;
+  solution(1) = 0.;
+
+  double last_time = 0;
+  double new_time = 1;
+
+  TestProblem problem(f, df);
+  Eigen::VectorXd control;
+
+  for (auto const &name : Solver::get_linearsolver_names()) {
+    for (bool use_full_jacobian : {false, true}) {
+      Solver::Newtonsolver Solver(tol, max_it, name, false, true);
+      Eigen::VectorXd new_state(2);
+      new_state(0) = 5;
+      new_state(1) = 3;
+      auto a = Solver.solve(
+          new_state, problem, true, use_full_jacobian, last_time, new_time,
+          last_state, control);
+
+      EXPECT_EQ(a.success, true) << name;
+      EXPECT_NEAR(new_state(0), solution(0), tol) << name;
+      EXPECT_NEAR(new_state(1), solution(1), tol) << name;
+    }
+  }
+}
+
+TEST(Newtonsolver, BroydenUpdates) {
+  double tol = 1e-12;
+  int max_it = 100;
+
+  Eigen::VectorXd last_state(2), solution(2);
+  last_state(0) = 0;
+  last_state(1) = 0;
+
+  solution(0) = 1;
+  solution(1) = 2;
+
+  double last_time = 0;
+  double new_time = 1;
+
+  TestProblem problem(f3, df3);
+  Eigen::VectorXd control;
+
+  Solver::Newtonsolver simplified(tol, max_it);
+  Eigen::VectorXd new_state(2);
+  new_state << 1.2, 0;
+  auto simplified_result = simplified.solve(
+      new_state, problem, true, false, last_time, new_time, last_state,
+      control);
+  EXPECT_EQ(simplified_result.success, true);
+
+  Solver::Newtonsolver broyden(tol, max_it, "SparseLU", false, false, true);
+  new_state << 1.2, 0;
+  auto broyden_result = broyden.solve(
+      new_state, problem, true, false, last_time, new_time, last_state,
+      control);
+  EXPECT_EQ(broyden_result.success, true);
+  EXPECT_NEAR(new_state(0), solution(0), tol);
+  EXPECT_NEAR(new_state(1), solution(1), tol);
+  EXPECT_LT(broyden_result.used_iterations, simplified_result.used_iterations);
+}
+
+TEST(Newtonsolver, UnknownLinearSolver) {
+  try {
+    Solver::Newtonsolver Solver(1e-12, 100, "NoSuchSolver");
+    FAIL() << "Test FAILED: The statement ABOVE\n"
+           << __FILE__ << ":" << __LINE__ << "\nshould have thrown!";
+  } catch (std::exception &e) {
+    EXPECT_THAT(
+        e.what(), testing::HasSubstr("Unknown linear solver \"NoSuchSolver\""));
+  }
+}
+
+TEST(Newtonsolver, CondensationMatchesSparseLU) {
+  // Two chains [1, 7) and [8, 12), coupled through the indices 0, 7 and 12,
+  // like pipes through nodes, and a range [13, 19), whose entry (13, 18)
+  // breaks the block tridiagonal structure, so it must not be condensed.
+  Eigen::Index const size = 19;
+  std::vector<Eigen::Triplet<double>> triplets;
+  auto add = [&triplets](Eigen::Index row, Eigen::Index col) {
+    double const value = 1.0 + 0.1 * static_cast<double>((3 * row + col) % 7);
+    triplets.emplace_back(row, col, row == col ? 10 * value : value);
+  };
+  for (Eigen::Index first : {1, 8}) {
+    Eigen::Index const after = first == 1 ? 7 : 12;
+    for (Eigen::Index row = first; row != after; ++row) {
+      Eigen::Index const pair_start = first + 2 * ((row - first) / 2);
+      for (Eigen::Index col = std::max(pair_start - 1, first - 1);
+           col != std::min(pair_start + 3, after + 1); ++col) {
+        add(row, col);
+      }
+    }
+    add(first - 1, first);
+    add(first - 1, first + 1);
+    add(after, after - 2);
+    add(after, after - 1);
+  }
+  for (Eigen::Index index : {0, 7, 12}) {
+    add(index, index);
+  }
+  add(0, 12);
+  for (Eigen::Index row = 13; row != size; ++row) {
+    add(row, row);
+    add(row, 13 + (row - 13 + 1) % 6);
+  }
+  add(13, 18);
+  add(13, 0);
+  Eigen::SparseMatrix<double> matrix(size, size);
+  matrix.setFromTriplets(triplets.begin(), triplets.end());
+  matrix.makeCompressed();
+
+  Eigen::MatrixXd rhs(size, 2);
+  for (Eigen::Index row = 0; row != size; ++row) {
+    rhs(row, 0) = static_cast<double>(row) - 5.0;
+    rhs(row, 1) = 1.0 / static_cast<double>(row + 1);
+  }
+
+  auto reference_solver = Solver::make_linearsolver("SparseLU");
+  reference_solver->analyze_pattern(matrix);
+  reference_solver->factorize(matrix);
+  Eigen::MatrixXd reference = reference_solver->solve(rhs);
+
+  for (int number_of_threads : {1, 2, 3}) {
+    auto solver = Solver::make_linearsolver("Condensation");
+    solver->set_number_of_threads(number_of_threads);
+    solver->set_condensable_ranges({{1, 7}, {8, 12}, {13, 19}});
+    std::stringstream buffer;
+    {
+      Catch_cout catcher(buffer.rdbuf());
+      solver->analyze_pattern(matrix);
+    }
+    // The range, that is not condensed, is reported:
+    EXPECT_THAT(buffer.str(), testing::HasSubstr("1 of 3 condensable ranges"));
+    // Factorize twice, new values must replace the old ones:
+    solver->factorize(matrix);
+    solver->factorize(matrix);
+    ASSERT_EQ(solver->info(), Eigen::Success);
+    Eigen::MatrixXd solution = solver->solve(rhs);
+    EXPECT_LT((solution - reference).norm(), 1e-12 * reference.norm())
+        << number_of_threads;
+  }
+}
+
+TEST(Newtonsolver, BlockJacobiInvertsCondensableRanges) {
+  // Dense blocks on the ranges [1, 5) and [5, 7), which are not aligned to
+  // pairs of rows, and the diagonal entries 4 and 0 at the indices 0 and 7:
+  Eigen::Index const size = 8;
+  std::vector<Eigen::Triplet<double>> triplets;
+  for (auto const &[first, after] :
+       std::vector<std::pair<Eigen::Index, Eigen::Index>>{{1, 5}, {5, 7}}) {
+    for (Eigen::Index row = first; row != after; ++row) {
+      for (Eigen::Index col = first; col != after; ++col) {
+        double const value
+            = 1.0 + 0.1 * static_cast<double>((row + 2 * col) % 5);
+        triplets.emplace_back(row, col, row == col ? 10 * value : value);
+      }
+    }
+  }
+  triplets.emplace_back(0, 0, 4.0);
+  triplets.emplace_back(7, 7, 0.0);
+  Eigen::SparseMatrix<double> matrix(size, size);
+  matrix.setFromTriplets(triplets.begin(), triplets.end());
+  matrix.makeCompressed();
+
+  Eigen::VectorXd rhs = Eigen::VectorXd::LinSpaced(size, -1.0, 2.0);
+
+  auto solver = Solver::make_linearsolver("BlockJacobi");
+  solver->set_condensable_ranges({{1, 5}, {5, 7}});
+  solver->analyze_pattern(matrix);
+  solver->factorize(matrix);
+  ASSERT_EQ(solver->info(), Eigen::Success);
+  Eigen::VectorXd solution = solver->solve(rhs);
+
+  Eigen::MatrixXd dense = matrix;
+  Eigen::VectorXd block_solution = solution.segment(1, 6);
+  EXPECT_LT(
+      (dense.block(1, 1, 6, 6) * block_solution - rhs.segment(1, 6)).norm(),
+      1e-12 * rhs.norm());
+  EXPECT_DOUBLE_EQ(solution[0], rhs[0] / 4.0);
+  // A zero diagonal entry is replaced by 1:
+  EXPECT_DOUBLE_EQ(solution[7], rhs[7]);
+}
+
+static int counted_df_calls = 0;
+static Eigen::SparseMatrix<double> counted_df(Eigen::VectorXd x) {
+  ++counted_df_calls;
+  return df(x);
+}
+
+TEST(Newtonsolver, ReuseFactorization) {
+  double tol = 1e-12;
+  int max_it = 100;
+
+  Solver::Newtonsolver Solver(tol, max_it);
+  Eigen::VectorXd new_state(2), last_state(2), solution(2);
+  last_state(0) = 0;
+  last_state(1) = 0;
+
+  solution(0) = -0.5;
+  solution(1) = 0.;
+
+  double last_time = 0;
+  double new_time = 1;
+
+  TestProblem problem(f, counted_df);
+  Eigen::VectorXd control;
+
+  counted_df_calls = 0;
+  new_state << 5, 3;
+  auto a = Solver.solve(
+      new_state, problem, true, false, last_time, new_time, last_state, control,
+      true);
+  EXPECT_EQ(a.success, true);
+  EXPECT_EQ(counted_df_calls, 1);
+  // linear problem, so the Newton method converges in one step:
+  EXPECT_NEAR(a.contraction, 0.0, 1e-12);
+
+  new_state << 7, 1;
+  a = Solver.solve(
+      new_state, problem, false, false, last_time, new_time, last_state,
+      control, true);
+  EXPECT_EQ(a.success, true);
+  EXPECT_EQ(counted_df_calls, 1);
+  EXPECT_DOUBLE_EQ(new_state(0), solution(0));
+  EXPECT_DOUBLE_EQ(new_state(1), solution(1));
+
+  new_state << 7, 1;
+  a = Solver.solve(
+      new_state, problem, false, false, last_time, new_time, last_state,
+      control, false);
+  EXPECT_EQ(counted_df_calls, 2);
+}
+
+TEST(Newtonsolver, NoJacobianAtConvergedInitialGuess) {
+  double tol = 1e-12;
+  int max_it = 100;
+
+  Solver::Newtonsolver Solver(tol, max_it);
+  Eigen::VectorXd new_state(2), last_state(2);
+  last_state << 0, 0;
+
+  double last_time = 0;
+  double new_time = 1;
+
+  TestProblem problem(f, counted_df);
+  Eigen::VectorXd control;
+
+  // linear problem, so the first full Newton step is accepted and
+  // converged. Its jacobian is evaluated together with its values, in vain:
+  counted_df_calls = 0;
+  new_state << 5, 3;
+  auto a = Solver.solve(
+      new_state, problem, true, true, last_time, new_time, last_state,
+      control);
+  EXPECT_EQ(a.success, true);
+  EXPECT_EQ(a.used_iterations, 1);
+  EXPECT_EQ(counted_df_calls, 2);
+
+  // already converged, so no jacobian at all:
+  a = Solver.solve(
+      new_state, problem, false, true, last_time, new_time, last_state,
+      control);
+  EXPECT_EQ(a.success, true);
+  EXPECT_EQ(a.used_iterations, 0);
+  EXPECT_EQ(counted_df_calls, 2);
+}
+
 Eigen::VectorXd f(Eigen::VectorXd x) {
   Eigen::Matrix2d A;
   A << 2, 1, 0, 3;
@@ -219,3 +646,29 @@ Eigen::SparseMatrix<double> df2(Eigen::VectorXd x) {
   A << 2 * x[0], 2 * x[1], 0.0, 2 * x[1];
   return A.sparseView();
 }
+
+Eigen::VectorXd f3(Eigen::VectorXd x) {
+  Eigen::Vector2d y;
+  y << x(0) * x(0) * x(0) - 1, x(0) + x(1) - 3;
+  return y;
+}
+
+Eigen::SparseMatrix<double> df3(Eigen::VectorXd x) {
+  Eigen::Matrix2d A;
+  A << 3 * x(0) * x(0), 0.0, 1.0, 1.0;
+  return A.sparseView();
+}
+
+Eigen::VectorXd f4(Eigen::VectorXd x) {
+  Eigen::Matrix2d A;
+  A << 1, 1, 1, 1;
+  Eigen::Vector2d b;
+  b << 1, 0;
+  return A * x + b;
+}
+
+Eigen::SparseMatrix<double> df4(Eigen::VectorXd) {
+  Eigen::Matrix2d A;
+  A << 1, 1, 1, 1;
+  return A.sparseView();
+}
@@ -268,3 +268,25 @@ TEST(ControlStateCache, failed_simulation) {
   EXPECT_EQ(encountered, 0);
   EXPECT_EQ(new_states, nullptr);
 }
+
+TEST(ControlStateCache, rejects_adaptive_timesteps) {
+  nlohmann::json timeevolution_json = R"(    {
+        "use_simplified_newton": true,
+        "maximal_number_of_newton_iterations": 2,
+        "tolerance": 1e-8,
+        "retries": 0,
+        "use_adaptive_timesteps": true
+    }
+)"_json;
+
+  auto evolver = Model::Timeevolver::make_pointer_instance(timeevolution_json);
+  try {
+    Optimization::ControlStateCache cache(std::move(evolver));
+    FAIL() << "Test FAILED: The statement ABOVE\n"
+           << __FILE__ << ":" << __LINE__ << "\nshould have thrown!";
+  } catch (std::exception &e) {
+    EXPECT_THAT(
+        e.what(),
+        HasSubstr("Adaptive time steps can't be used for optimization"));
+  }
+}